@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "GlobMatcher.h"
+#include <random>
+#include <iostream>
+std::wstring GlobToRegex(const std::wstring& glob){
+    static const std::wregex escapePattern(LR"([.\\+^$|()[\]{}])");
+    static const std::wregex starPattern(LR"(\*+)");
+    static const std::wregex questionPattern(LR"(\?)");
+    std::wstring regex = glob;
+    regex = std::regex_replace(regex, escapePattern, LR"(\$&)");
+    regex = std::regex_replace(regex, starPattern, LR"([^\\/:]*)");
+    regex = std::regex_replace(regex, questionPattern, LR"([^\\/:])");
+    return regex;
+}
+int main(){
+  std::mt19937 r(1); const wchar_t al[]=L"aAb\\*?:."; const wchar_t tl[]=L"aAb\\:.x";
+  long bad=0, badA=0;
+  for(int n=0;n<300000;n++){
+    std::wstring p,t; int pl=r()%8, tl2=r()%10;
+    for(int i=0;i<pl;i++) p+=al[r()%8];
+    for(int i=0;i<tl2;i++) t+=tl[r()%7];
+    // mimic token trimming: trailing backslashes removed
+    while(!p.empty()&&p.back()==L'\\') p.pop_back();
+    if(p.empty()) continue;
+    CGlobMatcher m(p);
+    std::wregex re(GlobToRegex(p), std::regex_constants::icase);
+    bool a=m.Matches(t), b=std::regex_match(t,re);
+    if(a!=b){ if(bad<5) std::wcout<<L"Matches "<<p<<L" | "<<t<<L" m="<<a<<L" re="<<b<<L"\n"; bad++; }
+    std::wregex re2(L"(?:"+GlobToRegex(p)+L")(?:\\\\.*)?", std::regex_constants::icase);
+    bool c=m.MatchesPathOrAncestor(t), d=std::regex_match(t,re2);
+    if(c!=d){ if(badA<5) std::wcout<<L"Anc "<<p<<L" | "<<t<<L" m="<<c<<L" re="<<d<<L"\n"; badA++; }
+  }
+  std::wcout<<bad<<L" "<<badA<<L"\n";
+}
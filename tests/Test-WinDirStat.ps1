@@ -756,13 +756,14 @@ function Invoke-ProcessWithTimeout {
 # The exe used must have its WinDirStat.ini sitting next to it (the caller stages
 # that copy).  Returns { CommandLine, ExitCode, ElapsedSeconds, StdOut, StdErr }.
 function Invoke-WinDirStatCsv {
-    param([string] $Exe, [string] $Csv, [string] $Root, [switch] $Duplicates, [switch] $Permissions, [string] $WorkingDirectory)
+    param([string] $Exe, [string] $Csv, [string] $Root, [switch] $Duplicates, [switch] $Permissions, [switch] $Folders, [string] $Query, [string] $WorkingDirectory)
 
     if (Test-Path -LiteralPath $Csv) { Remove-Item -LiteralPath $Csv -Force }
 
-    $flag = if ($Permissions) { '/savepermsto' } elseif ($Duplicates) { '/savedupesto' } else { '/saveto' }
+    $flag = if ($Query) { '/savequeryto' } elseif ($Folders) { '/savefoldersto' } elseif ($Permissions) { '/savepermsto' } elseif ($Duplicates) { '/savedupesto' } else { '/saveto' }
+    $arguments = if ($Query) { @($flag, $Csv, '/query', $Query, $Root) } else { @($flag, $Csv, $Root) }
     $wd   = if ($WorkingDirectory) { $WorkingDirectory } else { Split-Path -Parent $Exe }
-    $run  = Invoke-ProcessWithTimeout -FileName $Exe -Arguments @($flag, $Csv, $Root) -WorkingDirectory $wd
+    $run  = Invoke-ProcessWithTimeout -FileName $Exe -Arguments $arguments -WorkingDirectory $wd
     if ($run.ExitCode -ne 0) {
         throw "WinDirStat exited with code $($run.ExitCode). StdErr: $($run.StdErr)"
     }
@@ -10492,6 +10493,8 @@ function Invoke-FilteringSuite {
             ExcludeBlocked = @('^include-blocked\.keep$')
         }
         $rx.IncludeTopAndConflict = @($rx.IncludeTop + (RegexPath $D.Conflict))
+        $rx.ManyExcludeDirs = @(1..28 | ForEach-Object { (RegexPath (Join-Path $scanRoot "Never$_")) }) + $rx.ExcludeDirs
+        $rx.ManyExcludeFiles = @(1..28 | ForEach-Object { "^never-$_-[^\\/:]*\.tmp[^\\/:]$" }) + $rx.ExcludeFiles
 
         $glob = @{
             IncludeTop = @((Join-Path $scanRoot 'Included*'), $D.Beta)
@@ -10514,6 +10517,9 @@ function Invoke-FilteringSuite {
             ConsecutiveStarsNoMatch = @(('*' * 24) + '.not-present')
         }
         $glob.IncludeTopAndConflict = @($glob.IncludeTop + $D.Conflict)
+        $glob.ManyExcludeDirs = @(1..28 | ForEach-Object { Join-Path $scanRoot "Never$_" }) + $glob.ExcludeDirs
+        $glob.ManyExcludeFiles = @(1..28 | ForEach-Object { "never-$_-*.tmp?" }) + $glob.ExcludeFiles
+        $glob.ManyExtensionExcludes = @(1..200 | ForEach-Object { "*.never$_" }) + $glob.ExcludeFiles
 
         $allExpected = Expected
         $scenarioSpecs = @(
@@ -10555,6 +10561,9 @@ function Invoke-FilteringSuite {
             @{ Name = 'Glob_IncludeExcludeSameDirectory'; Regex = $false; IncludeDirs = $glob.IncludeConflict; ExcludeDirs = $glob.ExcludeConflict; Expected = @{ IncludeDirRoots = $roots.Conflict; ExcludeDirRoots = $roots.Conflict }; Behavior = 'When the same directory is both included and excluded, the exclude should win and only the scan root ancestor should remain.' }
             @{ Name = 'Glob_FileExcludeOverridesSameInclude'; Regex = $false; IncludeFiles = $glob.IncludeBlocked; ExcludeFiles = $glob.ExcludeBlocked; Expected = @{ IncludeFileNames = @('include-blocked.keep'); ExcludeFileNames = @('include-blocked.keep') }; Behavior = 'When the same file name is both included and excluded, the exclude should win and no files should be exported.' }
             @{ Name = 'Glob_CaseInsensitive_DirAndFile'; Regex = $false; IncludeDirs = $glob.IncludeAlphaLower; IncludeFiles = $glob.IncludeAlphaUpper; Expected = @{ IncludeDirRoots = $roots.Alpha; IncludeFileNames = @('include-alpha.keep') }; Behavior = 'Glob matching should be case-insensitive for both directory paths and file names.' }
+            @{ Name = 'Regex_ManyExcludePatterns'; Regex = $true; ExcludeDirs = $rx.ManyExcludeDirs; ExcludeFiles = $rx.ManyExcludeFiles; Expected = @{ ExcludeDirRoots = $roots.Excluded; ExcludeFilePatterns = $true }; Behavior = 'Thirty regex directory and file excludes, most matching nothing, should give the same rows as the short exclude lists.' }
+            @{ Name = 'Glob_ManyExcludePatterns'; Regex = $false; ExcludeDirs = $glob.ManyExcludeDirs; ExcludeFiles = $glob.ManyExcludeFiles; Expected = @{ ExcludeDirRoots = $roots.Excluded; ExcludeFilePatterns = $true }; Behavior = 'Compiled glob matchers for thirty directory and file excludes should give the same rows as the equivalent regex scenario.' }
+            @{ Name = 'Glob_ManyExtensionExcludes'; Regex = $false; ExcludeFiles = $glob.ManyExtensionExcludes; Expected = @{ ExcludeFilePatterns = $true }; Behavior = 'Two hundred extension and literal name excludes answered by lookup should give the same rows as the short exclude list.' }
             @{ Name = 'Glob_SpecialCharacterPathAndFile'; Regex = $false; IncludeDirs = $glob.IncludeSpecial; IncludeFiles = $glob.IncludeSpecialFile; Expected = @{ IncludeDirRoots = $roots.Special; IncludeFileNames = @('literal-special.keep') }; Behavior = 'Glob directory paths and file names containing glob/regex metacharacters should match as literals when no wildcard is used.' }
         )
         $scenarios = @($scenarioSpecs | ForEach-Object { Scenario $_ })
@@ -10711,6 +10720,7 @@ function Add-SettingsTestHarness {
         'ExtViewColumnWidths', 'ExtViewColumnVisibility', 'SearchViewColumnOrder', 'SearchViewColumnWidths', 'SearchViewColumnVisibility', 'TopViewColumnOrder', 'TopViewColumnWidths', 'TopViewColumnVisibility'
         'WatcherColumnOrder', 'WatcherColumnWidths', 'WatcherColumnVisibility', 'PermsViewColumnVisibility', 'SelectDrivesDrives', 'SelectDrivesFolder', 'FilteringExcludeDirs', 'FilteringExcludeFiles'
         'FilteringIncludeDirs', 'FilteringIncludeFiles', 'PermsExcludeRegex', 'SearchTerm'
+        'PersistHashCache', 'ParallelLargeFileHash', 'HashReadQueueDepth', 'ScanForPartialDuplicates', 'PartialDupeMinSizeMiB', 'PartialDupeMinPercent', 'ScanForDuplicateFolders', 'FilteringApplyToResults', 'SearchThreads'
     )
     $cleanupFields = @('Title', 'CommandLine', 'Enabled', 'VirginTitle', 'WorksForDrives', 'WorksForDirectories',
         'WorksForFiles', 'WorksForUncPaths', 'RecurseIntoSubdirectories', 'AskForConfirmation', 'ShowConsoleWindow',
@@ -10726,8 +10736,16 @@ function Add-SettingsTestHarness {
     $includeReplacement = @'
 #include "CsvLoader.h"
 #ifdef WDS_SETTINGS_TEST
+#include "ChunkIndex.h"
 #include "FileSearchControl.h"
+#include "FilterView.h"
+#include "Filtering.h"
+#include "NameIndex.h"
+#include "OverlappedReader.h"
+#include "ProgressDlg.h"
+#include "ReadScheduler.h"
 #include <iomanip>
+#include <random>
 #include <sstream>
 #include <type_traits>
 #endif
@@ -10914,6 +10932,579 @@ namespace WdsSettingsTest
         return out.str();
     }
 
+    std::string SchedulerProbeJson()
+    {
+        // Candidates arrive in enumeration order, scattered over the volume
+        std::mt19937_64 random(42);
+        std::uniform_int_distribution<LONGLONG> position(0, 100'000'000);
+        std::vector<LONGLONG> arrival(10'000);
+        std::ranges::generate(arrival, [&] { return position(random); });
+
+        ReadScheduler<int, LONGLONG> schedule;
+        for (const LONGLONG lcn : arrival) schedule.Push(0, lcn, lcn);
+        std::vector<LONGLONG> issued;
+        while (const auto lcn = schedule.Pop()) issued.push_back(*lcn);
+
+        // An exclusive volume hands out its next request only after the last one is released
+        ReadScheduler<int, int> exclusive;
+        exclusive.Push(1, 10, 1, true);
+        exclusive.Push(1, 20, 2, true);
+        exclusive.Push(2, 5, 3);
+        const auto exclusiveFirst = exclusive.Pop();
+        const auto otherVolume = exclusive.Pop();
+        const auto whileBusy = exclusive.Pop();
+        exclusive.Release(1);
+        const auto afterRelease = exclusive.Pop();
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "IssuedCount", issued.size());
+        Field(out, first, "ArrivalSeekCost", ReadScheduler<int, LONGLONG>::SeekCost(arrival));
+        Field(out, first, "IssuedSeekCost", ReadScheduler<int, LONGLONG>::SeekCost(issued));
+        Field(out, first, "ExclusiveFirst", exclusiveFirst.value_or(0));
+        Field(out, first, "OtherVolumeWhileBusy", otherVolume.value_or(0));
+        Field(out, first, "BlockedWhileBusy", !whileBusy.has_value());
+        Field(out, first, "AfterRelease", afterRelease.value_or(0));
+        out << "\n    }";
+        return out.str();
+    }
+
+    std::string ReaderProbeJson()
+    {
+        // Random content so a reordered or short buffer changes the digest
+        constexpr ULONGLONG fileSize = 64 * wds::Mi;
+        std::vector<BYTE> content(fileSize);
+        std::mt19937_64 random(7);
+        std::ranges::generate(content, [&] { return static_cast<BYTE>(random()); });
+        const std::wstring path = (std::filesystem::temp_directory_path() / L"wds-reader-probe.bin").wstring();
+        if (std::ofstream file(path, std::ios::binary | std::ios::trunc); true)
+            file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+        const XXH64_hash_t expected = XXH3_64bits(content.data(), content.size());
+
+        // Throughput in MiB/s, or zero when the streamed content differs from the file
+        const auto measure = [&](const ULONG depth, const bool unbuffered) -> ULONGLONG
+        {
+            const SmartPointer state(XXH3_freeState, XXH3_createState());
+            XXH3_64bits_reset(state);
+            const auto start = std::chrono::steady_clock::now();
+            COverlappedReader reader(path, 0, fileSize, depth, unbuffered);
+            ULONGLONG bytes = 0;
+            for (std::span<const BYTE> data; reader.IsOpen() && SUCCEEDED(reader.Next(data)) && !data.empty();)
+            {
+                XXH3_64bits_update(state, data.data(), data.size());
+                bytes += data.size();
+            }
+            const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            if (bytes != fileSize || XXH3_64bits_digest(state) != expected) return 0;
+            return bytes * 1'000'000 / std::max<ULONGLONG>(1, micros) / wds::Mi;
+        };
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "BufferedDepth4MiBps", measure(4, false));
+        Field(out, first, "UnbufferedDepth1MiBps", measure(1, true));
+        Field(out, first, "UnbufferedDepth4MiBps", measure(4, true));
+        Field(out, first, "UnbufferedDepth16MiBps", measure(16, true));
+        out << "\n    }";
+        DeleteFile(path.c_str());
+        return out.str();
+    }
+
+    std::string ChunkProbeJson()
+    {
+        // Files are assembled from random segments so shared content is known exactly
+        const std::filesystem::path folder = std::filesystem::temp_directory_path() / L"wds-chunk-probe";
+        std::filesystem::create_directories(folder);
+        const auto segment = [](const ULONGLONG seed, const size_t size)
+        {
+            std::vector<BYTE> bytes(size);
+            std::mt19937_64 random(seed);
+            std::ranges::generate(bytes, [&] { return static_cast<BYTE>(random()); });
+            return bytes;
+        };
+
+        CItem root(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, folder.wstring());
+        const auto addFile = [&](const std::wstring& name, const std::vector<std::vector<BYTE>>& parts)
+        {
+            std::ofstream file(folder / name, std::ios::binary | std::ios::trunc);
+            ULONGLONG size = 0;
+            for (const auto& part : parts)
+            {
+                file.write(reinterpret_cast<const char*>(part.data()), static_cast<std::streamsize>(part.size()));
+                size += part.size();
+            }
+            auto* item = new CItem(IT_FILE | ITF_DONE, name);
+            item->SetSizeLogical(size);
+            root.AddChild(item, true);
+            return item;
+        };
+
+        // An edited copy, an unrelated file, two files sharing only zeroed space,
+        // and a group sharing only a header too common to pair them
+        const std::vector<BYTE> zeros(2 * wds::Mi);
+        const std::vector<BYTE> header = segment(9, wds::Mi / 2);
+        CItem* original = addFile(L"original.bin", { segment(1, 4 * wds::Mi), segment(2, 4 * wds::Mi) });
+        CItem* edited = addFile(L"edited.bin", { segment(1, 4 * wds::Mi), segment(3, wds::Mi), segment(2, 3 * wds::Mi) });
+        CItem* unrelated = addFile(L"unrelated.bin", { segment(4, 8 * wds::Mi) });
+        CItem* zeroFirst = addFile(L"zero-first.bin", { segment(5, 2 * wds::Mi), zeros });
+        CItem* zeroSecond = addFile(L"zero-second.bin", { segment(6, 2 * wds::Mi), zeros });
+        std::unordered_set<const CItem*> headerGroup;
+        for (ULONGLONG copy = 0; copy < 24; copy++)
+            headerGroup.insert(addFile(std::format(L"header-{:02}.bin", copy), { header, segment(100 + copy, wds::Mi / 2) }));
+
+        CChunkIndex index;
+        const std::atomic<bool> cancel = false;
+        const auto addStart = std::chrono::steady_clock::now();
+        bool allAdded = true;
+        for (CItem* child : root.GetChildren()) allAdded &= index.AddFile(child, cancel);
+        const auto addMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - addStart).count();
+
+        const auto pairStart = std::chrono::steady_clock::now();
+        const auto shared = index.GetSharedFiles(0.01);
+        const auto pairMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - pairStart).count();
+
+        const auto findPair = [&](const CItem* first, const CItem* second)
+        {
+            const auto match = std::ranges::find_if(shared, [&](const CChunkIndex::SharedPair& pair)
+            {
+                return pair.first == first && pair.second == second || pair.first == second && pair.second == first;
+            });
+            return match == shared.end() ? 0ull : match->sharedBytes;
+        };
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "AllFilesAdded", allAdded);
+        Field(out, first, "EditedSharedBytes", findPair(original, edited));
+        Field(out, first, "UnrelatedSharedBytes", findPair(original, unrelated));
+        Field(out, first, "ZeroSharedBytes", findPair(zeroFirst, zeroSecond));
+        Field(out, first, "HeaderGroupPairs", static_cast<ULONGLONG>(std::ranges::count_if(shared, [&](const CChunkIndex::SharedPair& pair)
+        {
+            return headerGroup.contains(pair.first) && headerGroup.contains(pair.second);
+        })));
+        Field(out, first, "AddMiBps", index.GetStatistics().bytes * 1'000'000 / std::max<ULONGLONG>(1, addMicros) / wds::Mi);
+        Field(out, first, "PairMicroseconds", static_cast<ULONGLONG>(pairMicros));
+        out << "\n    }";
+        std::error_code ec;
+        std::filesystem::remove_all(folder, ec);
+        return out.str();
+    }
+
+    std::string ChunkedHashProbeJson()
+    {
+        // A sparse file with random blocks every 64 MiB is hashed without the disk setting the pace
+        constexpr ULONGLONG fileSize = 512 * wds::Mi;
+        constexpr ULONGLONG blockStride = 64 * wds::Mi;
+        const std::filesystem::path folder = std::filesystem::temp_directory_path() / L"wds-chunked-hash-probe";
+        std::filesystem::create_directories(folder);
+        const std::wstring path = (folder / L"sparse.bin").wstring();
+        const auto block = [](const ULONGLONG offset)
+        {
+            std::vector<BYTE> bytes(wds::Mi);
+            std::mt19937_64 random(offset);
+            std::ranges::generate(bytes, [&] { return static_cast<BYTE>(random()); });
+            return bytes;
+        };
+        bool sparse = false;
+        if (SmartPointer hFile(CloseHandle, CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)); hFile != INVALID_HANDLE_VALUE)
+        {
+            DWORD bytesReturned = 0;
+            sparse = DeviceIoControl(hFile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytesReturned, nullptr) != 0;
+            for (ULONGLONG offset = 0; offset < fileSize; offset += blockStride)
+            {
+                const auto bytes = block(offset);
+                DWORD written = 0;
+                LARGE_INTEGER position{ .QuadPart = static_cast<LONGLONG>(offset) };
+                SetFilePointerEx(hFile, position, nullptr, FILE_BEGIN);
+                WriteFile(hFile, bytes.data(), static_cast<DWORD>(bytes.size()), &written, nullptr);
+            }
+            LARGE_INTEGER end{ .QuadPart = static_cast<LONGLONG>(fileSize) };
+            SetFilePointerEx(hFile, end, nullptr, FILE_BEGIN);
+            SetEndOfFile(hFile);
+        }
+        ULARGE_INTEGER allocated{};
+        allocated.LowPart = GetCompressedFileSize(path.c_str(), &allocated.HighPart);
+
+        // Expected digests follow the stream and chunked layouts over the same content
+        const SmartPointer streamState(XXH3_freeState, XXH3_createState());
+        XXH3_64bits_reset(streamState);
+        std::vector<XXH64_canonical_t> chunkDigests;
+        std::vector<BYTE> chunk(CItem::HASH_CHUNK_SIZE);
+        for (ULONGLONG chunkStart = 0; chunkStart < fileSize; chunkStart += chunk.size())
+        {
+            std::ranges::fill(chunk, BYTE{ 0 });
+            for (ULONGLONG offset = (chunkStart + blockStride - 1) / blockStride * blockStride;
+                offset < chunkStart + chunk.size(); offset += blockStride)
+                std::ranges::copy(block(offset), chunk.begin() + static_cast<ptrdiff_t>(offset - chunkStart));
+            XXH3_64bits_update(streamState, chunk.data(), chunk.size());
+            XXH64_canonicalFromHash(&chunkDigests.emplace_back(), XXH3_64bits(chunk.data(), chunk.size()));
+        }
+        const auto canonical = [](const XXH64_hash_t hash)
+        {
+            XXH64_canonical_t digest;
+            XXH64_canonicalFromHash(&digest, hash);
+            return std::vector<BYTE>(digest.digest, digest.digest + sizeof(digest.digest));
+        };
+        const auto expectedStream = canonical(XXH3_64bits_digest(streamState));
+        const auto expectedChunked = canonical(XXH3_64bits(chunkDigests.data(), chunkDigests.size() * sizeof(XXH64_canonical_t)));
+
+        // Hashes are computed rather than served from the persistent cache
+        const bool originalPersist = COptions::PersistHashCache;
+        const bool originalParallel = COptions::ParallelLargeFileHash;
+        const int originalAlgorithm = COptions::FileHashAlgorithm;
+        COptions::PersistHashCache = false;
+        COptions::FileHashAlgorithm = HASH_XXHASH;
+
+        CItem root(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, folder.wstring());
+        auto* file = new CItem(IT_FILE | ITF_DONE, L"sparse.bin");
+        file->SetSizeLogical(fileSize);
+        root.AddChild(file, true);
+        BlockingQueue<CItem*> queue;
+        const auto measure = [&](const bool chunked, const std::vector<BYTE>& expected) -> ULONGLONG
+        {
+            COptions::ParallelLargeFileHash = chunked;
+            const auto start = std::chrono::steady_clock::now();
+            const auto hash = file->GetFileHash(fileSize, &queue);
+            const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            if (hash != expected) return 0;
+            return fileSize * 1'000'000 / std::max<ULONGLONG>(1, micros) / wds::Mi;
+        };
+        const ULONGLONG streamMiBps = measure(false, expectedStream);
+        const ULONGLONG chunkedMiBps = measure(true, expectedChunked);
+        COptions::PersistHashCache = originalPersist;
+        COptions::ParallelLargeFileHash = originalParallel;
+        COptions::FileHashAlgorithm = originalAlgorithm;
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "Sparse", sparse);
+        Field(out, first, "AllocatedMiB", allocated.QuadPart / wds::Mi);
+        Field(out, first, "SeekPenalty", HasSeekPenalty(path));
+        Field(out, first, "StreamMiBps", streamMiBps);
+        Field(out, first, "ChunkedMiBps", chunkedMiBps);
+        out << "\n    }";
+        std::error_code ec;
+        std::filesystem::remove_all(folder, ec);
+        return out.str();
+    }
+
+    std::string FilterViewProbeJson()
+    {
+        // Filters are applied to synthetic trees so no scan is needed
+        const std::wstring excludeFiles = COptions::FilteringExcludeFiles.Obj();
+        const bool useLogical = COptions::TreeMapUseLogical.Obj();
+        COptions::FilteringExcludeFiles = std::wstring(L"*.tmp");
+        COptions::TreeMapUseLogical = false;
+        CFiltering::CompileFilters();
+
+        const auto addFolder = [](CItem* parent, const std::wstring& name)
+        {
+            auto* folder = new CItem(IT_DIRECTORY | ITF_DONE, name);
+            parent->AddChild(folder, true);
+            parent->UpwardAddFolders(1);
+            return folder;
+        };
+        const auto addFile = [](CItem* folder, const std::wstring& name, const ULONGLONG size)
+        {
+            auto* file = new CItem(IT_FILE | ITF_DONE, name);
+            file->SetSizePhysical(size);
+            file->SetSizeLogical(size);
+            folder->AddChild(file, true);
+            folder->UpwardAddSizePhysical(size);
+            folder->UpwardAddSizeLogical(size);
+            folder->UpwardAddFiles(1);
+        };
+
+        // One folder keeps part of its files, one loses all of them
+        CItem root(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, L"C:\\wds-filter-probe");
+        CItem* kept = addFolder(&root, L"kept");
+        addFile(kept, L"keep.bin", 4000);
+        addFile(kept, L"drop.tmp", 1000);
+        addFile(addFolder(&root, L"emptied"), L"only.tmp", 2000);
+        addFile(&root, L"top.bin", 500);
+
+        CFilterView::SetActive(std::make_shared<CFilterView>(&root));
+        const ULONGLONG visibleItems = CFilterView::GetActive()->GetVisibleItems();
+        const ULONGLONG shownSize = root.TmiGetSize();
+        const ULONGLONG scannedSize = root.GetSizePhysical();
+        const ULONGLONG scannedFiles = root.GetFilesCount();
+        const ULONGLONG shownKeptChildren = kept->TmiGetChildCount();
+        const auto held = CFilterView::Find(&root);
+        CFilterView::SetActive(nullptr);
+        const ULONGLONG heldSize = held == nullptr ? 0 : held->sizePhysical;
+        const ULONGLONG clearedSize = root.TmiGetSize();
+
+        // Benchmark over a wide tree where a quarter of the files are filtered
+        CItem large(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, L"C:\\wds-filter-bench");
+        constexpr ULONGLONG folders = 1000, filesPerFolder = 500;
+        for (ULONGLONG folderIndex = 0; folderIndex < folders; folderIndex++)
+        {
+            CItem* folder = addFolder(&large, std::format(L"folder{:04}", folderIndex));
+            for (ULONGLONG fileIndex = 0; fileIndex < filesPerFolder; fileIndex++)
+                addFile(folder, std::format(L"file{:03}.{}", fileIndex, fileIndex % 4 == 0 ? L"tmp" : L"bin"), 4096);
+        }
+        const auto buildStart = std::chrono::steady_clock::now();
+        const auto view = std::make_shared<CFilterView>(&large);
+        const auto buildMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - buildStart).count();
+
+        COptions::FilteringExcludeFiles = excludeFiles;
+        COptions::TreeMapUseLogical = useLogical;
+        CFiltering::CompileFilters();
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "VisibleItems", visibleItems);
+        Field(out, first, "ShownSize", shownSize);
+        Field(out, first, "ScannedSize", scannedSize);
+        Field(out, first, "ScannedFiles", scannedFiles);
+        Field(out, first, "ShownKeptChildren", shownKeptChildren);
+        Field(out, first, "HeldProjectionSize", heldSize);
+        Field(out, first, "ClearedSize", clearedSize);
+        Field(out, first, "BenchmarkVisibleItems", view->GetVisibleItems());
+        Field(out, first, "BenchmarkItemsPerSecond",
+            (folders * filesPerFolder + folders) * 1'000'000 / std::max<ULONGLONG>(1, buildMicros));
+        out << "\n    }";
+        return out.str();
+    }
+
+    std::string NameIndexProbeJson()
+    {
+        // Names mix case, shared stems and short names so every lookup path is taken
+        CItem root(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, L"C:\\wds-name-probe");
+        const std::array<std::wstring, 5> stems = { L"Report", L"report_final", L"IMG_", L"data", L"x" };
+        const std::array<std::wstring, 3> extensions = { L"txt", L"JPG", L"md" };
+        std::vector<CItem*> folders;
+        for (ULONGLONG folderIndex = 0; folderIndex < 200; folderIndex++)
+        {
+            auto* folder = new CItem(IT_DIRECTORY | ITF_DONE, std::format(L"dir{:03}", folderIndex));
+            root.AddChild(folder, true);
+            folders.push_back(folder);
+            for (ULONGLONG fileIndex = 0; fileIndex < 1000; fileIndex++)
+            {
+                folder->AddChild(new CItem(IT_FILE | ITF_DONE, std::format(L"{}{:04}.{}",
+                    stems[fileIndex % stems.size()], fileIndex, extensions[fileIndex % extensions.size()])), true);
+            }
+        }
+
+        // Every lookup is compared with a walk over the whole tree
+        struct Lookup { std::wstring term; bool regex; bool wholePhrase; bool onlyFiles; };
+        const std::vector<Lookup> lookups = {
+            { L"report", false, false, false }, { L"*final*.txt", false, false, false },
+            { L"IMG_0*", false, false, false }, { L"x1", false, false, false },
+            { L"*.JPG", false, true, true }, { L"dir0", false, false, true },
+            { L"^data0[0-4]", true, false, false }, { L"rep(ort)?", true, false, false },
+            { L"fresh", false, false, false } };
+        const auto matchesWalk = [&]
+        {
+            for (const auto& lookup : lookups)
+            {
+                const auto regex = CFileSearchControl::ComputeSearchRegex(lookup.term, false, lookup.regex);
+                std::vector<CItem*> indexed;
+                if (!CNameIndex::Get()->Search(&root, lookup.term, lookup.regex, regex,
+                    lookup.wholePhrase, lookup.onlyFiles, indexed)) return false;
+
+                std::vector<CItem*> walked;
+                for (std::vector<CItem*> stack({ &root }); !stack.empty();)
+                {
+                    CItem* item = stack.back();
+                    stack.pop_back();
+                    const auto name = item->GetNameView();
+                    if ((!lookup.onlyFiles || item->IsTypeOrFlag(IT_FILE)) && (lookup.wholePhrase ?
+                        std::regex_match(name.begin(), name.end(), regex) :
+                        std::regex_search(name.begin(), name.end(), regex))) walked.push_back(item);
+                    if (!item->IsLeaf()) stack.insert(stack.end(), item->GetChildren().begin(), item->GetChildren().end());
+                }
+
+                std::ranges::sort(indexed);
+                std::ranges::sort(walked);
+                if (indexed != walked) return false;
+            }
+            return true;
+        };
+
+        const auto buildStart = std::chrono::steady_clock::now();
+        CNameIndex::Get()->Build(&root);
+        const auto buildMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - buildStart).count();
+        const bool buildMatches = matchesWalk();
+
+        // Refresh one folder the way a rescan does: its old items go and new ones arrive
+        CItem* refreshed = folders[17];
+        CNameIndex::Get()->Remove({ refreshed });
+        std::vector<CItem*> unused;
+        const bool staleSkipped = !CNameIndex::Get()->Search(&root, L"report", false,
+            CFileSearchControl::ComputeSearchRegex(L"report", false, false), false, false, unused);
+        while (refreshed->GetChildren().size() > 500) refreshed->RemoveChild(refreshed->GetChildren().back());
+        for (ULONGLONG fileIndex = 0; fileIndex < 100; fileIndex++)
+            refreshed->AddChild(new CItem(IT_FILE | ITF_DONE, std::format(L"Fresh{:03}.log", fileIndex)), true);
+
+        const auto updateStart = std::chrono::steady_clock::now();
+        CNameIndex::Get()->Update(&root, { refreshed });
+        const auto updateMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - updateStart).count();
+        const bool updateMatches = matchesWalk();
+        const ULONGLONG indexedItems = CNameIndex::Get()->GetStatistics().items;
+        CNameIndex::Get()->Clear();
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "BuildMatchesWalk", buildMatches);
+        Field(out, first, "StaleSearchFallsBack", staleSkipped);
+        Field(out, first, "UpdateMatchesWalk", updateMatches);
+        Field(out, first, "IndexedItems", indexedItems);
+        Field(out, first, "BuildMicroseconds", static_cast<ULONGLONG>(buildMicros));
+        Field(out, first, "UpdateMicroseconds", static_cast<ULONGLONG>(updateMicros));
+        out << "\n    }";
+        return out.str();
+    }
+
+    std::string SearchWalkProbeJson()
+    {
+        // A wide synthetic tree walked at doubling thread counts, counting progress as the dialog would
+        CItem root(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, L"C:\\wds-search-probe");
+        for (ULONGLONG folderIndex = 0; folderIndex < 500; folderIndex++)
+        {
+            auto* folder = new CItem(IT_DIRECTORY | ITF_DONE, std::format(L"folder{:03}", folderIndex));
+            root.AddChild(folder, true);
+            for (ULONGLONG fileIndex = 0; fileIndex < 1000; fileIndex++)
+            {
+                auto* file = new CItem(IT_FILE | ITF_DONE, std::format(L"{}{:04}.bin", fileIndex % 10 == 0 ? L"report" : L"data", fileIndex));
+                file->SetSizeLogical(fileIndex);
+                folder->AddChild(file, true);
+            }
+        }
+
+        const auto regex = CFileSearchControl::ComputeSearchRegex(L"report", false, false);
+        std::vector<ULONGLONG> threadCounts;
+        std::vector<ULONGLONG> walkMicroseconds;
+        std::vector<ULONGLONG> matchCounts;
+        std::vector<ULONGLONG> progressCounts;
+        for (size_t threads = 1; threads <= 32; threads *= 2)
+        {
+            size_t matchCount = 0;
+            CProgressDlg progress(static_cast<size_t>(root.GetItemsCount()), CProgressDlg::Flags::None, nullptr, [](CProgressDlg*) {});
+            const auto walkStart = std::chrono::steady_clock::now();
+            const auto matches = CFileSearchControl::SearchTree(&root, regex, false, true, threads, &progress, matchCount);
+            walkMicroseconds.push_back(static_cast<ULONGLONG>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - walkStart).count()));
+            threadCounts.push_back(threads);
+            matchCounts.push_back(matchCount);
+            progressCounts.push_back(progress.GetCurrent());
+        }
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "Threads", threadCounts);
+        Field(out, first, "MatchCounts", matchCounts);
+        Field(out, first, "ProgressCounts", progressCounts);
+        Field(out, first, "WalkMicroseconds", walkMicroseconds);
+        out << "\n    }";
+        return out.str();
+    }
+
+    std::string PathBuilderProbeJson()
+    {
+        // A root named with a trailing backslash, folders of files and a hardlink entry between them
+        CItem root(IT_DIRECTORY | ITF_ROOTITEM | ITF_DONE, L"C:\\wds-path-probe\\");
+        for (ULONGLONG folderIndex = 0; folderIndex < 200; folderIndex++)
+        {
+            auto* folder = new CItem(IT_DIRECTORY | ITF_DONE, std::format(L"folder{:03}", folderIndex));
+            root.AddChild(folder, true);
+            auto* nested = new CItem(IT_DIRECTORY | ITF_DONE, L"nested");
+            folder->AddChild(nested, true);
+            for (ULONGLONG fileIndex = 0; fileIndex < 1000; fileIndex++)
+                (fileIndex % 2 == 0 ? folder : nested)->AddChild(new CItem(IT_FILE | ITF_DONE, std::format(L"file{:04}.bin", fileIndex)), true);
+        }
+        std::vector<CItem*> items;
+        for (std::vector<CItem*> stack({ &root }); !stack.empty();)
+        {
+            CItem* item = stack.back();
+            stack.pop_back();
+            items.push_back(item);
+            if (!item->IsLeaf()) stack.insert(stack.end(), item->GetChildren().rbegin(), item->GetChildren().rend());
+        }
+        const CItem hardlink(items.back());
+
+        // Every path is compared, with the hardlink entry looked up between regular items
+        CItemPathBuilder builder;
+        bool matches = true;
+        for (size_t index = 0; index < items.size(); index++)
+        {
+            matches &= builder.Get(items[index]) == items[index]->GetPath();
+            if (index % 97 == 0) matches &= builder.Get(&hardlink) == hardlink.GetPath();
+        }
+
+        // Allocations are counted as heap-backed results and buffer growth respectively
+        ULONGLONG getPathAllocations = 0;
+        ULONGLONG getPathCharacters = 0;
+        const auto getPathStart = std::chrono::steady_clock::now();
+        for (const CItem* item : items)
+        {
+            const std::wstring path = item->GetPath();
+            getPathCharacters += path.size();
+            if (path.capacity() > std::wstring().capacity()) getPathAllocations++;
+        }
+        const auto getPathMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - getPathStart).count();
+
+        CItemPathBuilder exporter;
+        ULONGLONG builderAllocations = 0;
+        ULONGLONG builderCharacters = 0;
+        size_t capacity = 0;
+        const auto builderStart = std::chrono::steady_clock::now();
+        for (const CItem* item : items)
+        {
+            const std::wstring& path = exporter.Get(item);
+            builderCharacters += path.size();
+            if (path.capacity() != capacity) builderAllocations++, capacity = path.capacity();
+        }
+        const auto builderMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - builderStart).count();
+
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        Field(out, first, "Items", static_cast<ULONGLONG>(items.size()));
+        Field(out, first, "BuilderMatchesGetPath", matches);
+        Field(out, first, "SameCharacters", getPathCharacters == builderCharacters);
+        Field(out, first, "GetPathMicroseconds", static_cast<ULONGLONG>(getPathMicros));
+        Field(out, first, "BuilderMicroseconds", static_cast<ULONGLONG>(builderMicros));
+        Field(out, first, "GetPathAllocations", getPathAllocations);
+        Field(out, first, "BuilderAllocations", builderAllocations);
+        out << "\n    }";
+        return out.str();
+    }
+
+    std::string CoreProbeJson()
+    {
+        std::ostringstream out;
+        out << '{';
+        bool first = true;
+        RawField(out, first, "Scheduler", SchedulerProbeJson());
+        RawField(out, first, "Reader", ReaderProbeJson());
+        RawField(out, first, "Chunks", ChunkProbeJson());
+        RawField(out, first, "ChunkedHash", ChunkedHashProbeJson());
+        RawField(out, first, "FilterView", FilterViewProbeJson());
+        RawField(out, first, "NameIndex", NameIndexProbeJson());
+        RawField(out, first, "SearchWalk", SearchWalkProbeJson());
+        RawField(out, first, "PathBuilder", PathBuilderProbeJson());
+        out << "\n  }";
+        return out.str();
+    }
+
     std::string ReparseFollowingJson()
     {
         std::ostringstream out;
@@ -10976,7 +11567,7 @@ namespace WdsSettingsTest
         return out.str();
     }
 
-    std::string BuildDumpJson(const bool includeItemProbe)
+    std::string BuildDumpJson(const bool includeItemProbe, const bool includeCoreProbe)
     {
         std::ostringstream out;
         out << '{';
@@ -10991,6 +11582,7 @@ namespace WdsSettingsTest
         RawField(out, first, "SearchProbeMatches", SearchProbeJson());
         RawField(out, first, "UserDefinedCleanups", UserDefinedCleanupsJson());
         if (includeItemProbe) RawField(out, first, "ItemProbe", ItemProbeJson());
+        if (includeCoreProbe) RawField(out, first, "CoreProbe", CoreProbeJson());
 
         out << "\n}\n";
         return out.str();
@@ -11003,6 +11595,7 @@ namespace WdsSettingsTest
         if (!argv) return;
 
         bool includeItemProbe = false;
+        bool includeCoreProbe = false;
         bool saveSettings = false;
         bool mutateCleanups = false;
         std::wstring outputPath;
@@ -11013,6 +11606,10 @@ namespace WdsSettingsTest
             {
                 includeItemProbe = true;
             }
+            else if (arg == L"/wds-settings-core-probe" || arg == L"--wds-settings-core-probe")
+            {
+                includeCoreProbe = true;
+            }
             else if (arg == L"/wds-settings-save" || arg == L"--wds-settings-save")
             {
                 saveSettings = true;
@@ -11040,7 +11637,7 @@ namespace WdsSettingsTest
 
         std::ofstream out(outputPath, std::ios::binary);
         if (!out.is_open()) ExitProcess(1);
-        out << BuildDumpJson(includeItemProbe);
+        out << BuildDumpJson(includeItemProbe, includeCoreProbe);
         out.flush();
         ExitProcess(out.good() ? 0 : 1);
     }
@@ -11098,6 +11695,7 @@ function Invoke-SettingsDump {
         [Parameter(Mandatory)] [System.Collections.Specialized.OrderedDictionary] $Sections,
         [Parameter(Mandatory)] [string] $Name,
         [switch] $ItemProbe,
+        [switch] $CoreProbe,
         [switch] $Save,
         [switch] $MutateCleanups
     )
@@ -11115,6 +11713,7 @@ function Invoke-SettingsDump {
 
     $arguments = @('/wds-settings-dump', $jsonPath)
     if ($ItemProbe) { $arguments += '/wds-settings-item-probe' }
+    if ($CoreProbe) { $arguments += '/wds-settings-core-probe' }
     if ($Save) { $arguments += '/wds-settings-save' }
     if ($MutateCleanups) { $arguments += '/wds-settings-mutate-cleanups' }
     $run = Invoke-ProcessWithTimeout -FileName $Exe -Arguments $arguments -WorkingDirectory $runRoot
@@ -11355,6 +11954,12 @@ $settingCases = @(
     New-SettingCase @('ExcludeHiddenFile', 'ExcludeProtectedFile', 'FollowVolumeMountPoints') -Default $false -ExplicitInput 1 -ExplicitExpected $true
     New-SettingCase UseSizeSuffixes -ExplicitInput 0
     New-SettingCase ScanForDuplicates -Section DupeView -Default $false -ExplicitInput 1 -ExplicitExpected $true
+    New-SettingCase PersistHashCache -Section DupeView -Default $true -ExplicitInput 0 -ExplicitExpected $false
+    New-SettingCase ScanForPartialDuplicates -Section DupeView -Default $false -ExplicitInput 1 -ExplicitExpected $true
+    New-SettingCase PartialDupeMinSizeMiB -Section DupeView -Default 64 -ExplicitInput 128 -ExplicitExpected 128 -Minimum 1 -Maximum 1048576 -HighInput $script:SettingsSearchHighOutOfRangeValue -BoundsOrder 17
+    New-SettingCase PartialDupeMinPercent -Section DupeView -Default 10 -ExplicitInput 25 -ExplicitExpected 25 -Minimum 1 -Maximum 100 -BoundsOrder 18
+    New-SettingCase ScanForDuplicateFolders -Section DupeView -Default $false -ExplicitInput 1 -ExplicitExpected $true
+    New-SettingCase SearchThreads -Section SearchView -Default 0 -ExplicitInput 6 -ExplicitExpected 6 -Minimum 0 -Maximum 256 -BoundsOrder 19
     New-SettingCase SearchMaxResults -Section SearchView -Default $script:SettingsDefaultSearchMaxResults -ExplicitInput 321 -ExplicitExpected 321 -Minimum $script:SettingsMinSearchMaxResults -Maximum $script:SettingsMaxSearchResults -HighInput $script:SettingsSearchHighOutOfRangeValue -BoundsOrder 9
     New-SettingCase @(
         'ShowDeletePermanentlyWarning', 'ShowDeleteToRecycleBinWarning', 'ShowElevationPrompt'
@@ -11373,6 +11978,9 @@ $settingCases = @(
     New-SettingCase AutoElevate -Default $false -ExplicitInput 1 -ExplicitExpected $true
     New-SettingCase UseAbsolutePercentages -Section FileTreeView -Default $true -ExplicitInput 0 -ExplicitExpected $false
     New-SettingCase @('UseBackupRestore', 'UseDrawTextCache', 'UseFastScanEngine') -Default $true -ExplicitInput 0 -ExplicitExpected $false
+    New-SettingCase ParallelLargeFileHash -Default $true -ExplicitInput 0 -ExplicitExpected $false
+    New-SettingCase HashReadQueueDepth -Default 4 -ExplicitInput 16 -ExplicitExpected 16 -Minimum 1 -Maximum 64 -BoundsOrder 16
+    New-SettingCase FilteringApplyToResults -Default $false -ExplicitInput 1 -ExplicitExpected $true
     New-SettingCase TreeMapStyle -Section TreeMapView -Default 0 -ExplicitInput 1 -ExplicitExpected 1 -Minimum 0 -Maximum $script:SettingsMaxTreeMapStyle -BoundsOrder 11
     New-SettingCase GraphPaneStyle -Section TreeMapView -Default 0 -ExplicitInput 3 -ExplicitExpected 3 -Minimum 0 -Maximum $script:SettingsMaxGraphPaneStyle -BoundsOrder 12
     New-SettingCase TreeMapMaxDepth -Section TreeMapView -Default $script:SettingsDefaultTreeMapMaxDepth -ExplicitInput 9 -ExplicitExpected 9 -Minimum $script:SettingsMinTreeMapMaxDepth -Maximum $script:SettingsMaxTreeMapMaxDepth -BoundsOrder 13
@@ -11790,6 +12398,180 @@ try {
         $dump
     }))
 
+    [void] $results.Add((Invoke-Scenario -Name 'Core_ReadSchedulerSweepsAndSerializesVolumes' `
+        -Behavior ('Duplicate hash reads are issued in one sweep per volume, and a rotational volume ' +
+            'hands out one read at a time while other volumes continue.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_ReadSchedulerSweepsAndSerializesVolumes' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.Scheduler
+
+        Assert-EqualCases $ctx @(
+            'Every scheduled read is issued', $probe.IssuedCount, 10000
+            'Exclusive volume serves its lowest position first', $probe.ExclusiveFirst, 1
+            'Other volume is served while the exclusive one is busy', $probe.OtherVolumeWhileBusy, 3
+            'Released volume serves its next position', $probe.AfterRelease, 2
+        )
+        Assert-True $ctx 'Busy exclusive volume hands out nothing' $probe.BlockedWhileBusy
+        Assert-True $ctx 'Sweep travels under 1% of the arrival order' `
+            ([double] $probe.IssuedSeekCost * 100 -lt [double] $probe.ArrivalSeekCost)
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_OverlappedReaderStreamsAtEveryDepth' `
+        -Behavior ('The overlapped reader behind duplicate hashing should stream a file in order at every ' +
+            'queue depth, buffered or not, and report its throughput.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_OverlappedReaderStreamsAtEveryDepth' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.Reader
+
+        # A rate of zero means the streamed digest did not match the file
+        foreach ($rate in $probe.PSObject.Properties) {
+            Assert-True $ctx "$($rate.Name) streams the whole file in order ($($rate.Value) MiB/s)" ([long] $rate.Value -gt 0)
+        }
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_ChunkIndexPairsOnlyMeaningfulChunks' `
+        -Behavior ('Partial duplicate detection should estimate the content an edited copy shares while ignoring ' +
+            'zeroed blocks and chunks common to many files, and report its chunking and pairing cost.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_ChunkIndexPairsOnlyMeaningfulChunks' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.Chunks
+
+        Assert-EqualCases $ctx @(
+            'Unrelated files share nothing', $probe.UnrelatedSharedBytes, 0
+            'Zeroed blocks do not pair files', $probe.ZeroSharedBytes, 0
+            'A header shared by many files does not pair them', $probe.HeaderGroupPairs, 0
+        )
+        Assert-True $ctx 'Every file is chunked' $probe.AllFilesAdded
+        Assert-True $ctx 'Edited copy shares most of its content' `
+            ([long] $probe.EditedSharedBytes -ge 6MB -and [long] $probe.EditedSharedBytes -le 8MB)
+        Assert-True $ctx ("Chunking and pairing cost is reported ({0} MiB/s, {1} us)" -f $probe.AddMiBps, $probe.PairMicroseconds) `
+            ([long] $probe.AddMiBps -gt 0)
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_ChunkedHashMatchesLayoutOnSparseFile' `
+        -Behavior ('Hashing a large sparse synthetic file should produce the stream and chunked xxHash layouts over its ' +
+            'content, reading chunks in order when the volume has a seek penalty, and report the throughput of both.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_ChunkedHashMatchesLayoutOnSparseFile' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.ChunkedHash
+
+        Assert-True $ctx 'Synthetic file is sparse' $probe.Sparse
+        Assert-True $ctx ("Only the written blocks are allocated ({0} MiB)" -f $probe.AllocatedMiB) ([long] $probe.AllocatedMiB -lt 64)
+        Assert-True $ctx ("Stream hash matches its layout ({0} MiB/s)" -f $probe.StreamMiBps) ([long] $probe.StreamMiBps -gt 0)
+        Assert-True $ctx ("Chunked hash matches its layout ({0} MiB/s, seek penalty {1})" -f $probe.ChunkedMiBps, $probe.SeekPenalty) `
+            ([long] $probe.ChunkedMiBps -gt 0)
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_FilterViewScopesToDisplay' `
+        -Behavior ('Applying filters to scanned results should narrow the sizes and children the tree and treemap show ' +
+            'while exports keep the scanned values, keep a view alive for readers holding it, and report its build rate.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_FilterViewScopesToDisplay' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.FilterView
+
+        Assert-EqualCases $ctx @(
+            'Shown size excludes filtered files', $probe.ShownSize, 4500
+            'Visible items count kept files and folders', $probe.VisibleItems, 4
+            'Filtered files leave the shown children', $probe.ShownKeptChildren, 1
+            'Scanned size is unchanged by the view', $probe.ScannedSize, 7500
+            'Scanned file count is unchanged by the view', $probe.ScannedFiles, 4
+            'A held projection outlives its replaced view', $probe.HeldProjectionSize, 4500
+            'Clearing the view restores the scanned size', $probe.ClearedSize, 7500
+            'Benchmark view keeps three quarters of the files', $probe.BenchmarkVisibleItems, 376000
+        )
+        Assert-True $ctx ("View build rate is reported ({0} items/s)" -f $probe.BenchmarkItemsPerSecond) `
+            ([long] $probe.BenchmarkItemsPerSecond -gt 0)
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_NameIndexMatchesWalkAcrossRefresh' `
+        -Behavior ('Trigram lookups should return exactly what a tree walk finds for globs, regular expressions, ' +
+            'short terms and file-only searches, fall back to the walk during a refresh, and index the refreshed folder without a rebuild.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_NameIndexMatchesWalkAcrossRefresh' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.NameIndex
+
+        Assert-True $ctx 'Built index matches the tree walk' $probe.BuildMatchesWalk
+        Assert-True $ctx 'Searches walk the tree while a refresh is under way' $probe.StaleSearchFallsBack
+        Assert-True $ctx 'Updated index matches the tree walk' $probe.UpdateMatchesWalk
+        Assert-Equal $ctx 'Indexed items follow the refresh' $probe.IndexedItems 199801
+        Assert-True $ctx ("Refresh update is cheaper than a build ({0} us vs {1} us)" -f $probe.UpdateMicroseconds, $probe.BuildMicroseconds) `
+            ([long] $probe.UpdateMicroseconds -lt [long] $probe.BuildMicroseconds)
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_SearchWalkScalesAcrossThreads' `
+        -Behavior ('The parallel search walk should find the same matches at 1 to 32 threads on a synthetic tree, ' +
+            'count every item into a progress dialog, and report its time at each thread count.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_SearchWalkScalesAcrossThreads' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.SearchWalk
+
+        Assert-Equal $ctx 'Thread counts walked' (@($probe.Threads) -join ',') '1,2,4,8,16,32'
+        Assert-True $ctx 'Every thread count finds every match' `
+            (@($probe.MatchCounts | Where-Object { [long] $_ -ne 50000 }).Count -eq 0)
+        Assert-True $ctx 'Every thread count reports each walked item to the progress counter once' `
+            (@($probe.ProgressCounts | Where-Object { [long] $_ -ne 500501 }).Count -eq 0)
+        $timings = for ($index = 0; $index -lt @($probe.Threads).Count; $index++) {
+            '{0} threads: {1} us' -f $probe.Threads[$index], $probe.WalkMicroseconds[$index]
+        }
+        Assert-True $ctx ("Walk times are reported ({0})" -f ($timings -join ', ')) `
+            (@($probe.WalkMicroseconds | Where-Object { [long] $_ -le 0 }).Count -eq 0)
+
+        $dump
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Core_PathBuilderMatchesGetPath' `
+        -Behavior ('The reusable path builder should return the same path as CItem::GetPath for every item of a ' +
+            'synthetic tree, with hardlink entries in between, and report its time and allocations against GetPath.') `
+        -Body {
+        param($ctx)
+
+        $dump = Invoke-SettingsDump -Exe $testExe -Sections (New-BaseIniSections) `
+            -Name 'Core_PathBuilderMatchesGetPath' -CoreProbe
+        $probe = $dump.Dump.CoreProbe.PathBuilder
+
+        Assert-Equal $ctx 'Items compared' $probe.Items 200401
+        Assert-True $ctx 'Builder matches GetPath for every item' $probe.BuilderMatchesGetPath
+        Assert-True $ctx 'Both walks produce the same characters' $probe.SameCharacters
+        Assert-True $ctx ("Builder allocates less ({0} vs {1} allocations, {2} vs {3} us)" -f $probe.BuilderAllocations,
+            $probe.GetPathAllocations, $probe.BuilderMicroseconds, $probe.GetPathMicroseconds) `
+            ([long] $probe.BuilderAllocations -lt [long] $probe.GetPathAllocations)
+
+        $dump
+    }))
+
     [void] $results.Add((Invoke-Scenario -Name 'Locale_UsesConfiguredLanguageWhenRequested' `
         -Behavior ('Formatting and runtime resource lookup should honor configured Dutch and Norwegian locales, ' +
             'while the Windows-locale option should retain its sentinel.') -Body {
@@ -12196,6 +12978,206 @@ try {
         [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
     }))
 
+    [void] $results.Add((Invoke-Scenario -Name 'Json_Duplicates_SameSizePopulationScales' -Behavior ('A folder of 20000 distinct files sharing one size, ' +
+        'like a fixed-size chunk store, should be hashed without quadratic candidate tracking and report only the planted duplicates.') -Body {
+        param($ctx)
+
+        # Distinct files differ in their trailing bytes so every one reaches the hashing stage
+        $sameSizeRoot = Join-Path $workRoot 'same-size-population'
+        New-Item -ItemType Directory -Force -Path $sameSizeRoot | Out-Null
+        $bytes = [byte[]]::new(4096)
+        for ($index = 0; $index -lt 20000; $index++) {
+            [System.BitConverter]::GetBytes([long] $index).CopyTo($bytes, $bytes.Length - 8)
+            [System.IO.File]::WriteAllBytes((Join-Path $sameSizeRoot ('chunk{0:D5}.bin' -f $index)), $bytes)
+        }
+        $plantedNames = foreach ($copy in 1..3) { Join-Path $sameSizeRoot "planted-$copy.bin" }
+        [System.BitConverter]::GetBytes([long] -1).CopyTo($bytes, $bytes.Length - 8)
+        foreach ($planted in $plantedNames) { [System.IO.File]::WriteAllBytes($planted, $bytes) }
+
+        $sections = New-BaseIniSections
+        Set-IniValues $sections @('Options', 'UseFastScanEngine', 0; 'DupeView', 'ScanForDuplicates', 1; 'DupeView', 'PersistHashCache', 0)
+        $jsonPath = Join-Path $workRoot 'json-dupes-same-size.json'
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections $sections
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $jsonPath -Root $sameSizeRoot -Duplicates
+
+        $items = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $jsonPath -Raw -Encoding UTF8))
+        Assert-SetEqual $ctx 'Only the planted copies are reported' `
+            -Actual @($items | ForEach-Object { Normalize-ComparePath $_.Name }) `
+            -Expected @($plantedNames | ForEach-Object { Normalize-ComparePath $_ })
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Json_Duplicates_FoldersReplaceTheirFileSets' -Behavior ('With ScanForDuplicateFolders, two identical folder trees ' +
+        'should be reported once as a folder pair while the file sets inside them are never listed; a loose pair outside them is still listed.') -Body {
+        param($ctx)
+
+        $folderRoot = Join-Path $workRoot 'duplicate-folders'
+        $trees = foreach ($tree in 'tree-a', 'tree-b') { Join-Path $folderRoot $tree }
+        foreach ($tree in $trees) {
+            New-Item -ItemType Directory -Force -Path (Join-Path $tree 'nested') | Out-Null
+            [System.IO.File]::WriteAllBytes((Join-Path $tree 'first.bin'), [byte[]] (1..200 * 64 | ForEach-Object { $_ % 251 }))
+            [System.IO.File]::WriteAllBytes((Join-Path $tree 'nested\second.bin'), [byte[]] (1..300 * 64 | ForEach-Object { $_ % 241 }))
+        }
+        $loosePair = foreach ($copy in 1..2) { Join-Path $folderRoot "loose-$copy.bin" }
+        foreach ($loose in $loosePair) { [System.IO.File]::WriteAllBytes($loose, [byte[]] (1..500 * 64 | ForEach-Object { $_ % 239 })) }
+
+        $sections = New-BaseIniSections
+        Set-IniValues $sections @('Options', 'UseFastScanEngine', 0; 'DupeView', 'ScanForDuplicates', 1;
+            'DupeView', 'ScanForDuplicateFolders', 1; 'DupeView', 'PersistHashCache', 0)
+        $jsonPath = Join-Path $workRoot 'json-dupes-folders.json'
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections $sections
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $jsonPath -Root $folderRoot -Duplicates
+
+        $items = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $jsonPath -Raw -Encoding UTF8))
+        Assert-SetEqual $ctx 'Only the folder pair and the loose pair are reported' `
+            -Actual @($items | ForEach-Object { Normalize-ComparePath $_.Name }) `
+            -Expected @(@($trees) + @($loosePair) | ForEach-Object { Normalize-ComparePath $_ })
+
+        $folderItems = @($items | Where-Object { (Normalize-ComparePath $_.Name) -in @($trees | ForEach-Object { Normalize-ComparePath $_ }) })
+        if ($folderItems.Count -eq 2) {
+            Assert-Equal $ctx 'Duplicate folders share the same Hash Prefix' $folderItems[0].'Hash Prefix' $folderItems[1].'Hash Prefix'
+        }
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
+    # Shared by the query scenarios: 650000 bytes in four files, one of them in a subfolder,
+    # each spanning enough clusters that physical sizes rank them like logical ones
+    $queryRoot = Join-Path $workRoot 'query-tree'
+    New-Item -ItemType Directory -Force -Path (Join-Path $queryRoot 'sub') | Out-Null
+    $queryFiles = [ordered] @{ 'big.log' = 300000; 'mid.log' = 200000; 'small.txt' = 100000; 'sub\deep.log' = 50000 }
+    foreach ($file in $queryFiles.GetEnumerator()) {
+        [System.IO.File]::WriteAllBytes((Join-Path $queryRoot $file.Key), [byte[]]::new($file.Value))
+    }
+
+    [void] $results.Add((Invoke-Scenario -Name 'Csv_Query_ListsMatchesLargestFirst' -Behavior ('A headless query without grouping should write ' +
+        'one row per matching item, largest first, with its logical and physical size and attributes.') -Body {
+        param($ctx)
+
+        $csvPath = Join-Path $workRoot 'query-matches.csv'
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections (New-BaseIniSections)
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $csvPath -Root $queryRoot -Query 'ext in {log}'
+
+        $rows = @(Import-Csv -LiteralPath $csvPath -Encoding UTF8)
+        Assert-Equal $ctx 'Column headers' (($rows[0].PSObject.Properties.Name) -join '|') 'Name|Logical Size|Physical Size|Last Change|Attributes'
+        Assert-Equal $ctx 'Matching files largest first' `
+            (@($rows | ForEach-Object { Normalize-ComparePath $_.Name }) -join '|') `
+            ((@('big.log', 'mid.log', 'sub\deep.log') | ForEach-Object { Normalize-ComparePath (Join-Path $queryRoot $_) }) -join '|')
+        Assert-Equal $ctx 'Logical sizes' (@($rows | ForEach-Object { $_.'Logical Size' }) -join '|') '300000|200000|50000'
+        Assert-True $ctx 'Physical sizes are numbers' (@($rows | Where-Object { $_.'Physical Size' -notmatch '^\d+$' }).Count -eq 0)
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Json_Query_GroupsCountNestedSizesOnce' -Behavior ('A grouped query should count every match ' +
+        'but add the size of a match nested in a match of the same group only once, while a different group still gets it.') -Body {
+        param($ctx)
+
+        $jsonPath = Join-Path $workRoot 'query-groups.json'
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections (New-BaseIniSections)
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $jsonPath -Root $queryRoot -Query 'size > 0 group by type'
+
+        # The root and its subfolder are both folders, so the subfolder adds no size; the files all do
+        $groups = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $jsonPath -Raw -Encoding UTF8))
+        Assert-Equal $ctx 'Groups ordered by size then key' (@($groups | ForEach-Object { $_.Name }) -join '|') 'file|folder'
+        Assert-Equal $ctx 'File group items' ($groups | Where-Object Name -eq 'file').Items 4
+        Assert-Equal $ctx 'File group logical size' ($groups | Where-Object Name -eq 'file').'Logical Size' 650000
+        Assert-Equal $ctx 'Folder group items' ($groups | Where-Object Name -eq 'folder').Items 2
+        Assert-Equal $ctx 'Folder group logical size' ($groups | Where-Object Name -eq 'folder').'Logical Size' 650000
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Json_Query_LimitKeepsLargest' -Behavior ('The limit clause should keep only the largest ' +
+        'matches, and the largest groups when grouping.') -Body {
+        param($ctx)
+
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections (New-BaseIniSections)
+        $itemsPath = Join-Path $workRoot 'query-limit.json'
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $itemsPath -Root $queryRoot -Query 'file limit 2'
+        $items = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $itemsPath -Raw -Encoding UTF8))
+        Assert-Equal $ctx 'Two largest files' `
+            (@($items | ForEach-Object { Normalize-ComparePath $_.Name }) -join '|') `
+            ((@('big.log', 'mid.log') | ForEach-Object { Normalize-ComparePath (Join-Path $queryRoot $_) }) -join '|')
+
+        $groupsPath = Join-Path $workRoot 'query-limit-groups.json'
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $groupsPath -Root $queryRoot -Query 'file group by ext limit 1'
+        $groups = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $groupsPath -Raw -Encoding UTF8))
+        Assert-Equal $ctx 'Largest extension group only' (@($groups | ForEach-Object { $_.Name }) -join '|') 'log'
+        Assert-Equal $ctx 'Largest group keeps its full size' $groups[0].'Logical Size' 550000
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Json_Query_GroupsSkipSizesOfAnyOuterMatchInTheGroup' -Behavior ('A grouped query ' +
+        'should add the size of a match only once to its group when any match above it, not just the nearest, is in the same group.') -Body {
+        param($ctx)
+
+        # Administrators own the tree except one folder in the middle, so the file's nearest
+        # matched ancestor belongs to another group than the root above it
+        $ownerRoot = Join-Path $workRoot 'query-owners'
+        $middle = Join-Path $ownerRoot 'outer\middle'
+        New-Item -ItemType Directory -Force -Path $middle | Out-Null
+        [System.IO.File]::WriteAllBytes((Join-Path $middle 'deep.bin'), [byte[]]::new(100000))
+        & icacls $ownerRoot /setowner '*S-1-5-32-544' /T /C *> $null
+        & icacls $middle /setowner '*S-1-5-18' *> $null
+        if ((Get-Acl -LiteralPath $middle).Owner -eq (Get-Acl -LiteralPath $ownerRoot).Owner) {
+            Add-Warning $ctx 'Folder owners could not be changed (requires administrator privileges)'
+            return
+        }
+
+        $jsonPath = Join-Path $workRoot 'query-owners.json'
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections (New-BaseIniSections)
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $jsonPath -Root $ownerRoot -Query 'size > 0 group by owner'
+
+        # The root, outer folder and file share a group; the middle folder has its own
+        $groups = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $jsonPath -Raw -Encoding UTF8))
+        $outerGroup = $groups | Where-Object { [long] $_.Items -eq 3 }
+        $middleGroup = $groups | Where-Object { [long] $_.Items -eq 1 }
+        Assert-Equal $ctx 'Owner groups' $groups.Count 2
+        Assert-Equal $ctx 'Outer owner group counts the file without its size again' $outerGroup.'Logical Size' 100000
+        Assert-Equal $ctx 'Middle owner group gets the size once' $middleGroup.'Logical Size' 100000
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
+    [void] $results.Add((Invoke-Scenario -Name 'Json_FolderRankings_GrowthAcrossSessions' -Behavior ('Headless folder rankings should rank ' +
+        'folders by size, and a later session should list the folders that grew since the previous one with the bytes they gained.') -Body {
+        param($ctx)
+
+        # Snapshots of earlier runs live beside the portable executable
+        $rankingRoot = Join-Path $workRoot 'folder-rankings'
+        foreach ($folder in 'grows', 'steady') { New-Item -ItemType Directory -Force -Path (Join-Path $rankingRoot $folder) | Out-Null }
+        [System.IO.File]::WriteAllBytes((Join-Path $rankingRoot 'grows\first.bin'), [byte[]]::new(1000))
+        [System.IO.File]::WriteAllBytes((Join-Path $rankingRoot 'steady\only.bin'), [byte[]]::new(2000))
+        Remove-Item -LiteralPath ([System.IO.Path]::ChangeExtension($testExe, 'folders')) -Force -ErrorAction SilentlyContinue
+        Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections (New-BaseIniSections)
+
+        $growthTitle = 'Fastest Growing Folders'
+        $firstPath = Join-Path $workRoot 'folder-rankings-first.json'
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $firstPath -Root $rankingRoot -Folders
+        $first = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $firstPath -Raw -Encoding UTF8))
+        $largest = @($first | Where-Object Description -eq 'Largest Folders')
+        Assert-Equal $ctx 'Largest folders by total size' `
+            (@($largest | ForEach-Object { Normalize-ComparePath $_.Name }) -join '|') `
+            ((@($rankingRoot, (Join-Path $rankingRoot 'steady'), (Join-Path $rankingRoot 'grows')) | ForEach-Object { Normalize-ComparePath $_ }) -join '|')
+        Assert-Equal $ctx 'Largest folder values' (@($largest | ForEach-Object { $_.Value }) -join '|') '3000|2000|1000'
+        Assert-Equal $ctx 'First session has nothing to grow from' @($first | Where-Object Description -eq $growthTitle).Count 0
+
+        [System.IO.File]::WriteAllBytes((Join-Path $rankingRoot 'grows\second.bin'), [byte[]]::new(3000))
+        $secondPath = Join-Path $workRoot 'folder-rankings-second.json'
+        $run = Invoke-WinDirStatCsv -Exe $testExe -Csv $secondPath -Root $rankingRoot -Folders
+        $second = @(ConvertFrom-JsonItems -Json (Get-Content -LiteralPath $secondPath -Raw -Encoding UTF8))
+        $growth = @($second | Where-Object Description -eq $growthTitle)
+        Assert-SetEqual $ctx 'Only the grown folder and its parent are listed' `
+            -Actual @($growth | ForEach-Object { Normalize-ComparePath $_.Name }) `
+            -Expected @($rankingRoot, (Join-Path $rankingRoot 'grows') | ForEach-Object { Normalize-ComparePath $_ })
+        Assert-True $ctx 'Growth is the bytes added since the previous session' (@($growth | Where-Object { $_.Value -ne 3000 }).Count -eq 0)
+
+        [pscustomobject] @{ CommandLine = $run.CommandLine; ElapsedSeconds = $run.ElapsedSeconds }
+    }))
+
     $failed = @($results | Where-Object { $_.Status -eq 'FAIL' })
     $warned = @($results | Where-Object { $_.Status -eq 'WARN' })
     Write-Host ''
@@ -14084,6 +15066,10 @@ function Invoke-CliSuite {
         $missingLoad = Join-Path $workRoot 'missing-load.csv'
         $ignoredLoadRoot = Join-Path $workRoot 'ignored-load-root.csv'
         $emptyRootOut = Join-Path $workRoot 'empty-root.csv'
+        $noQueryOut = Join-Path $workRoot 'no-query.csv'
+        $badQueryOut = Join-Path $workRoot 'bad-query.csv'
+        $noRootFoldersOut = Join-Path $workRoot 'no-root-folders.csv'
+        $noRootStatsOut = Join-Path $workRoot 'no-root-stats.csv'
         $rejectedInvocations = @(
             [pscustomobject] @{
                 Label = 'Quiet file export without a scan root'
@@ -14100,6 +15086,26 @@ function Invoke-CliSuite {
                 Arguments = @('/savepermsto', $noRootPermsOut)
                 Outputs = @($noRootPermsOut)
             },
+            [pscustomobject] @{
+                Label = 'Quiet query export without a query'
+                Arguments = @('/savequeryto', $noQueryOut, $rootOne)
+                Outputs = @($noQueryOut)
+            },
+            [pscustomobject] @{
+                Label = 'Quiet query export with an invalid query'
+                Arguments = @('/savequeryto', $badQueryOut, '/query', 'size > lots', $rootOne)
+                Outputs = @($badQueryOut)
+            },
+            [pscustomobject] @{
+                Label = 'Quiet folder rankings export without a scan root'
+                Arguments = @('/savefoldersto', $noRootFoldersOut)
+                Outputs = @($noRootFoldersOut)
+            },
+            [pscustomobject] @{
+                Label = 'Quiet statistics export without a scan root'
+                Arguments = @('/savestatsto', $noRootStatsOut)
+                Outputs = @($noRootStatsOut)
+            },
             [pscustomobject] @{
                 Label = 'Quiet export flag without an output value'
                 Arguments = @($rootOne, '/saveto')
@@ -14209,6 +15215,90 @@ function Invoke-CliSuite {
         catch {
             Assert-Fail $g 'Multiple-folder quiet invocation is handled' $_.Exception.Message
         }
+
+        # Scan statistics are the release-build view of the phase timings, so
+        # every phase must be reported and the JSON form must match the CSV.
+        Write-GroupHeader 'CLI scan statistics export'
+        $g = 'Cli/ScanStatistics'
+        $statsCsv = Join-Path $workRoot 'statistics.csv'
+        $statsJson = Join-Path $workRoot 'statistics.json'
+        $expectedStatistics = @(
+            'EnumerateMilliseconds', 'FinalizeMilliseconds', 'FilterMilliseconds', 'FolderRankingMilliseconds',
+            'NameIndexMilliseconds', 'NameIndexBytes', 'HashMilliseconds', 'HashCacheHits', 'HashCacheMisses',
+            'HashCacheNanosecondsPerLookup', 'HashBytesPerConfirmed', 'HashBytesPerRejected', 'PartialDupeMilliseconds', 'PartialDupeBytes', 'TeardownBytesReleased'
+        )
+        try {
+            $csvProbe = Invoke-CliProbe -Arguments @('/savestatsto', $statsCsv, $rootOne)
+            $jsonProbe = Invoke-CliProbe -Arguments @('/savestatsto', $statsJson, $rootOne)
+            if ($csvProbe.TimedOut -or $jsonProbe.TimedOut) {
+                Assert-Fail $g 'Statistics export terminates' "Timed out: $($csvProbe.CommandLine)"
+            }
+            elseif ($csvProbe.ExitCode -ne 0 -or $jsonProbe.ExitCode -ne 0) {
+                Assert-Fail $g 'Statistics export succeeds' "Exit codes: $($csvProbe.ExitCode), $($jsonProbe.ExitCode)"
+            }
+            else {
+                $csvRows = @(Import-Csv -LiteralPath $statsCsv)
+                $json = Get-Content -LiteralPath $statsJson -Raw | ConvertFrom-Json
+                $checks = [ordered] @{
+                    'CSV reports every statistic in order' = ($csvRows.Name -join ',') -ceq ($expectedStatistics -join ',')
+                    'JSON reports every statistic in order' = ($json.PSObject.Properties.Name -join ',') -ceq ($expectedStatistics -join ',')
+                    'CSV statistics are unsigned integers' = @($csvRows | Where-Object { $_.Value -notmatch '^\d+$' }).Count -eq 0
+                    'Name index memory is reported' = [long] $json.NameIndexBytes -gt 0
+                }
+                foreach ($check in $checks.GetEnumerator()) {
+                    if ($check.Value) { Assert-Pass $g $check.Key }
+                    else { Assert-Fail $g $check.Key "CSV: $($csvRows.Name -join ','); JSON: $($json.PSObject.Properties.Name -join ',')" }
+                }
+            }
+        }
+        catch {
+            Assert-Fail $g 'Statistics export is handled' $_.Exception.Message
+        }
+
+        # ----- persistent hash cache round trip ---------------------------
+        $g = 'Cli/HashCache'
+        $dupeRoot = Join-Path $workRoot 'dupes'
+        $cacheFile = Join-Path $runRoot 'WinDirStat.hashcache'
+        $cacheStatsJson = Join-Path $workRoot 'cache-statistics.json'
+        try {
+            New-Item -ItemType Directory -Force -Path $dupeRoot | Out-Null
+            foreach ($index in 1..4) {
+                New-TestFile -Path (Join-Path $dupeRoot "copy$index.bin") -Size 262144 -Seed 71
+            }
+            Remove-Item -LiteralPath $cacheFile -Force -ErrorAction SilentlyContinue
+            $sections.DupeView.ScanForDuplicates = 1
+            Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections $sections
+
+            # The first scan fills the cache and the second must answer every hash from it
+            $runs = foreach ($run in 1..2) {
+                $probe = Invoke-CliProbe -Arguments @('/savestatsto', $cacheStatsJson, $dupeRoot) -TimeoutMs 60000
+                if (-not $probe.Completed -or $probe.ExitCode -ne 0) {
+                    Assert-Fail $g "Statistics export succeeds on run $run" "Exit code: $($probe.ExitCode); $($probe.CommandLine)"
+                    break
+                }
+                Get-Content -LiteralPath $cacheStatsJson -Raw | ConvertFrom-Json
+            }
+            if (@($runs).Count -eq 2) {
+                $checks = [ordered] @{
+                    'Cache file is written after the first scan' = Test-Path -LiteralPath $cacheFile
+                    'First scan misses the empty cache' = [long] $runs[0].HashCacheMisses -gt 0
+                    'Second scan hits the cache' = [long] $runs[1].HashCacheHits -gt 0
+                    'Second scan has no misses' = [long] $runs[1].HashCacheMisses -eq 0
+                }
+                $timing = 'lookup {0} ns cold, {1} ns warm' -f $runs[0].HashCacheNanosecondsPerLookup, $runs[1].HashCacheNanosecondsPerLookup
+                foreach ($check in $checks.GetEnumerator()) {
+                    if ($check.Value) { Assert-Pass $g $check.Key $timing }
+                    else { Assert-Fail $g $check.Key "Run 1: $($runs[0] | ConvertTo-Json -Compress); Run 2: $($runs[1] | ConvertTo-Json -Compress)" }
+                }
+            }
+        }
+        catch {
+            Assert-Fail $g 'Hash cache round trip is handled' $_.Exception.Message
+        }
+        finally {
+            $sections.DupeView.ScanForDuplicates = 0
+            Write-PortableIni -Path (Join-Path $runRoot 'WinDirStat.ini') -Sections $sections
+        }
     }
     finally {
         Remove-TestArtifacts -Path $workRoot
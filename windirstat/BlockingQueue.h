@@ -141,6 +141,18 @@ public:
         m_pushed.notify_one();
     }
 
+    bool HasQueued()
+    {
+        std::scoped_lock lock(m_mutex);
+        return !m_queue.empty();
+    }
+
+    bool IsSuspended()
+    {
+        std::scoped_lock lock(m_mutex);
+        return m_suspended;
+    }
+
     void WaitIfSuspended()
     {
         // wait until not suspended or its cancelled
@@ -179,7 +191,7 @@ public:
         for (auto& thread : m_threads)
         {
             if (thread.joinable())
-                CancelSynchronousIo(thread.native_handle());
+                ::CancelThreadIo(thread.native_handle());
         }
     }
 
@@ -0,0 +1,92 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// CBoundedHeap. Keeps the values with the largest keys seen so far, up to a
+// fixed count, in a min-heap so each further value costs one comparison with
+// the smallest kept key. Keys are taken once per value and stored beside it,
+// and values are only appended until the count is reached, so a heap that
+// never fills costs nothing beyond the final sort. Heaps filled on separate
+// threads are combined with Merge and read back largest first with Take.
+//
+template<typename T, typename Key>
+class CBoundedHeap final
+{
+public:
+
+    using KeyType = std::remove_cvref_t<std::invoke_result_t<const Key&, const T&>>;
+
+    CBoundedHeap(const size_t capacity, Key key) : m_key(std::move(key)), m_capacity(capacity) {}
+
+    size_t Size() const noexcept { return m_entries.size(); }
+    bool IsFull() const noexcept { return m_entries.size() >= m_capacity; }
+
+    // Smallest kept key; only meaningful once the heap is full
+    const KeyType& MinimumKey() const { return m_entries.front().first; }
+
+    // Returns whether the value was kept
+    bool Push(T value)
+    {
+        KeyType key = std::invoke(m_key, std::as_const(value));
+        return Push(std::move(key), std::move(value));
+    }
+
+    void Merge(CBoundedHeap&& other)
+    {
+        for (auto& [key, value] : other.m_entries) Push(std::move(key), std::move(value));
+        other.m_entries.clear();
+    }
+
+    std::vector<T> Take()
+    {
+        std::ranges::sort(m_entries, std::greater(), &Entry::first);
+        std::vector<T> values;
+        values.reserve(m_entries.size());
+        for (auto& entry : m_entries) values.push_back(std::move(entry.second));
+        m_entries.clear();
+        return values;
+    }
+
+private:
+
+    using Entry = std::pair<KeyType, T>;
+
+    bool Push(KeyType&& key, T&& value)
+    {
+        if (m_capacity == 0) return false;
+        if (!IsFull())
+        {
+            m_entries.emplace_back(std::move(key), std::move(value));
+            if (IsFull()) std::ranges::make_heap(m_entries, std::greater(), &Entry::first);
+            return true;
+        }
+
+        if (!(key > MinimumKey())) return false;
+        std::ranges::pop_heap(m_entries, std::greater(), &Entry::first);
+        m_entries.back() = { std::move(key), std::move(value) };
+        std::ranges::push_heap(m_entries, std::greater(), &Entry::first);
+        return true;
+    }
+
+    Key m_key;
+    size_t m_capacity = 0;
+    std::vector<Entry> m_entries;
+};
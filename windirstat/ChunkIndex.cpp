@@ -0,0 +1,197 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "ChunkIndex.h"
+#include "OverlappedReader.h"
+
+namespace
+{
+    // Random per-byte values for the gear hash, fixed so boundaries are stable across runs
+    constexpr auto GEAR_TABLE = []
+    {
+        std::array<ULONGLONG, 256> table{};
+        ULONGLONG state = 0x9E3779B97F4A7C15ull;
+        for (auto& value : table)
+        {
+            ULONGLONG z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }();
+
+    // Normalized chunking: a stricter mask before the average size and a looser one after it
+    constexpr ULONGLONG MASK_STRICT = ((1ull << 18) - 1) << 40;
+    constexpr ULONGLONG MASK_LOOSE = ((1ull << 14) - 1) << 44;
+
+    constexpr ULONGLONG SampleMask(const ULONG shift) { return (1ull << shift) - 1; }
+}
+
+size_t CChunkIndex::FindBoundary(const std::span<const BYTE> data, const bool final)
+{
+    // Returns the length of the next chunk or zero if more data is needed to place the cut
+    const size_t size = data.size();
+    if (size <= MIN_CHUNK_SIZE) return final ? size : 0;
+
+    const size_t normal = std::min<size_t>(AVG_CHUNK_SIZE, size);
+    const size_t limit = std::min<size_t>(MAX_CHUNK_SIZE, size);
+    ULONGLONG hash = 0;
+    size_t i = MIN_CHUNK_SIZE;
+    for (; i < normal; i++)
+    {
+        hash = (hash << 1) + GEAR_TABLE[data[i]];
+        if ((hash & MASK_STRICT) == 0) return i + 1;
+    }
+    for (; i < limit; i++)
+    {
+        hash = (hash << 1) + GEAR_TABLE[data[i]];
+        if ((hash & MASK_LOOSE) == 0) return i + 1;
+    }
+
+    return limit == MAX_CHUNK_SIZE || final ? limit : 0;
+}
+
+bool CChunkIndex::AddFile(CItem* item, const std::atomic<bool>& cancel)
+{
+    if (item->IsTypeOrFlag(ITF_MTP)) return false;
+
+    // Whole files are read once so they bypass the file cache like full hashes do
+    COverlappedReader reader(item->GetPathLongRef(), 0, item->GetSizeLogical(), COptions::HashReadQueueDepth, true);
+    if (!reader.IsOpen()) return false;
+
+    // Chunks may straddle reads so unconsumed bytes carry over to the next one
+    std::vector<std::pair<ULONGLONG, ULONG>> sampled;
+    std::vector<BYTE> pending;
+    pending.reserve(MAX_CHUNK_SIZE + COverlappedReader::BUFFER_SIZE);
+    const auto cutChunks = [&](const bool final)
+    {
+        const ULONGLONG mask = SampleMask(m_sampleShift);
+        std::span<const BYTE> rest(pending);
+        for (size_t cut; !rest.empty() && (cut = FindBoundary(rest, final)) != 0; rest = rest.subspan(cut))
+        {
+            // Runs of one byte value, such as zeroed blocks, match between unrelated files
+            const auto chunk = rest.first(cut);
+            if (const ULONGLONG hash = XXH3_64bits(chunk.data(), chunk.size()); (hash & mask) == 0 &&
+                std::ranges::adjacent_find(chunk, std::ranges::not_equal_to{}) != chunk.end())
+                sampled.emplace_back(hash, static_cast<ULONG>(cut));
+        }
+        pending.erase(pending.begin(), pending.end() - static_cast<std::ptrdiff_t>(rest.size()));
+    };
+
+    ULONGLONG bytesRead = 0;
+    for (std::span<const BYTE> data; SUCCEEDED(reader.Next(data)) && !data.empty();)
+    {
+        if (cancel) return false;
+        pending.insert(pending.end(), data.begin(), data.end());
+        bytesRead += data.size();
+        cutChunks(false);
+    }
+    if (bytesRead != item->GetSizeLogical()) return false;
+    cutChunks(true);
+    m_bytes += bytesRead;
+
+    // Chunks repeated within the file only count once
+    std::ranges::sort(sampled);
+    const auto [first, last] = std::ranges::unique(sampled, {}, &std::pair<ULONGLONG, ULONG>::first);
+    sampled.erase(first, last);
+
+    std::scoped_lock lock(m_mutex);
+    const auto fileIndex = static_cast<ULONG>(m_files.size());
+    m_files.emplace_back(item);
+    for (const auto& [hash, chunkSize] : sampled)
+    {
+        if ((hash & SampleMask(m_sampleShift)) != 0) continue;
+
+        auto& posting = m_index[hash];
+        posting.chunkSize = chunkSize;
+        if (posting.files.size() < MAX_POSTINGS) posting.files.emplace_back(fileIndex);
+        else posting.common = true;
+
+        // Halve the sampling rate until the index fits again
+        while (m_index.size() > MAX_INDEXED_CHUNKS)
+        {
+            const ULONGLONG mask = SampleMask(++m_sampleShift);
+            std::erase_if(m_index, [mask](const auto& entry) { return (entry.first & mask) != 0; });
+        }
+    }
+    return true;
+}
+
+std::vector<CChunkIndex::SharedPair> CChunkIndex::GetSharedFiles(const double minFraction) const
+{
+    std::scoped_lock lock(m_mutex);
+
+    // File indexes are appended in order so each posting list is already sorted;
+    // common chunks are skipped, which also bounds the pairs one chunk adds
+    std::unordered_map<ULONGLONG, ULONGLONG> pairBytes;
+    for (const auto& [chunkSize, common, files] : m_index | std::views::values)
+    {
+        if (common) continue;
+        for (size_t i = 0; i < files.size(); i++)
+            for (size_t j = i + 1; j < files.size(); j++)
+                pairBytes[static_cast<ULONGLONG>(files[i]) << 32 | files[j]] += chunkSize;
+    }
+
+    std::vector<SharedPair> shared;
+    for (const auto& [pair, bytes] : pairBytes)
+    {
+        CItem* first = m_files[pair >> 32];
+        CItem* second = m_files[pair & 0xFFFFFFFF];
+        const ULONGLONG smaller = std::min(first->GetSizeLogical(), second->GetSizeLogical());
+        const ULONGLONG estimate = std::min(bytes << m_sampleShift, smaller);
+        if (estimate > 0 && static_cast<double>(estimate) >= minFraction * static_cast<double>(smaller))
+            shared.push_back({ first, second, estimate });
+    }
+
+    std::ranges::sort(shared, std::greater{}, &SharedPair::sharedBytes);
+    return shared;
+}
+
+std::vector<CChunkIndex::SharedPair> CChunkIndex::GetSharedFolders(const std::vector<SharedPair>& files, const ULONGLONG minShared)
+{
+    // Only folders linked by more than one file pair are worth reporting on their own
+    std::map<std::pair<CItem*, CItem*>, std::pair<ULONGLONG, size_t>> folderBytes;
+    for (const auto& [first, second, sharedBytes] : files)
+    {
+        CItem* firstFolder = first->GetParent();
+        CItem* secondFolder = second->GetParent();
+        if (firstFolder == secondFolder) continue;
+        if (firstFolder > secondFolder) std::swap(firstFolder, secondFolder);
+
+        auto& [bytes, count] = folderBytes[{ firstFolder, secondFolder }];
+        bytes += sharedBytes;
+        count++;
+    }
+
+    std::vector<SharedPair> shared;
+    for (const auto& [folders, totals] : folderBytes)
+    {
+        if (totals.second < 2 || totals.first < minShared) continue;
+        shared.push_back({ folders.first, folders.second, totals.first });
+    }
+
+    std::ranges::sort(shared, std::greater{}, &SharedPair::sharedBytes);
+    return shared;
+}
+
+CChunkIndex::Statistics CChunkIndex::GetStatistics() const
+{
+    std::scoped_lock lock(m_mutex);
+    return { m_files.size(), m_bytes.load(), m_index.size(), m_sampleShift.load() };
+}
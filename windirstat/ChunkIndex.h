@@ -0,0 +1,84 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// CChunkIndex. Splits files into content-defined chunks with a FastCDC style
+// gear hash and indexes a sample of the chunk hashes to estimate how many
+// bytes pairs of files share. Only chunks whose hash has its low bits clear
+// are kept; the number of bits grows whenever the index fills up, so memory
+// stays bounded and estimates are scaled back up by the sampling rate.
+// Chunks of a single repeated byte and chunks found in many files, such as
+// zeroed blocks and common headers, are not used to pair files.
+//
+class CChunkIndex final
+{
+public:
+
+    static constexpr ULONG MIN_CHUNK_SIZE = 16 * wds::Ki;
+    static constexpr ULONG AVG_CHUNK_SIZE = 64 * wds::Ki;
+    static constexpr ULONG MAX_CHUNK_SIZE = 256 * wds::Ki;
+
+    struct SharedPair
+    {
+        CItem* first;
+        CItem* second;
+        ULONGLONG sharedBytes; // Estimated from the sampled chunks
+    };
+
+    struct Statistics
+    {
+        ULONGLONG files = 0;
+        ULONGLONG bytes = 0;         // Content bytes chunked
+        ULONGLONG indexedChunks = 0; // Sampled chunks currently held
+        ULONG sampleShift = 0;       // One in 2^shift chunks is indexed
+    };
+
+    // Chunks the whole file; returns false if it could not be read or was cancelled
+    bool AddFile(CItem* item, const std::atomic<bool>& cancel);
+
+    // File pairs sharing at least the given fraction of the smaller file
+    std::vector<SharedPair> GetSharedFiles(double minFraction) const;
+
+    // Sums file pairs by containing folders; pairs within one folder are not counted
+    static std::vector<SharedPair> GetSharedFolders(const std::vector<SharedPair>& files, ULONGLONG minShared);
+
+    Statistics GetStatistics() const;
+
+private:
+
+    static constexpr size_t MAX_INDEXED_CHUNKS = wds::Mi;
+    static constexpr size_t MAX_POSTINGS = 16; // Files tracked per chunk; chunks in more files carry no signal
+
+    struct Posting
+    {
+        ULONG chunkSize = 0;
+        bool common = false; // Seen in more than MAX_POSTINGS files
+        std::vector<ULONG> files;
+    };
+
+    static size_t FindBoundary(std::span<const BYTE> data, bool final);
+
+    mutable std::mutex m_mutex;
+    std::vector<CItem*> m_files;
+    std::unordered_map<ULONGLONG, Posting> m_index;
+    std::atomic<ULONG> m_sampleShift = 0;
+    std::atomic<ULONGLONG> m_bytes = 0;
+};
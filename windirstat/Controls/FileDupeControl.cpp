@@ -18,6 +18,7 @@
 #include "pch.h"
 #include "ItemDupe.h"
 #include "FileTreeView.h"
+#include "HashCache.h"
 
 CFileDupeControl::CFileDupeControl() : CTreeListControl(COptions::DupeViewColumnOrder.Ptr(), COptions::DupeViewColumnWidths.Ptr(), COptions::DupeViewColumnVisibility.Ptr(), LF_DUPELIST, false)
 {
@@ -29,7 +30,7 @@ bool CFileDupeControl::GetAscendingDefault(const int column)
     return column == COL_ITEMDUP_NAME || column == COL_ITEMDUP_LAST_CHANGE;
 }
 
-void CFileDupeControl::ProcessDuplicate(CItem* item, BlockingQueue<CItem*>* queue)
+void CFileDupeControl::ProcessDuplicate(CItem* item)
 {
     if (!COptions::ScanForDuplicates) return;
     if (item->IsTypeOrFlag(ITRP_CLOUD) && COptions::SkipDupeDetectionCloudLinks)
@@ -49,43 +50,103 @@ void CFileDupeControl::ProcessDuplicate(CItem* item, BlockingQueue<CItem*>* queu
         return;
     }
 
+    // Large files are compared by content chunks later regardless of their size matches
+    if (COptions::ScanForPartialDuplicates && item->GetSizeLogical() >= COptions::PartialDupeMinSizeMiB * wds::Mi)
+    {
+        std::scoped_lock lock(m_partialMutex);
+        m_partialCandidates.insert(item);
+    }
+
+    // First see if there's more than one size of this file since there is no need to
+    // hash if there is only a single file of this size
+    {
+        std::scoped_lock lock(m_sizeTrackerMutex);
+        auto& sizeBucket = m_sizeTracker[item->GetSizeLogical()];
+        sizeBucket.items.emplace_back(item);
+        if (sizeBucket.items.size() < 2) return;
+    }
+
+    // Hand the candidate to the hashing stage, waiting only if it has fallen far behind;
+    // candidates arriving while the stage is stopping stay pending for the next one
+    std::unique_lock lock(m_hashMutex);
+    m_hashChanged.wait(lock, [this] { return m_hashPending.size() < HASH_QUEUE_LIMIT || m_hashStopping; });
+    if (!m_hashPending.insert(item).second) return;
+    ++m_hashQueued;
+    if (!m_hashStopping) m_hashQueue.Push(item);
+}
+
+void CFileDupeControl::HashCandidate(CItem* item)
+{
     // Fetch the configuration information based on file size
     const auto size = item->GetSizeLogical();
-    auto [hashTracker, hashTrackerMutex, maxHashLevel] = [&]() -> std::tuple<std::map<std::vector<BYTE>, std::vector<CItem*>>&, std::mutex&, ITEMTYPE>
+    const ITEMTYPE maxHashLevel = MaxHashLevel(size);
+    auto [hashTracker, hashTrackerMutex] = [&]() -> std::tuple<HashTracker&, std::mutex&>
     {
-        if (size <= HashThreshold(ITHASH_SMALL)) return { m_trackerSmall, m_trackerSmallMutex, ITHASH_SMALL };
-        if (size > HashThreshold(ITHASH_MEDIUM)) return { m_trackerLarge, m_trackerLargeMutex, ITHASH_LARGE };
-        return { m_trackerMedium, m_trackerMediumMutex, ITHASH_MEDIUM };
+        if (maxHashLevel == ITHASH_SMALL) return { m_trackerSmall, m_trackerSmallMutex };
+        if (maxHashLevel == ITHASH_LARGE) return { m_trackerLarge, m_trackerLargeMutex };
+        return { m_trackerMedium, m_trackerMediumMutex };
     }();
 
-    // First see if there's more than one size of this file since there is no need to
-    // hash if there is only a single file of this size
+    // Hash the files at this size that no earlier candidate has claimed; a candidate
+    // requeued after an interrupted stage may already be behind the cursor
     std::vector<CItem*> hashSet;
     {
         std::scoped_lock lock(m_sizeTrackerMutex);
-        auto& sizeSetLookup = m_sizeTracker[size];
-        sizeSetLookup.emplace_back(item);
-        hashSet.assign(sizeSetLookup.begin(), sizeSetLookup.end());
-        if (sizeSetLookup.size() < 2) return;
+        auto& sizeBucket = m_sizeTracker[size];
+        hashSet.assign(sizeBucket.items.begin() + sizeBucket.claimed, sizeBucket.items.end());
+        sizeBucket.claimed = sizeBucket.items.size();
+        if (std::ranges::find(hashSet, item) == hashSet.end()) hashSet.push_back(item);
     }
 
     // Now we have multiple files of the same size, so we need to hash them
     ITEMTYPE hashLevel = ITHASH_SMALL;
-    std::map<std::vector<BYTE>, std::set<CItem*>> hashItemsWithDupes;
+    CFlatHashMap<DupeKey, std::pair<std::vector<BYTE>, std::vector<CItem*>>, DupeKeyHash> hashItemsWithDupes;
     for (std::unique_lock lock(hashTrackerMutex); !hashSet.empty();)
     {
-        // Work on a snapshot of the current set
-        std::set<CItem*> nextLevelSet;
-        for (auto* itemToHash : std::vector(hashSet))
+        std::vector<CItem*> nextLevelSet;
+        for (auto* itemToHash : hashSet)
         {
             // Skip if already marked as unhashable or hashed at this level
             if (itemToHash->IsTypeOrFlag(ITHASH_SKIP, hashLevel)) continue;
+
+            // Files already sharing data with an earlier candidate need no content reads
+            if (hashLevel == ITHASH_SMALL)
+            {
+                lock.unlock();
+                const bool shared = TrackSharedData(itemToHash);
+                lock.lock();
+                if (shared)
+                {
+                    itemToHash->SetFlag(ITHASH_SKIP);
+                    continue;
+                }
+            }
             itemToHash->SetFlag(hashLevel);
 
-            // Compute the hash for the file
+            // Compute the hash for the file; an interrupted read leaves it unhashed
             const auto hashSize = HashThreshold(hashLevel);
             lock.unlock();
-            auto hash = itemToHash->GetFileHash(hashSize, queue);
+            std::vector<BYTE> hash;
+            try
+            {
+                hash = itemToHash->GetFileHash(hashSize, &m_hashQueue, IsSampledLevel(size, hashLevel));
+
+                // A read cancelled by StopHashing is an interruption rather than an unreadable file
+                if (hash.empty())
+                {
+                    std::scoped_lock stopLock(m_hashMutex);
+                    if (m_hashStopping) throw std::exception(__FUNCTION__);
+                }
+            }
+            catch (...)
+            {
+                // Rewind so the next candidate of this size revisits the unfinished files
+                lock.lock();
+                itemToHash->SetFlag(hashLevel, true);
+                std::scoped_lock sizeLock(m_sizeTrackerMutex);
+                m_sizeTracker[size].claimed = 0;
+                throw;
+            }
             lock.lock();
 
             // Mark as bad if not hashable
@@ -96,27 +157,28 @@ void CFileDupeControl::ProcessDuplicate(CItem* item, BlockingQueue<CItem*>* queu
             }
 
             // Add this hash to the tracker
-            auto& entry = hashTracker[hash];
+            const DupeKey key(size, hash);
+            auto& entry = hashTracker[key];
             entry.emplace_back(itemToHash);
-            auto view = entry | std::views::filter([&](const CItem* x)
-                { return x->GetSizeLogical() == size; });
-            std::vector subset(view.begin(), view.end());
-            if (subset.size() < 2) continue;
+            if (entry.size() < 2) continue;
 
-            // See if this hash has duplicates
+            // Earlier members were forwarded when the entry first paired up
+            const auto newMembers = entry.size() == 2 ? std::span(entry) : std::span(entry).last(1);
             if (hashLevel == maxHashLevel)
             {
                 // Already at max level: record duplicates and stop
-                hashItemsWithDupes[hash].insert(subset.begin(), subset.end());
+                auto& [dupeHash, dupeItems] = hashItemsWithDupes[key];
+                if (dupeHash.empty()) dupeHash = std::move(hash);
+                dupeItems.insert(dupeItems.end(), newMembers.begin(), newMembers.end());
             }
             else
             {
                 // Schedule next-level hashing
-                nextLevelSet.insert(subset.begin(), subset.end());
+                nextLevelSet.insert(nextLevelSet.end(), newMembers.begin(), newMembers.end());
             }
         }
 
-        hashSet.assign(nextLevelSet.begin(), nextLevelSet.end());
+        hashSet = std::move(nextLevelSet);
         if (hashSet.empty()) break;
 
         // Determine the appropriate hash level for this item based on what's already been hashed
@@ -124,32 +186,434 @@ void CFileDupeControl::ProcessDuplicate(CItem* item, BlockingQueue<CItem*>* queu
             hashLevel == ITHASH_SMALL ? ITHASH_MEDIUM : ITHASH_LARGE);
     }
 
-    // Lock once and lookup dupeParent before iterating
-    if (hashItemsWithDupes.empty()) return;
+    if (!hashItemsWithDupes.empty())
+    {
+        // Sets wait for the folder analysis so those inside duplicate folders are never listed
+        if (COptions::ScanForDuplicateFolders)
+        {
+            std::scoped_lock folderLock(m_folderMutex);
+            for (auto& [key, dupes] : hashItemsWithDupes)
+            {
+                auto& [hash, files] = m_deferredSets[key];
+                if (hash.empty()) hash = dupes.first;
+                files.insert(dupes.second.begin(), dupes.second.end());
+            }
+        }
+        else
+        {
+            std::scoped_lock nodeLock(m_nodeTrackerMutex);
+            for (const auto& [key, dupes] : hashItemsWithDupes) AddDupeSet(key, dupes.first, dupes.second);
+        }
+    }
+
+    // Release any scan worker waiting on back-pressure
+    if (std::scoped_lock lock(m_hashMutex); m_hashPending.erase(item) > 0) ++m_hashCompleted;
+    m_hashChanged.notify_all();
+}
+
+void CFileDupeControl::AddDupeSet(const DupeKey& key, const std::vector<BYTE>& hash, const std::vector<CItem*>& items)
+{
+    // Caller holds m_nodeTrackerMutex
+    const auto nodeEntry = m_nodeTracker.find(key);
+    auto dupeParent = nodeEntry != m_nodeTracker.end() ? nodeEntry->second : nullptr;
+
+    if (dupeParent == nullptr)
+    {
+        // Create new root item to hold these duplicates
+        dupeParent = new CItemDupe(hash);
+        m_pendingListAdds.push(std::make_pair(nullptr, dupeParent));
+        m_nodeTracker.emplace(key, dupeParent);
+    }
+
+    // Add all items under the same parent
+    auto& hashParentNode = m_childTracker[dupeParent];
+    for (const auto& itemToAdd : items)
+    {
+        if (hashParentNode.contains(itemToAdd)) continue;
+        const auto dupeChild = new CItemDupe(itemToAdd);
+        m_pendingListAdds.push(std::make_pair(dupeParent, dupeChild));
+        hashParentNode.emplace(itemToAdd);
+    }
+}
+
+bool CFileDupeControl::TrackSharedData(CItem* item)
+{
+    // Returns true when the item is a further link or clone of an already tracked file;
+    // the first member of each set stays a hashing candidate and represents its data
+    const auto addToSet = [this, item](const SharedKey& key, const std::wstring& label)
+    {
+        std::scoped_lock lock(m_nodeTrackerMutex);
+        auto& members = m_sharedTracker[key];
+        if (std::ranges::find(members, item) != members.end()) return false;
+        members.emplace_back(item);
+        if (members.size() < 2) return false;
+
+        auto& sharedParent = m_sharedNodeTracker[key];
+        if (sharedParent == nullptr)
+        {
+            sharedParent = new CItemDupe(label);
+            m_pendingListAdds.push(std::make_pair(nullptr, sharedParent));
+        }
+
+        // Earlier members were added when the set first paired up
+        auto& sharedParentNode = m_childTracker[sharedParent];
+        for (CItem* member : members.size() == 2 ? std::span(members) : std::span(members).last(1))
+        {
+            if (!sharedParentNode.emplace(member).second) continue;
+            m_pendingListAdds.push(std::make_pair(sharedParent, new CItemDupe(member)));
+        }
+        return true;
+    };
+
+    const auto size = item->GetSizeLogical();
+    const auto volume = item->GetVolumeRoot();
+    if (!item->IsTypeOrFlag(ITF_MTP) && item->GetIndex() != 0 &&
+        addToSet({ volume, size, item->GetIndex(), false },
+            std::format(L"⧉ {} 0x{:016X}", Localization::Lookup(IDS_HARDLINKS_ITEM), item->GetIndex())))
+    {
+        return true;
+    }
+
+    // Block clones keep their own file ID but map to the same clusters
+    const ULONGLONG signature = item->GetExtentSignature();
+    return signature != 0 && addToSet({ volume, size, signature, true }, std::format(L"⧉ {:016X}", signature));
+}
+
+void CFileDupeControl::ScheduleRead(CItem* item)
+{
+    const CItem* volume = item->GetVolumeRoot();
+    const LONGLONG lcn = item->GetFirstLcn();
+    std::optional<bool> seekPenalty;
+    if (std::scoped_lock lock(m_hashMutex); m_hashSeekPenalty.contains(volume))
+        seekPenalty = m_hashSeekPenalty[volume];
+    if (!seekPenalty) seekPenalty = !item->IsTypeOrFlag(ITF_MTP) && HasSeekPenalty(volume->GetPath());
+
+    std::scoped_lock lock(m_hashMutex);
+    m_hashSeekPenalty.try_emplace(volume, *seekPenalty);
+    m_hashSchedule.Push(volume, lcn, item, *seekPenalty);
+}
+
+CChunkIndex::Statistics CFileDupeControl::AnalyzePartialDuplicates()
+{
+    std::vector<CItem*> candidates;
+    if (std::scoped_lock lock(m_partialMutex); true) candidates.assign(m_partialCandidates.begin(), m_partialCandidates.end());
+    if (!COptions::ScanForPartialDuplicates || candidates.size() < 2) return {};
+
+    // Candidates go through the drained hashing schedule so they are read in disk order
+    // and a rotational volume is still read by one worker at a time
+    for (CItem* item : candidates) ScheduleRead(item);
+
+    // One index is shared by all workers so its memory bound holds for the whole analysis;
+    // each worker takes whichever scheduled read is next rather than its own candidate
+    CChunkIndex index;
+    std::for_each(std::execution::par, candidates.begin(), candidates.end(), [&](CItem*)
+    {
+        CItem* item = nullptr;
+        if (std::unique_lock lock(m_hashMutex); true) m_hashChanged.wait(lock, [&]
+        {
+            if (m_partialCancel || m_hashSchedule.Empty()) return true;
+            item = m_hashSchedule.Pop().value_or(nullptr);
+            return item != nullptr;
+        });
+        if (item == nullptr) return;
+
+        if (!m_partialCancel) index.AddFile(item, m_partialCancel);
+        if (std::scoped_lock lock(m_hashMutex); true) m_hashSchedule.Release(item->GetVolumeRoot());
+        m_hashChanged.notify_all();
+    });
+    if (std::scoped_lock lock(m_hashMutex); true) m_hashSchedule.Clear();
+    if (m_partialCancel) return index.GetStatistics();
+
+    // Report file pairs first and then the folders they link
+    auto shared = index.GetSharedFiles(COptions::PartialDupeMinPercent / 100.0);
+    std::ranges::copy(CChunkIndex::GetSharedFolders(shared, COptions::PartialDupeMinSizeMiB * wds::Mi),
+        std::back_inserter(shared));
+
+    std::scoped_lock lock(m_partialMutex);
+    for (const auto& [first, second, sharedBytes] : shared)
+    {
+        const auto partialParent = new CItemDupe(L"≈ " + FormatBytes(sharedBytes), sharedBytes);
+        m_pendingListAdds.push(std::make_pair(nullptr, partialParent));
+        m_pendingListAdds.push(std::make_pair(partialParent, new CItemDupe(first)));
+        m_pendingListAdds.push(std::make_pair(partialParent, new CItemDupe(second)));
+        m_partialNodes.emplace_back(partialParent);
+    }
+
+    return index.GetStatistics();
+}
+
+std::optional<std::pair<CFileDupeControl::DupeKey, size_t>> CFileDupeControl::HashFolder(const CItem* folder,
+    const std::unordered_map<const CItem*, DupeKey>& fileKeys, FolderHashes& folderHashes)
+{
+    // Map references survive the insertions made while hashing subfolders
+    if (const auto it = folderHashes.find(folder); it != folderHashes.end()) return it->second;
+    auto& result = folderHashes[folder];
+
+    // Files are checked first since any file without a duplicate rules out the folder
+    std::vector<std::tuple<std::wstring, ULONGLONG, DupeKey>> entries;
+    size_t fileCount = 0;
+    for (const CItem* child : folder->GetChildren())
+    {
+        if (child->IsTypeOrFlag(IT_DIRECTORY)) continue;
+        if (!child->IsTypeOrFlag(IT_FILE)) return result;
+
+        const auto key = fileKeys.find(child);
+        if (key == fileKeys.end()) return result;
+        entries.emplace_back(child->GetName(), child->GetSizeLogical(), key->second);
+        fileCount++;
+    }
+
+    for (const CItem* child : folder->GetChildren())
+    {
+        if (!child->IsTypeOrFlag(IT_DIRECTORY)) continue;
+
+        const auto subfolder = HashFolder(child, fileKeys, folderHashes);
+        if (!subfolder) return result;
+        entries.emplace_back(child->GetName(), child->GetSizeLogical(), subfolder->first);
+        fileCount += subfolder->second;
+    }
+
+    // Hash the sorted (name, size, content hash) tuples so sibling order does not matter
+    std::ranges::sort(entries, {}, [](const auto& entry) -> const std::wstring& { return std::get<0>(entry); });
+    const SmartPointer state(XXH3_freeState, XXH3_createState());
+    if (!state.IsValid()) return result;
+    XXH3_128bits_reset(state);
+    for (const auto& [name, size, key] : entries)
+    {
+        XXH3_128bits_update(state, name.c_str(), (name.size() + 1) * sizeof(wchar_t));
+        XXH3_128bits_update(state, &size, sizeof(size));
+        XXH3_128bits_update(state, key.hash.data(), sizeof(key.hash));
+    }
+
+    XXH128_canonical_t digest;
+    XXH128_canonicalFromHash(&digest, XXH3_128bits_digest(state));
+    result.emplace(DupeKey(folder->GetSizeLogical(), digest.digest), fileCount);
+    return result;
+}
+
+size_t CFileDupeControl::AnalyzeDuplicateFolders()
+{
+    if (!COptions::ScanForDuplicateFolders) return 0;
+
+    // Results stand until items are removed or a new scan starts
+    if (std::scoped_lock lock(m_folderMutex); m_foldersAnalyzed) return m_folderNodes.size();
+
+    // Content hash of every file confirmed to have a duplicate, listed or held back
+    std::unordered_map<const CItem*, DupeKey> fileKeys;
+    if (std::scoped_lock lock(m_folderMutex); true)
+    {
+        for (const auto& [key, set] : m_deferredSets)
+            for (const CItem* file : set.second) fileKeys.emplace(file, key);
+    }
+    if (std::scoped_lock lock(m_nodeTrackerMutex); true)
+    {
+        for (const auto& [key, dupeParent] : m_nodeTracker)
+        {
+            if (const auto children = m_childTracker.find(dupeParent); children != m_childTracker.end())
+                for (const CItem* child : children->second) fileKeys.emplace(child, key);
+        }
+    }
+
+    // Hash folders bottom-up from each duplicate file; an ancestor of an unmatched folder cannot match
+    FolderHashes folderHashes;
+    for (const CItem* file : fileKeys | std::views::keys)
+    {
+        for (const CItem* folder = file->GetParent(); folder != nullptr && folder->IsTypeOrFlag(IT_DIRECTORY) &&
+            !folderHashes.contains(folder); folder = folder->GetParent())
+        {
+            if (!HashFolder(folder, fileKeys, folderHashes)) break;
+        }
+    }
+
+    std::unordered_map<DupeKey, std::vector<CItem*>, DupeKeyHash> folderSets;
+    for (const auto& [folder, folderHash] : folderHashes)
+    {
+        if (folderHash && folderHash->second > 0)
+            folderSets[folderHash->first].emplace_back(const_cast<CItem*>(folder));
+    }
+    std::erase_if(folderSets, [](const auto& pair) { return pair.second.size() < 2; });
+
+    // Only the outermost duplicate folders are listed; their contents match along with them
+    std::unordered_set<const CItem*> duplicated;
+    for (const auto& folders : folderSets | std::views::values)
+        duplicated.insert(folders.begin(), folders.end());
+
+    std::unordered_set<const CItem*> reported;
+    std::scoped_lock lock(m_folderMutex);
+    for (const auto& [key, folders] : folderSets)
+    {
+        std::vector<CItem*> outermost;
+        std::ranges::copy_if(folders, std::back_inserter(outermost),
+            [&](const CItem* folder) { return !duplicated.contains(folder->GetParent()); });
+        if (outermost.size() < 2) continue;
+
+        const auto folderParent = new CItemDupe(std::vector<BYTE>(
+            reinterpret_cast<const BYTE*>(key.hash.data()), reinterpret_cast<const BYTE*>(key.hash.data() + key.hash.size())));
+        m_pendingListAdds.push(std::make_pair(nullptr, folderParent));
+        for (CItem* folder : outermost) m_pendingListAdds.push(std::make_pair(folderParent, new CItemDupe(folder)));
+        m_folderNodes.emplace_back(folderParent);
+        reported.insert(outermost.begin(), outermost.end());
+    }
+
+    // Held back sets are listed unless they lie entirely within listed folders; sets
+    // that already have a node keep receiving their members
+    const auto isReported = [&](const CItem* file)
+    {
+        for (const CItem* folder = file->GetParent(); folder != nullptr; folder = folder->GetParent())
+            if (reported.contains(folder)) return true;
+        return false;
+    };
     std::scoped_lock nodeLock(m_nodeTrackerMutex);
-    for (const auto& [hash, itemsWithHash] : hashItemsWithDupes)
+    for (auto entry = m_deferredSets.begin(); entry != m_deferredSets.end();)
     {
-        const auto nodeEntry = m_nodeTracker.find(hash);
-        auto dupeParent = nodeEntry != m_nodeTracker.end() ? nodeEntry->second : nullptr;
+        const auto& [key, dupes] = *entry;
+        const auto& [hash, files] = dupes;
+        if (!m_nodeTracker.contains(key) && std::ranges::all_of(files, isReported))
+        {
+            ++entry;
+            continue;
+        }
+        AddDupeSet(key, hash, { files.begin(), files.end() });
+        entry = m_deferredSets.erase(entry);
+    }
+    m_foldersAnalyzed = true;
+
+    return m_folderNodes.size();
+}
 
-        if (dupeParent == nullptr)
+std::pair<ULONGLONG, ULONGLONG> CFileDupeControl::GetHashBytesPerOutcome()
+{
+    std::unordered_set<const CItem*> confirmed;
+    if (std::scoped_lock lock(m_nodeTrackerMutex); true)
+    {
+        for (const auto& children : m_childTracker | std::views::values)
+            confirmed.insert(children.begin(), children.end());
+    }
+    if (std::scoped_lock lock(m_folderMutex); true)
+    {
+        for (const auto& files : m_deferredSets | std::views::values)
+            confirmed.insert(files.second.begin(), files.second.end());
+    }
+
+    // Derive the content read by each candidate from the levels it was hashed at
+    std::array<ULONGLONG, 2> bytes{};
+    std::array<ULONGLONG, 2> counts{};
+    std::scoped_lock lock(m_sizeTrackerMutex);
+    for (const auto& [size, sizeBucket] : m_sizeTracker)
+    {
+        for (const CItem* candidate : sizeBucket.items)
         {
-            // Create new root item to hold these duplicates
-            dupeParent = new CItemDupe(hash);
-            m_pendingListAdds.push(std::make_pair(nullptr, dupeParent));
-            m_nodeTracker.emplace(hash, dupeParent);
+            if (!candidate->IsTypeOrFlag(ITHASH_SMALL)) continue;
+            const size_t outcome = confirmed.contains(candidate) ? 0 : 1;
+            for (const ITEMTYPE hashLevel : { ITHASH_SMALL, ITHASH_MEDIUM, ITHASH_LARGE })
+            {
+                if (candidate->IsTypeOrFlag(hashLevel)) bytes[outcome] += HashLevelBytes(size, hashLevel);
+            }
+            counts[outcome]++;
         }
+    }
+
+    return { bytes[0] / std::max(1ull, counts[0]), bytes[1] / std::max(1ull, counts[1]) };
+}
 
-        // Add all items under the same parent
-        for (const auto& itemToAdd : itemsWithHash)
+void CFileDupeControl::StartHashing()
+{
+    std::scoped_lock control(m_hashControlMutex);
+
+    // Candidates left pending by an interrupted stage are queued again
+    std::vector<CItem*> deferred;
+    {
+        std::scoped_lock lock(m_hashMutex);
+        m_hashStopping = false;
+        if (!COptions::ScanForDuplicates) m_hashPending.clear();
+        deferred.assign(m_hashPending.begin(), m_hashPending.end());
+        m_hashSchedule.Clear();
+        m_hashSeekPenalty.clear();
+        m_hashQueued = deferred.size();
+        m_hashCompleted = 0;
+    }
+    if (!COptions::ScanForDuplicates) return;
+
+    m_partialCancel = false;
+    CHashCache::Get()->ResetStatistics();
+    m_hashActive = true;
+    m_hashQueue.StartThreads(COptions::ScanningThreads, [this]
+    {
+        while (const auto candidate = m_hashQueue.Pop())
         {
-            auto& hashParentNode = m_childTracker[dupeParent];
-            if (hashParentNode.contains(itemToAdd)) continue;
-            const auto dupeChild = new CItemDupe(itemToAdd);
-            m_pendingListAdds.push(std::make_pair(dupeParent, dupeChild));
-            hashParentNode.emplace(itemToAdd);
+            // Locate each candidate as it arrives and only issue reads once no new
+            // candidates are waiting so every batch is swept in disk order
+            ScheduleRead(*candidate);
+
+            // A rotational volume is read by one worker at a time; the others move on to
+            // other volumes or wait for new candidates while its sweep continues
+            while (!m_hashQueue.HasQueued())
+            {
+                CItem* item = nullptr;
+                if (std::scoped_lock lock(m_hashMutex); true) item = m_hashSchedule.Pop().value_or(nullptr);
+                if (item == nullptr) break;
+
+                try
+                {
+                    HashCandidate(item);
+                }
+                catch (...)
+                {
+                    std::scoped_lock lock(m_hashMutex);
+                    m_hashSchedule.Release(item->GetVolumeRoot());
+                    throw;
+                }
+                if (std::scoped_lock lock(m_hashMutex); true) m_hashSchedule.Release(item->GetVolumeRoot());
+                m_hashQueue.WaitIfSuspended();
+            }
         }
+    });
+    for (CItem* item : deferred) m_hashQueue.Push(item);
+}
+
+void CFileDupeControl::StopHashing()
+{
+    std::scoped_lock control(m_hashControlMutex);
+
+    // Release producers first so scan workers can reach their own suspension point
+    m_partialCancel = true;
+    if (std::scoped_lock lock(m_hashMutex); true) m_hashStopping = true;
+    m_hashChanged.notify_all();
+
+    // Unfinished candidates stay in the pending set for the next stage
+    m_hashQueue.CancelThreadIo();
+    m_hashQueue.SuspendExecution();
+    m_hashQueue.CancelExecution();
+    m_hashActive = false;
+    if (std::scoped_lock lock(m_hashMutex); true) m_hashSchedule.Clear();
+
+    // A stopped scan never reaches the folder analysis so held back sets are listed as they are
+    if (std::scoped_lock folderLock(m_folderMutex); !m_foldersAnalyzed)
+    {
+        std::scoped_lock nodeLock(m_nodeTrackerMutex);
+        for (const auto& [key, dupes] : m_deferredSets)
+            AddDupeSet(key, dupes.first, { dupes.second.begin(), dupes.second.end() });
+        m_deferredSets.clear();
+    }
+
+    // Keep whatever was hashed before the interruption without holding up the caller
+    CHashCache::Get()->SaveInBackground();
+}
+
+bool CFileDupeControl::WaitForHashing()
+{
+    if (std::unique_lock lock(m_hashMutex); true)
+    {
+        m_hashChanged.wait(lock, [this] { return m_hashPending.empty() || m_hashStopping; });
+        if (m_hashStopping) return false;
     }
+
+    // Every candidate is hashed so the idle workers can be released
+    std::scoped_lock control(m_hashControlMutex);
+    m_hashQueue.CancelExecution();
+    m_hashActive = false;
+    CHashCache::Get()->SaveInBackground();
+    return true;
 }
 
 void CFileDupeControl::SortItems()
@@ -185,7 +649,11 @@ void CFileDupeControl::RemoveItem(CItem* item)
         if (qitem->IsTypeOrFlag(IT_FILE))
         {
             // Mark as all files as not being hashed anymore
-            std::erase(m_sizeTracker[qitem->GetSizeLogical()], qitem);
+            auto& sizeBucket = m_sizeTracker[qitem->GetSizeLogical()];
+            std::erase(sizeBucket.items, qitem);
+            sizeBucket.claimed = 0;
+            m_hashPending.erase(qitem);
+            m_partialCandidates.erase(qitem);
             qitem->SetHashType(ITHASH_NONE, false);
         }
         else if (!qitem->IsLeaf())
@@ -193,9 +661,9 @@ void CFileDupeControl::RemoveItem(CItem* item)
             std::ranges::copy(qitem->GetChildren(), std::back_inserter(queue));
         }
     }
-    std::erase_if(m_sizeTracker, [](const auto& pair)
+    erase_if(m_sizeTracker, [](const auto& pair)
     {
-        return pair.second.empty();
+        return pair.second.items.empty();
     });
 
     // Remove all unhashed files from hash trackers
@@ -211,65 +679,114 @@ void CFileDupeControl::RemoveItem(CItem* item)
         }
 
         // Cleanup empty structures
-        std::erase_if(*hashTracker, [](const auto& pair)
+        erase_if(*hashTracker, [](const auto& pair)
         {
             return pair.second.empty();
         });
     }
 
+    // Remove all unhashed files from shared data sets
+    for (auto& members : m_sharedTracker | std::views::values)
+    {
+        std::erase_if(members, [](const auto& member)
+        {
+            return !member->IsTypeOrFlag(ITHASH_MASK);
+        });
+    }
+    std::erase_if(m_sharedTracker, [](const auto& pair)
+    {
+        return pair.second.empty();
+    });
+
     // Cleanup any empty visual nodes in the list
     const ScopedRedrawPause lock(this);
-    for (auto nodeIter = m_nodeTracker.begin(); nodeIter != m_nodeTracker.end(); )
+    const auto cleanupNodes = [this](auto& nodeTracker)
     {
-        auto& [dupeParentKey, dupeParent] = *nodeIter;
-
-        // Remove from child tracker
-        auto& childItems = m_childTracker[dupeParent];
-        for (auto childItem = childItems.begin(); childItem != childItems.end(); )
+        for (auto nodeIter = nodeTracker.begin(); nodeIter != nodeTracker.end(); )
         {
-            // Nothing to do if still marked as hashed
-            if ((*childItem)->IsTypeOrFlag(ITHASH_MASK))
-            {
-                ++childItem;
-                continue;
-            }
+            auto& [dupeParentKey, dupeParent] = *nodeIter;
 
-            // Remove from child tracker and visual tree
-            bool foundVisualChild = false;
-            for (auto& visualChild : dupeParent->GetChildren())
+            // Remove from child tracker
+            auto& childItems = m_childTracker[dupeParent];
+            for (auto childItem = childItems.begin(); childItem != childItems.end(); )
             {
-                if (visualChild->GetLinkedItem() == *childItem)
+                // Nothing to do if still marked as hashed
+                if ((*childItem)->IsTypeOrFlag(ITHASH_MASK))
+                {
+                    ++childItem;
+                    continue;
+                }
+
+                // Remove from child tracker and visual tree
+                bool foundVisualChild = false;
+                for (auto& visualChild : dupeParent->GetChildren())
                 {
-                    dupeParent->RemoveDupeItemChild(visualChild);
-                    foundVisualChild = true;
-                    break;
+                    if (visualChild->GetLinkedItem() == *childItem)
+                    {
+                        dupeParent->RemoveDupeItemChild(visualChild);
+                        foundVisualChild = true;
+                        break;
+                    }
                 }
+
+                // Only erase from tracker when the visual child was actually removed;
+                // if no visual match exists (pending add not yet flushed), leave the
+                // tracker entry intact so it stays in sync with the visual tree.
+                if (foundVisualChild)
+                    childItem = childItems.erase(childItem);
+                else
+                    ++childItem;
+            }
+
+            // When only one child left, remove child item
+            if (dupeParent->GetChildren().size() == 1)
+            {
+                dupeParent->RemoveDupeItemChild(dupeParent->GetChildren().front());
             }
 
-            // Only erase from tracker when the visual child was actually removed;
-            // if no visual match exists (pending add not yet flushed), leave the
-            // tracker entry intact so it stays in sync with the visual tree.
-            if (foundVisualChild)
-                childItem = childItems.erase(childItem);
+            // When no children left, remove parent item
+            if (dupeParent->GetChildren().empty())
+            {
+                m_rootItem->RemoveDupeItemChild(dupeParent);
+                nodeIter = nodeTracker.erase(nodeIter);
+            }
             else
-                ++childItem;
+            {
+                ++nodeIter;
+            }
         }
+    };
+    cleanupNodes(m_nodeTracker);
+    cleanupNodes(m_sharedNodeTracker);
 
-        // When only one child left, remove child item
-        if (dupeParent->GetChildren().size() == 1)
+    // Partial results no longer reflect the tree so shown ones are dropped until the next analysis
+    const auto dropShown = [this](std::vector<CItemDupe*>& resultNodes)
+    {
+        std::erase_if(resultNodes, [this](CItemDupe* resultParent)
         {
-            dupeParent->RemoveDupeItemChild(dupeParent->GetChildren().front());
-        }
-
-        // When no children left, remove parent item
-        if (dupeParent->GetChildren().empty())
+            if (resultParent->GetParent() == nullptr) return false;
+            m_rootItem->RemoveDupeItemChild(resultParent);
+            return true;
+        });
+    };
+    if (std::scoped_lock partialLock(m_partialMutex); true) dropShown(m_partialNodes);
+    if (std::scoped_lock folderLock(m_folderMutex); true)
+    {
+        dropShown(m_folderNodes);
+        for (auto& files : m_deferredSets | std::views::values)
         {
-            m_rootItem->RemoveDupeItemChild(dupeParent);
-            nodeIter = m_nodeTracker.erase(nodeIter);
+            std::erase_if(files.second, [](const CItem* file) { return !file->IsTypeOrFlag(ITHASH_MASK); });
         }
-        else
+        erase_if(m_deferredSets, [](const auto& pair) { return pair.second.second.size() < 2; });
+
+        // Sets folded into the dropped folders are listed on their own again
+        if (m_foldersAnalyzed)
         {
-            ++nodeIter;
+            std::scoped_lock nodeLock(m_nodeTrackerMutex);
+            for (const auto& [key, dupes] : m_deferredSets)
+                AddDupeSet(key, dupes.first, { dupes.second.begin(), dupes.second.end() });
+            m_deferredSets.clear();
+            m_foldersAnalyzed = false;
         }
     }
     std::erase_if(m_childTracker, [](const auto& pair)
@@ -286,11 +803,19 @@ void CFileDupeControl::AfterDeleteAllItems()
     // Cleanup support lists
     m_pendingListAdds.clear();
     m_nodeTracker.clear();
+    m_sharedNodeTracker.clear();
+    m_sharedTracker.clear();
     m_trackerSmall.clear();
     m_trackerMedium.clear();
     m_trackerLarge.clear();
     m_sizeTracker.clear();
     m_childTracker.clear();
+    m_hashPending.clear();
+    m_partialCandidates.clear();
+    m_partialNodes.clear();
+    m_folderNodes.clear();
+    m_deferredSets.clear();
+    m_foldersAnalyzed = false;
 
     // Delete and recreate root item
     delete m_rootItem;
@@ -17,7 +17,10 @@
 
 #pragma once
 
+#include "ChunkIndex.h"
+#include "FlatHashMap.h"
 #include "ItemDupe.h"
+#include "ReadScheduler.h"
 #include "TreeListControl.h"
 
 class CFileDupeControl final : public CTreeListControl
@@ -28,28 +31,114 @@ public:
     bool GetAscendingDefault(int column) override;
     static CFileDupeControl* Get() { return m_singleton; }
     CItemDupe* GetRootItem() const { return m_rootItem; }
-    void ProcessDuplicate(CItem* item, BlockingQueue<CItem*>* queue);
+    void ProcessDuplicate(CItem* item);
     void RemoveItem(CItem* item);
     void SortItems() override;
     void AfterDeleteAllItems() override;
 
+    // Hashing stage fed by ProcessDuplicate; it runs on its own workers so
+    // enumeration never waits on file content reads
+    void StartHashing();
+    void StopHashing();
+    void SuspendHashing() { m_hashQueue.SuspendExecution(); }
+    void ResumeHashing() { m_hashQueue.ResumeExecution(); }
+    bool WaitForHashing();
+    bool IsHashing() const noexcept { return m_hashActive; }
+    std::pair<size_t, size_t> GetHashProgress() const noexcept { return { m_hashCompleted, m_hashQueued }; }
+    std::pair<ULONGLONG, ULONGLONG> GetHashBytesPerOutcome();
+
+    // Optional content-defined chunk comparison of large files, run once hashing has drained
+    CChunkIndex::Statistics AnalyzePartialDuplicates();
+
+    // Folders whose whole subtree matches another one, found from the file hashes once
+    // hashing has drained; returns the number of duplicate folder sets
+    size_t AnalyzeDuplicateFolders();
+
+    // Bucket key of file size plus the leading 128 bits of a content hash;
+    // shorter hashes are zero padded
+    struct DupeKey
+    {
+        ULONGLONG size = 0;
+        std::array<ULONGLONG, 2> hash{};
+
+        DupeKey(const ULONGLONG fileSize, const std::span<const BYTE> bytes) : size(fileSize)
+        {
+            std::memcpy(hash.data(), bytes.data(), std::min(bytes.size(), sizeof(hash)));
+        }
+
+        bool operator==(const DupeKey&) const = default;
+    };
+
+    struct DupeKeyHash
+    {
+        size_t operator()(const DupeKey& key) const noexcept
+        {
+            // Content hash bits are already well mixed
+            return static_cast<size_t>(key.hash[0] ^ key.hash[1] ^ (key.size * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    // Files of one size; entries before the cursor were already handed to hashing
+    struct SizeBucket
+    {
+        std::vector<CItem*> items;
+        size_t claimed = 0;
+    };
+
+    using HashTracker = CFlatHashMap<DupeKey, std::vector<CItem*>, DupeKeyHash>;
+
     std::mutex m_sizeTrackerMutex;
-    std::map<ULONGLONG, std::vector<CItem*>> m_sizeTracker;
+    CFlatHashMap<ULONGLONG, SizeBucket> m_sizeTracker;
     std::mutex m_trackerSmallMutex;
     std::mutex m_trackerMediumMutex;
     std::mutex m_trackerLargeMutex;
-    std::map<std::vector<BYTE>, std::vector<CItem*>> m_trackerSmall;
-    std::map<std::vector<BYTE>, std::vector<CItem*>> m_trackerMedium;
-    std::map<std::vector<BYTE>, std::vector<CItem*>> m_trackerLarge;
+    HashTracker m_trackerSmall;
+    HashTracker m_trackerMedium;
+    HashTracker m_trackerLarge;
+
+    // Files already sharing their data on disk, either as hardlinks of one file ID
+    // or as block clones with an identical extent map
+    struct SharedKey
+    {
+        const CItem* volume = nullptr;
+        ULONGLONG size = 0;
+        ULONGLONG identity = 0;
+        bool byExtents = false;
+
+        bool operator==(const SharedKey&) const = default;
+    };
+
+    struct SharedKeyHash
+    {
+        size_t operator()(const SharedKey& key) const noexcept
+        {
+            return std::hash<ULONGLONG>{}(key.identity ^ (key.size * 0x9E3779B97F4A7C15ull)) ^
+                std::hash<const CItem*>{}(key.volume) ^ static_cast<size_t>(key.byExtents);
+        }
+    };
 
     std::mutex m_nodeTrackerMutex;
-    std::map<std::vector<BYTE>, CItemDupe*> m_nodeTracker;
-    std::map<CItemDupe*, std::set<CItem*>> m_childTracker;
+    CFlatHashMap<DupeKey, CItemDupe*, DupeKeyHash> m_nodeTracker;
+    std::unordered_map<CItemDupe*, std::unordered_set<CItem*>> m_childTracker;
+    std::unordered_map<SharedKey, std::vector<CItem*>, SharedKeyHash> m_sharedTracker;
+    std::unordered_map<SharedKey, CItemDupe*, SharedKeyHash> m_sharedNodeTracker;
 
     SingleConsumerQueue<std::pair<CItemDupe*, CItemDupe*>> m_pendingListAdds;
 
 protected:
 
+    void HashCandidate(CItem* item);
+    void ScheduleRead(CItem* item);
+    bool TrackSharedData(CItem* item);
+    void AddDupeSet(const DupeKey& key, const std::vector<BYTE>& hash, const std::vector<CItem*>& items);
+
+    using FolderHashes = std::unordered_map<const CItem*, std::optional<std::pair<DupeKey, size_t>>>;
+    static std::optional<std::pair<DupeKey, size_t>> HashFolder(const CItem* folder,
+        const std::unordered_map<const CItem*, DupeKey>& fileKeys, FolderHashes& folderHashes);
+
+    // Outstanding candidates allowed before scan workers wait on the hashing stage
+    constexpr static size_t HASH_QUEUE_LIMIT = 64 * wds::Ki;
+
     constexpr static ULONGLONG HashThreshold(const ITEMTYPE hashLevel)
     {
         return
@@ -57,8 +146,51 @@ protected:
             hashLevel == ITHASH_MEDIUM ? wds::Mi : std::numeric_limits<ULONGLONG>::max();
     }
 
+    constexpr static ITEMTYPE MaxHashLevel(const ULONGLONG size)
+    {
+        return
+            size <= HashThreshold(ITHASH_SMALL) ? ITHASH_SMALL :
+            size <= HashThreshold(ITHASH_MEDIUM) ? ITHASH_MEDIUM : ITHASH_LARGE;
+    }
+
+    // Files that need a full hash are sampled at the medium level instead of reading a prefix
+    constexpr static bool IsSampledLevel(const ULONGLONG size, const ITEMTYPE hashLevel)
+    {
+        return hashLevel == ITHASH_MEDIUM && MaxHashLevel(size) == ITHASH_LARGE;
+    }
+
+    constexpr static ULONGLONG HashLevelBytes(const ULONGLONG size, const ITEMTYPE hashLevel)
+    {
+        return std::min(size, IsSampledLevel(size, hashLevel) ?
+            ULONGLONG{ CItem::HASH_SAMPLE_BLOCK_SIZE } * CItem::HASH_SAMPLE_BLOCKS : HashThreshold(hashLevel));
+    }
+
     inline static CFileDupeControl* m_singleton = nullptr;
     CItemDupe* m_rootItem = nullptr;
     bool m_showCloudWarningOnThisScan = COptions::ShowDupeDetectionCloudLinksWarning;
 
+    BlockingQueue<CItem*> m_hashQueue{ false };
+    std::mutex m_hashControlMutex;
+    std::mutex m_hashMutex;
+    std::condition_variable m_hashChanged;
+    std::unordered_set<CItem*> m_hashPending; // Candidates not yet hashed, kept across stops
+    ReadScheduler<const CItem*, CItem*> m_hashSchedule; // Located candidates in disk order
+    std::unordered_map<const CItem*, bool> m_hashSeekPenalty; // Volumes read by one worker at a time
+    std::atomic<size_t> m_hashQueued = 0;
+    std::atomic<size_t> m_hashCompleted = 0;
+    std::atomic<bool> m_hashActive = false;
+    bool m_hashStopping = false;
+
+    std::mutex m_partialMutex;
+    std::unordered_set<CItem*> m_partialCandidates; // Files large enough for partial analysis
+    std::vector<CItemDupe*> m_partialNodes;
+    std::atomic<bool> m_partialCancel = false;
+
+    std::mutex m_folderMutex;
+    std::vector<CItemDupe*> m_folderNodes;
+    bool m_foldersAnalyzed = false;
+    // Confirmed file sets held back until duplicate folders are known; afterwards only the
+    // sets lying entirely within listed folders remain here
+    CFlatHashMap<DupeKey, std::pair<std::vector<BYTE>, std::unordered_set<CItem*>>, DupeKeyHash> m_deferredSets;
+
 };
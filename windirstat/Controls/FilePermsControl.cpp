@@ -38,7 +38,8 @@ void CFilePermsControl::OnDestroy()
     CWdsListControl::OnDestroy();
 }
 
-std::vector<CItemPerm*> CFilePermsControl::ScanItem(const CItem* item, const bool includeInherited, const std::optional<std::wregex>& excludeRegex)
+std::vector<CItemPerm*> CFilePermsControl::ScanItem(const CItem* item, const bool includeInherited, const std::optional<std::wregex>& excludeRegex,
+    CItemPathBuilder& paths)
 {
     static GENERIC_MAPPING fileMapping =
         { FILE_GENERIC_READ, FILE_GENERIC_WRITE, FILE_GENERIC_EXECUTE, FILE_ALL_ACCESS };
@@ -47,7 +48,7 @@ std::vector<CItemPerm*> CFilePermsControl::ScanItem(const CItem* item, const boo
     std::vector<CItemPerm*> rows;
     SmartPointer sd(LocalFree, static_cast<PSECURITY_DESCRIPTOR>(nullptr));
     PACL dacl = nullptr;
-    if (GetNamedSecurityInfo(item->GetPathLong().c_str(), SE_FILE_OBJECT, DACL_SECURITY_INFORMATION,
+    if (GetNamedSecurityInfo(paths.GetLong(item).c_str(), SE_FILE_OBJECT, DACL_SECURITY_INFORMATION,
         nullptr, nullptr, &dacl, nullptr, &sd) != ERROR_SUCCESS || dacl == nullptr) return rows;
 
     // A protected DACL does not inherit from its parent (broken/disabled inheritance)
@@ -70,13 +71,23 @@ std::vector<CItemPerm*> CFilePermsControl::ScanItem(const CItem* item, const boo
 
         ACCESS_MASK mask = ace->Mask;
         MapGenericMask(&mask, &fileMapping);
-        rows.push_back(new CItemPerm(item->GetPath(), item->GetAttributes(), std::move(account), mask,
+        rows.push_back(new CItemPerm(paths.Get(item), item->GetAttributes(), std::move(account), mask,
             header->AceType == ACCESS_DENIED_ACE_TYPE, header->AceFlags, inheritanceDisabled));
     }
     return rows;
 }
 
-std::vector<const CItem*> CFilePermsControl::BuildScanList(const CItem* docRoot, std::unordered_set<const CItem*>& roots)
+bool CFilePermsControl::ScanAccept::operator()(const CItem* item) const noexcept
+{
+    return item->SupportsFilesystemApis() && item->IsTypeOrFlag(IT_DRIVE, IT_DIRECTORY, IT_FILE) && !item->IsTypeOrFlag(ITF_RESERVED);
+}
+
+bool CFilePermsControl::ScanDescend::operator()(const CItem* item) const noexcept
+{
+    return item->SupportsFilesystemApis();
+}
+
+CFilePermsControl::ScanRange CFilePermsControl::BuildScanList(const CItem* docRoot, std::unordered_set<const CItem*>& roots)
 {
     // Root-level items list every permission; deeper items only their explicit (non-inherited) ones
     // Exclude shell-only roots because security descriptor queries require filesystem paths
@@ -87,21 +98,12 @@ std::vector<const CItem*> CFilePermsControl::BuildScanList(const CItem* docRoot,
     }
     else if (docRoot->SupportsFilesystemApis()) roots.insert(docRoot);
 
-    // Snapshot every real-path item so worker threads never touch the live tree
-    std::vector<const CItem*> items;
-    std::vector stack{ docRoot };
-    while (!stack.empty())
-    {
-        const CItem* item = stack.back();
-        stack.pop_back();
-        if (!item->SupportsFilesystemApis()) continue;
-        if (!item->IsLeaf()) for (const CItem* child : item->GetChildren()) stack.push_back(child);
-        if (item->IsTypeOrFlag(IT_DRIVE, IT_DIRECTORY, IT_FILE) && !item->IsTypeOrFlag(ITF_RESERVED)) items.push_back(item);
-    }
-    return items;
+    // The tree is settled for the duration of the scan so it is walked in place
+    CItem* const root = const_cast<CItem*>(docRoot);
+    return ScanRange(std::span(&root, 1));
 }
 
-std::vector<CItemPerm*> CFilePermsControl::ScanItems(const std::vector<const CItem*>& items, const std::unordered_set<const CItem*>& roots,
+std::vector<CItemPerm*> CFilePermsControl::ScanItems(const ScanRange& items, const std::unordered_set<const CItem*>& roots,
     const std::function<bool()>& cancelled, const std::function<void()>& onItemDone)
 {
     // Compile the optional account exclusion expression (partial, case-insensitive match)
@@ -109,24 +111,40 @@ std::vector<CItemPerm*> CFilePermsControl::ScanItems(const std::vector<const CIt
     if (const std::wstring& pattern = COptions::PermsExcludeRegex.Obj(); !pattern.empty())
         try { excludeRegex.emplace(pattern, std::regex::icase | std::regex::optimize); } catch (const std::regex_error&) {}
 
-    // Pull items off a shared cursor across worker threads, joined before returning
+    // Pull batches off a shared traversal across worker threads, joined before returning
     std::vector<CItemPerm*> results;
     {
-        std::atomic<size_t> cursor = 0;
+        auto cursor = items.begin();
+        std::mutex cursorMutex;
         std::mutex resultsMutex;
         std::vector<std::jthread> workers;
         for (int t = 0, n = std::clamp<int>(COptions::ScanningThreads, 1, 16); t < n; t++)
         {
             workers.emplace_back([&]
             {
-                for (size_t i = cursor.fetch_add(1); i < items.size() && !cancelled(); i = cursor.fetch_add(1))
+                // Each worker keeps its own path builder; claimed batches stay clustered in scan order
+                CItemPathBuilder paths;
+                std::vector<const CItem*> batch;
+                batch.reserve(SCAN_BATCH_SIZE);
+                while (!cancelled())
                 {
-                    if (auto rows = ScanItem(items[i], roots.contains(items[i]), excludeRegex); !rows.empty())
+                    batch.clear();
+                    {
+                        std::scoped_lock lock(cursorMutex);
+                        for (; cursor != items.end() && batch.size() < SCAN_BATCH_SIZE; ++cursor) batch.push_back(*cursor);
+                    }
+                    if (batch.empty()) break;
+
+                    for (const CItem* item : batch)
                     {
-                        std::scoped_lock lock(resultsMutex);
-                        results.insert(results.end(), rows.begin(), rows.end());
+                        if (cancelled()) break;
+                        if (auto rows = ScanItem(item, roots.contains(item), excludeRegex, paths); !rows.empty())
+                        {
+                            std::scoped_lock lock(resultsMutex);
+                            results.insert(results.end(), rows.begin(), rows.end());
+                        }
+                        onItemDone();
                     }
-                    onItemDone();
                 }
             });
         }
@@ -153,7 +171,7 @@ bool CFilePermsControl::StartScan()
 
     // Scan in parallel under a modal progress dialog so large trees show progress
     std::vector<CItemPerm*> rows;
-    CProgressDlg progress(items.size(), CProgressDlg::Flags::None, CMainFrame::Get(), [&](CProgressDlg* pdlg)
+    CProgressDlg progress(static_cast<size_t>(std::ranges::distance(items)), CProgressDlg::Flags::None, CMainFrame::Get(), [&](CProgressDlg* pdlg)
     {
         rows = ScanItems(items, roots, [pdlg] { return pdlg->IsCancelled(); }, [pdlg] { pdlg->Increment(); });
     });
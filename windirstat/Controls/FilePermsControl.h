@@ -38,13 +38,22 @@ public:
 protected:
     inline static CFilePermsControl* m_singleton = nullptr;
 
-    // Collect the items to scan and flag those whose every ACE (incl. inherited) should be listed
-    static std::vector<const CItem*> BuildScanList(const CItem* docRoot, std::unordered_set<const CItem*>& roots);
+    // Real-path items; shell-only branches are skipped because security descriptor queries require filesystem paths
+    struct ScanAccept { bool operator()(const CItem* item) const noexcept; };
+    struct ScanDescend { bool operator()(const CItem* item) const noexcept; };
+    using ScanRange = CItemRange<ScanAccept, ScanDescend>;
+
+    // Number of items claimed from the shared traversal per lock
+    static constexpr size_t SCAN_BATCH_SIZE = 64;
+
+    // Lazily enumerate the items to scan and flag those whose every ACE (incl. inherited) should be listed
+    static ScanRange BuildScanList(const CItem* docRoot, std::unordered_set<const CItem*>& roots);
     // Scan items in parallel, reporting completion via onItemDone and honoring cancelled
-    static std::vector<CItemPerm*> ScanItems(const std::vector<const CItem*>& items, const std::unordered_set<const CItem*>& roots,
+    static std::vector<CItemPerm*> ScanItems(const ScanRange& items, const std::unordered_set<const CItem*>& roots,
         const std::function<bool()>& cancelled, const std::function<void()>& onItemDone);
     // Read one item's DACL and build a row per qualifying ACE; safe to call from worker threads
-    static std::vector<CItemPerm*> ScanItem(const CItem* item, bool includeInherited, const std::optional<std::wregex>& excludeRegex);
+    static std::vector<CItemPerm*> ScanItem(const CItem* item, bool includeInherited, const std::optional<std::wregex>& excludeRegex,
+        CItemPathBuilder& paths);
 
 public:
     static std::span<const RouteEntry> Routes();
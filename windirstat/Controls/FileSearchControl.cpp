@@ -18,6 +18,8 @@
 #include "pch.h"
 #include "ItemSearch.h"
 #include "FileTreeView.h"
+#include "NameIndex.h"
+#include "BoundedHeap.h"
 
 CFileSearchControl::CFileSearchControl() : CTreeListControl(COptions::SearchViewColumnOrder.Ptr(), COptions::SearchViewColumnWidths.Ptr(), COptions::SearchViewColumnVisibility.Ptr(), LF_SEARCHLIST, false)
 {
@@ -57,80 +59,187 @@ void CFileSearchControl::ProcessSearch(CItem* item,
     // Update tab visibility to show search tab if results exist
     CMainFrame::Get()->GetFileTabbedView()->SetSearchTabVisibility(true);
 
-    // Process search request using progress dialog
+    // Remove previous results
+    SetRootItem();
+    m_rootItem->SetLimitExceeded(false);
+
+    // Precompile regex string
+    const auto searchTermRegex = ComputeSearchRegex(searchTerm,
+        searchCase, searchRegex);
+
+    // Resolve from the name index when one covers the tree; otherwise walk it using progress dialog
+    const size_t maxResults = COptions::SearchMaxResults;
     std::vector<CItem*> matchedItems;
-    CProgressDlg(static_cast<size_t>(item->GetItemsCount()), CProgressDlg::Flags::None, GetMainWindow(),
-        [&](CProgressDlg* pdlg)
+    size_t matchCount = 0;
+    if (CNameIndex::Get()->Search(item, searchTerm, searchRegex, searchTermRegex,
+        searchWholePhrase, onlyFiles, matchedItems))
     {
-        // Remove previous results
-        SetRootItem();
-        m_rootItem->SetLimitExceeded(false);
+        matchCount = matchedItems.size();
+        if (matchedItems.size() > maxResults)
+        {
+            // Partial sort to get the top N items by logical size
+            std::ranges::partial_sort(matchedItems, matchedItems.begin() + maxResults,
+                std::ranges::greater{}, &CItem::GetSizeLogical);
+            matchedItems.resize(maxResults);
+        }
+    }
+    else
+    {
+        const int configuredThreads = COptions::SearchThreads;
+        const size_t threadCount = configuredThreads > 0 ?
+            configuredThreads : std::max(1u, std::thread::hardware_concurrency());
+        CProgressDlg(static_cast<size_t>(item->GetItemsCount()), CProgressDlg::Flags::None, GetMainWindow(),
+            [&](CProgressDlg* pdlg)
+        {
+            matchedItems = SearchTree(item, searchTermRegex, searchWholePhrase, onlyFiles, threadCount, pdlg, matchCount);
+        }).ShowModal();
+    }
+    m_rootItem->SetLimitExceeded(matchCount > maxResults);
 
-        // Precompile regex string
-        const auto searchTermRegex = ComputeSearchRegex(searchTerm,
-            searchCase, searchRegex);
+    // Add found items to the interface
+    CWaitCursor wait;
+    CollapseItem(0);
 
-        // Do search
-        std::vector queue{ item };
-        while (!queue.empty() && !pdlg->IsCancelled())
-        {
-            // Grab item from queue
-            pdlg->Increment();
-            CItem* qitem = queue.back();
-            queue.pop_back();
+    // Early results that larger matches displaced are dropped
+    const std::unordered_set<CItem*> kept(matchedItems.begin(), matchedItems.end());
+    const ScopedRedrawPause lock(this);
+    std::erase_if(m_itemTracker, [&](const auto& pair)
+    {
+        if (kept.contains(pair.first)) return false;
+        m_rootItem->RemoveSearchItemChild(pair.second);
+        return true;
+    });
+    AddResults(matchedItems);
 
-            // Check for match
-            if (!onlyFiles || qitem->IsTypeOrFlag(IT_FILE))
-            {
-                const auto nameView = qitem->GetNameView();
-                const bool isMatch = searchWholePhrase ?
-                    std::regex_match(nameView.begin(), nameView.end(), searchTermRegex) :
-                    std::regex_search(nameView.begin(), nameView.end(), searchTermRegex);
+    SortItems();
+    ExpandItem(0);
+}
 
-                if (isMatch)
-                {
-                    matchedItems.push_back(qitem);
-                }
-            }
+std::vector<CItem*> CFileSearchControl::SearchTree(CItem* item, const std::wregex& searchTermRegex,
+    const bool searchWholePhrase, const bool onlyFiles, const size_t threadCount, CProgressDlg* pdlg, size_t& matchCount)
+{
+    const ULONGLONG start = GetTickCount64();
+    const size_t maxResults = COptions::SearchMaxResults;
+
+    // The modal progress dialog is the only way to stop a walk; without one it runs to the end
+    const auto isCancelled = [pdlg] { return pdlg != nullptr && pdlg->IsCancelled(); };
+    const auto publish = [pdlg](size_t& counted)
+    {
+        if (pdlg != nullptr) pdlg->Increment(counted);
+        counted = 0;
+    };
+    const auto descend = [](const CItem* qitem) { return !qitem->IsLeaf() && !qitem->IsTypeOrFlag(IT_HLINKS); };
+    const auto isMatch = [&](const CItem* qitem)
+    {
+        if (onlyFiles && !qitem->IsTypeOrFlag(IT_FILE)) return false;
+        const auto nameView = qitem->GetNameView();
+        return searchWholePhrase ?
+            std::regex_match(nameView.begin(), nameView.end(), searchTermRegex) :
+            std::regex_search(nameView.begin(), nameView.end(), searchTermRegex);
+    };
+
+    // Each thread keeps its own largest matches; the extra heap belongs to this thread
+    using ResultHeap = CBoundedHeap<CItem*, decltype(&CItem::GetSizeLogical)>;
+    std::vector heaps(threadCount + 1, ResultHeap(maxResults, &CItem::GetSizeLogical));
+    std::atomic<size_t> matches = 0;
+    std::mutex streamMutex;
+    std::vector<CItem*> streamed;
+    const auto record = [&](ResultHeap& heap, CItem* qitem)
+    {
+        heap.Push(qitem);
 
-            // Descend into child items
-            if (qitem->IsLeaf() || qitem->IsTypeOrFlag(IT_HLINKS)) continue;
-            for (const auto& child : qitem->GetChildren())
+        // Only results that fit the list are shown early; larger ones found later may displace them
+        if (matches.fetch_add(1, std::memory_order_relaxed) >= maxResults || Get() == nullptr) return;
+        std::scoped_lock lock(streamMutex);
+        streamed.push_back(qitem);
+    };
+
+    // Split the tree level by level until every thread has plenty of subtrees to take
+    std::vector units{ item };
+    size_t splitCounted = 0;
+    for (std::vector<CItem*> next; units.size() < threadCount * 16 && std::ranges::any_of(units, descend); units.swap(next))
+    {
+        next.clear();
+        for (CItem* unit : units)
+        {
+            if (!descend(unit))
             {
-                queue.push_back(child);
+                next.push_back(unit);
+                continue;
             }
+
+            splitCounted++;
+            if (isMatch(unit)) record(heaps.back(), unit);
+            next.insert(next.end(), unit->GetChildren().begin(), unit->GetChildren().end());
         }
+    }
 
-        // Sort by physical size (largest first) and take top N results
-        const size_t maxResults = COptions::SearchMaxResults;
-        if (matchedItems.size() > maxResults)
+    publish(splitCounted);
+
+    std::atomic<size_t> nextUnit = 0;
+    std::atomic<size_t> running = threadCount;
+    std::mutex doneMutex;
+    std::condition_variable done;
+    {
+        std::vector<std::jthread> workers;
+        for (size_t thread = 0; thread < threadCount; thread++) workers.emplace_back([&, thread]
         {
-            // Partial sort to get the top N items by physical size
-            std::ranges::partial_sort(matchedItems, matchedItems.begin() + maxResults,
-                std::ranges::greater{}, &CItem::GetSizeLogical);
+            // Items are counted on this thread and published in batches so the
+            // threads do not all contend on the dialog's counter
+            std::vector<CItem*> queue;
+            size_t counted = 0;
+            for (size_t unit; !isCancelled() && (unit = nextUnit++) < units.size();)
+            {
+                queue.assign(1, units[unit]);
+                while (!queue.empty() && !isCancelled())
+                {
+                    if (++counted == PROGRESS_BATCH) publish(counted);
+                    CItem* qitem = queue.back();
+                    queue.pop_back();
 
-            // Keep only the top N results
-            matchedItems.resize(maxResults);
-            m_rootItem->SetLimitExceeded(true);
+                    if (isMatch(qitem)) record(heaps[thread], qitem);
+                    if (descend(qitem)) queue.insert(queue.end(), qitem->GetChildren().begin(), qitem->GetChildren().end());
+                }
+            }
+
+            publish(counted);
+
+            std::scoped_lock lock(doneMutex);
+            if (--running == 0) done.notify_one();
+        });
+
+        // Stream results into the list while the walk goes on
+        const auto flush = [&]
+        {
+            std::vector<CItem*> batch;
+            if (std::scoped_lock lock(streamMutex); !streamed.empty()) batch.swap(streamed);
+            if (!batch.empty()) CMainFrame::Get()->InvokeInMessageThread([&] { Get()->AddResults(batch); });
+        };
+        for (std::unique_lock lock(doneMutex); !done.wait_for(lock, std::chrono::milliseconds(100), [&] { return running == 0; });)
+        {
+            lock.unlock();
+            flush();
+            lock.lock();
         }
-    }).ShowModal();
+        flush();
+    }
 
-    // Add found items to the interface
-    CWaitCursor wait;
-    CollapseItem(0);
+    for (auto& heap : heaps | std::views::take(threadCount)) heaps.back().Merge(std::move(heap));
+    matchCount = matches;
+    VTRACE(L"Search walk: {} matches on {} threads in {} ms", matchCount, threadCount, GetTickCount64() - start);
+    return heaps.back().Take();
+}
 
-    // Add to found items
-    const ScopedRedrawPause lock(this);
-    m_itemTracker.reserve(matchedItems.size());
-    for (CItem* matchedItem : matchedItems)
+void CFileSearchControl::AddResults(const std::span<CItem* const> items)
+{
+    m_itemTracker.reserve(m_itemTracker.size() + items.size());
+    for (CItem* matchedItem : items)
     {
+        if (m_itemTracker.contains(matchedItem)) continue;
         auto searchItem = new CItemSearch(matchedItem);
         m_itemTracker.emplace(matchedItem, searchItem);
         m_rootItem->AddSearchItemChild(searchItem);
     }
-
-    SortItems();
-    ExpandItem(0);
 }
 
 void CFileSearchControl::RemoveItem(CItem* item)
@@ -21,6 +21,8 @@
 #include "ItemSearch.h"
 #include "TreeListControl.h"
 
+class CProgressDlg;
+
 class CFileSearchControl final : public CTreeListControl
 {
 public:
@@ -35,8 +37,17 @@ public:
     void RemoveItem(CItem* item);
     void AfterDeleteAllItems() override;
 
+    // Largest matches below the item walked on the given threads; early results stream into the list when there is one
+    static std::vector<CItem*> SearchTree(CItem* item, const std::wregex& searchTermRegex, bool searchWholePhrase,
+        bool onlyFiles, size_t threadCount, CProgressDlg* pdlg, size_t& matchCount);
+
 protected:
 
+    void AddResults(std::span<CItem* const> items);
+
+    // Items each walking thread counts before adding them to the shared progress
+    static constexpr size_t PROGRESS_BATCH = 4096;
+
     inline static CFileSearchControl* m_singleton = nullptr;
     CItemSearch* m_rootItem = nullptr;
     std::unordered_map<CItem*, CItemSearch*> m_itemTracker;
@@ -32,9 +32,70 @@ bool CFileTopControl::GetAscendingDefault(const int column)
 void CFileTopControl::ProcessTop(CItem * item)
 {
     // Do not process if we are not tracking large files
-    if (COptions::LargeFileCount == 0) return;
+    const auto topN = static_cast<size_t>(COptions::LargeFileCount.Obj());
+    if (topN == 0) return;
+
+    // Some thread already holds topN files at least this large
+    const ULONGLONG size = item->GetSizeLogical();
+    if (size < m_admission.load(std::memory_order_relaxed)) return;
+
+    thread_local Candidates candidates;
+    if (const ULONG generation = m_generation.load(std::memory_order_acquire); candidates.generation != generation)
+    {
+        candidates = { ItemHeap(topN, &CItem::GetSizeLogical), generation };
+    }
 
+    // Only files this thread keeps can be among the largest overall
+    if (!candidates.heap.Push(item)) return;
     m_queuedSet.push(item);
+
+    // Share the smallest kept size so other threads stop publishing smaller files
+    if (!candidates.heap.IsFull()) return;
+    const ULONGLONG minimum = candidates.heap.MinimumKey();
+    for (ULONGLONG current = m_admission.load(std::memory_order_relaxed); current < minimum &&
+        !m_admission.compare_exchange_weak(current, minimum, std::memory_order_relaxed);) {}
+}
+
+void CFileTopControl::ClearPendingItems()
+{
+    m_queuedSet.clear();
+    ResetAdmission();
+}
+
+void CFileTopControl::ResetAdmission()
+{
+    m_admission.store(0, std::memory_order_relaxed);
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void CFileTopControl::StartRebuild(const size_t topN)
+{
+    // The walk only reads the tree; scans stop this thread before they change it
+    m_rebuildPending = false;
+    m_rebuildThread = std::jthread([this, topN](const std::stop_token& stopToken)
+    {
+        ItemHeap heap(topN, &CItem::GetSizeLogical);
+        if (CItem* root = CWinDirStatModel::Get()->GetRootItem(); root != nullptr)
+        {
+            for (CItem* item : CItemRange(std::span(&root, 1)))
+            {
+                if (stopToken.stop_requested()) return;
+                heap.Push(item);
+            }
+        }
+        m_rebuiltItems = heap.Take();
+        m_rebuildReady.store(true, std::memory_order_release);
+    });
+}
+
+void CFileTopControl::StopRebuild()
+{
+    // A rebuild that was stopped or not taken yet starts over once the tree is done
+    if (!m_rebuildThread.joinable()) return;
+    m_rebuildThread = {};
+    m_rebuildReady.store(false, std::memory_order_relaxed);
+    m_rebuiltItems.clear();
+    m_rebuildPending = true;
 }
 
 void CFileTopControl::SortItems()
@@ -47,11 +108,28 @@ void CFileTopControl::SortItems()
     const auto topN = static_cast<size_t>(COptions::LargeFileCount.Obj());
     if (topN != m_previousTopN)
     {
-        std::ranges::sort(m_sizeMap, CompareBySize);
+        // Only the previous count of files was kept so a longer list needs the tree
+        StopRebuild();
+        if (topN > m_previousTopN) m_rebuildPending = true;
+        ResetAdmission();
         m_previousTopN = topN;
         m_needsResort = true;
     }
 
+    // The tree can only be walked once no scan is changing it
+    if (m_rebuildPending && !m_rebuildThread.joinable() && CWinDirStatModel::Get()->IsRootDone()) StartRebuild(topN);
+    if (m_rebuildReady.exchange(false, std::memory_order_acquire))
+    {
+        m_rebuildThread = {};
+
+        // Queued files are part of the tree and would only be added twice
+        CItem* queuedItem = nullptr;
+        while (m_queuedSet.pop(queuedItem)) {}
+        m_sizeMap = std::move(m_rebuiltItems);
+        m_rebuiltItems = {};
+        m_needsResort = true;
+    }
+
     // Process queued items - only mark for resort if item could affect top N
     CItem* newItem = nullptr;
     while (m_queuedSet.pop(newItem))
@@ -78,9 +156,9 @@ void CFileTopControl::SortItems()
     // Partial sort to get top N items at the front
     std::ranges::partial_sort(m_sizeMap, sortEnd, CompareBySize);
 
-    // Update minimum size in top N for future comparisons
-    m_topNMinSize = topN > 0 && !m_sizeMap.empty() ?
-        m_sizeMap[std::min(topN, m_sizeMap.size()) - 1]->GetSizeLogical() : 0;
+    // Update minimum size in top N for future comparisons; files below it are never shown again
+    if (m_sizeMap.size() > topN) m_sizeMap.resize(topN);
+    m_topNMinSize = topN > 0 && !m_sizeMap.empty() ? m_sizeMap.back()->GetSizeLogical() : 0;
 
     // Update visual item removals
     auto itemTrackerCopy = std::unordered_map(m_itemTracker);
@@ -138,26 +216,70 @@ void CFileTopControl::RemoveItem(CItem* item)
     }
 
     // Remove items in bulk
-    m_needsResort = true;
-    std::erase_if(m_sizeMap, [&](const auto& itemToRemove)
+    const bool lostMembers = std::erase_if(m_sizeMap, [&](const auto& itemToRemove)
     {
         return toRemove.contains(itemToRemove);
-    });
+    }) > 0;
+    if (lostMembers) m_needsResort = true;
 
-    // Use the sort function to remove visual items
+    // Use the sort function to remove visual items; the tree still holds the
+    // removed items so it must not be walked until they are gone. Folder
+    // rankings may refer to them and return with the next scan.
+    const bool rebuildPending = m_rebuildPending || lostMembers;
+    m_rebuildPending = false;
     CMainFrame::Get()->InvokeInMessageThread([&]
     {
+        ClearFolderRankings();
         SortItems();
     });
+    m_rebuildPending = rebuildPending;
+
+    // The files that would move up into freed places were not kept, so complete
+    // the list from the tree once the removed items are gone and any refresh has
+    // finished; a list that kept all its members still holds the largest files
+    if (lostMembers) ResetAdmission();
+}
+
+void CFileTopControl::SetFolderRankings(const CFolderRankings& rankings)
+{
+    if (m_rootItem == nullptr) return;
+    ClearFolderRankings();
+
+    // Groups are filled before they are attached so only the group rows are inserted
+    const ScopedRedrawPause lock(this);
+    for (const auto ranking : std::views::iota(0, +CFolderRankings::RankingCount))
+    {
+        const auto& entries = rankings.Get(static_cast<CFolderRankings::Ranking>(ranking));
+        if (entries.empty()) continue;
+
+        const auto group = new CItemTop(CFolderRankings::GetTitle(
+            static_cast<CFolderRankings::Ranking>(ranking)), static_cast<BYTE>(ranking + 1));
+        for (const auto& [folder, value] : entries)
+        {
+            group->AddTopItemChild(new CItemTop(folder, value, static_cast<BYTE>(ranking + 1)));
+        }
+        m_rootItem->AddTopItemChild(group);
+        m_rankingGroups.push_back(group);
+    }
+}
+
+void CFileTopControl::ClearFolderRankings()
+{
+    for (const auto group : m_rankingGroups) m_rootItem->RemoveTopItemChild(group);
+    m_rankingGroups.clear();
 }
 
 void CFileTopControl::AfterDeleteAllItems()
 {
-    // Reset trackers
+    // Reset trackers; the root item owns the ranking groups
     m_sizeMap.clear();
     m_itemTracker.clear();
+    m_rankingGroups.clear();
     m_topNMinSize = 0;
     m_needsResort = true;
+    StopRebuild();
+    m_rebuildPending = false;
+    ResetAdmission();
 
     // Delete and recreate root item
     delete m_rootItem;
@@ -19,8 +19,20 @@
 
 #include "pch.h"
 #include "ItemTop.h"
+#include "BoundedHeap.h"
+#include "FolderRankings.h"
 #include "TreeListControl.h"
 
+//
+// CFileTopControl. Lists the largest files. Every thread reporting files keeps
+// its own largest ones in a bounded heap and only publishes the files that heap
+// keeps; once a heap is full its smallest size becomes a shared admission
+// threshold that lets all threads discard smaller files without a lock. Files
+// discarded that way are only needed again when the list loses members or
+// grows, in which case a separate thread rebuilds it from the tree once the
+// scan is done and the timer picks up the result.
+// Folder rankings computed after each scan follow the files as collapsed groups.
+//
 class CFileTopControl final : public CTreeListControl
 {
 public:
@@ -30,13 +42,29 @@ public:
     static CFileTopControl* Get() { return m_singleton; }
     CItemTop* GetRootItem() const { return m_rootItem; }
     void ProcessTop(CItem* item);
-    void ClearPendingItems() { m_queuedSet.clear(); }
+    void ClearPendingItems();
     void RemoveItem(CItem* item);
+    void SetFolderRankings(const CFolderRankings& rankings);
+    void ClearFolderRankings();
+    void StopRebuild();
+    bool IsRebuildReady() const { return m_rebuildReady.load(std::memory_order_acquire); }
     void SortItems() override;
     void AfterDeleteAllItems() override;
 
 protected:
 
+    using ItemHeap = CBoundedHeap<CItem*, decltype(&CItem::GetSizeLogical)>;
+
+    // Largest files seen by one thread in the current generation
+    struct Candidates
+    {
+        ItemHeap heap{ 0, &CItem::GetSizeLogical };
+        ULONG generation = 0;
+    };
+
+    void ResetAdmission();
+    void StartRebuild(size_t topN);
+
     // Custom comparator to keep the list organized by size (largest first)
     static constexpr auto CompareBySize = [](const CItem* lhs, const CItem* rhs)
     {
@@ -46,10 +74,17 @@ protected:
     inline static CFileTopControl* m_singleton = nullptr;
     CItemTop* m_rootItem = nullptr;
     SingleConsumerQueue<CItem*> m_queuedSet;
+    std::atomic<ULONGLONG> m_admission = 0; // Smaller files cannot make the list
+    std::atomic<ULONG> m_generation = 1;    // Bumped to discard the heaps of all threads
     std::vector<CItem*> m_sizeMap;
     ULONGLONG m_topNMinSize = 0;
     bool m_needsResort = true;
     std::unordered_map<CItem*, CItemTop*> m_itemTracker;
-    size_t m_previousTopN = 0;
+    size_t m_previousTopN = SIZE_MAX; // Not sorted yet
+    bool m_rebuildPending = false;
+    std::vector<CItemTop*> m_rankingGroups; // Owned by the root item
+    std::vector<CItem*> m_rebuiltItems;     // Written by the rebuild thread before it is ready
+    std::atomic<bool> m_rebuildReady = false;
+    std::jthread m_rebuildThread;           // Joined before the members it writes are destroyed
 
 };
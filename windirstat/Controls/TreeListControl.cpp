@@ -746,8 +746,13 @@ LRESULT CTreeListControl::OnSelectionChanged(const WPARAM wParam, const LPARAM l
             auto* checkItem = item->GetAncestorCheckItem();
             if (checkItem == nullptr || !selectedSet.contains(checkItem)) continue;
 
-            if (std::ranges::any_of(selectedSet, [checkItem](CTreeListItem* other)
-                { return other != checkItem && other->IsAncestorOf(checkItem); }))
+            const auto hasSelectedAncestor = [&selectedSet](const CTreeListItem* child)
+            {
+                for (auto* parent = child->GetParent(); parent != nullptr; parent = parent->GetParent())
+                    if (selectedSet.contains(parent)) return true;
+                return false;
+            };
+            if (hasSelectedAncestor(checkItem))
             {
                 const int idx = FindTreeItem(item);
                 if (idx != -1) SetItemState(idx, 0, LVIS_SELECTED);
@@ -342,9 +342,7 @@ static CItem* LoadResultsCsv(std::ifstream& reader)
             fields[orderMap[FIELD_FOLDERS]], newroot, parentMap);
     }
 
-    if (newroot != nullptr) COptions::TreeMapUseLogical ? newroot->SortItemsBySizeLogical() : newroot->SortItemsBySizePhysical();
-    for (const auto& val : parentMap | std::views::values)
-        COptions::TreeMapUseLogical ? val->SortItemsBySizeLogical() : val->SortItemsBySizePhysical();
+    CItem::SortItemsRecursive(newroot);
 
     return newroot;
 }
@@ -401,9 +399,7 @@ static CItem* LoadResultsJson(std::ifstream& reader)
             fieldValues[FIELD_FOLDERS], newroot, parentMap);
     }
 
-    if (newroot != nullptr) COptions::TreeMapUseLogical ? newroot->SortItemsBySizeLogical() : newroot->SortItemsBySizePhysical();
-    for (const auto& val : parentMap | std::views::values)
-        COptions::TreeMapUseLogical ? val->SortItemsBySizeLogical() : val->SortItemsBySizePhysical();
+    CItem::SortItemsRecursive(newroot);
 
     return newroot;
 }
@@ -425,39 +421,49 @@ CItem* LoadResults(const std::wstring& path)
     return IsJsonPath(path) ? LoadResultsJson(reader) : LoadResultsCsv(reader);
 }
 
-// Walk the item tree breadth-first and return a flat ordered list
-static std::vector<const CItem*> CollectItems(CItem* rootItem)
+// Walk the item tree depth-first in name order, visiting each item as it is
+// reached; only the pending siblings of each level are held and their buffers
+// are reused so the walk does not grow with the item count
+template <typename Visitor>
+static void ForEachExportItem(CItem* rootItem, Visitor&& visit)
 {
-    std::vector<const CItem*> items;
-    items.reserve(static_cast<size_t>(rootItem->GetItemsCount()));
-
-    std::vector queue({ rootItem });
-    while (!queue.empty()) [[msvc::forceinline_calls]]
+    std::vector<std::vector<const CItem*>> levels(1, { rootItem });
+    for (size_t depth = 1; depth > 0;) [[msvc::forceinline_calls]]
     {
-        const CItem* qitem = queue.back();
-        queue.pop_back();
+        auto& level = levels[depth - 1];
+        if (level.empty())
+        {
+            depth--;
+            continue;
+        }
+
+        const CItem* qitem = level.back();
+        level.pop_back();
 
         if (qitem->IsTypeOrFlag(IT_HLINKS)) continue;
 
-        items.push_back(qitem);
+        visit(qitem);
         if (qitem->IsLeaf()) continue;
 
-        std::vector<CItem*> children = qitem->GetChildren();
+        // Sorted descending so the next name in order is at the back
+        if (depth == levels.size()) levels.emplace_back();
+        auto& children = levels[depth++];
+        children.assign(qitem->GetChildren().begin(), qitem->GetChildren().end());
         std::ranges::sort(children, [](auto a, auto b)
         {
             return _wcsicmp(a->GetNameView().data(), b->GetNameView().data()) > 0;
         });
-
-        queue.insert(queue.end(), children.begin(), children.end());
     }
-    return items;
 }
 
 // Compute adjusted physical sizes (undoes hardlink accounting)
 static std::unordered_map<const CItem*, LONGLONG>
-    ComputeAdjustedSizes(const std::vector<const CItem*>& items)
+    ComputeAdjustedSizes(CItem* rootItem)
 {
     std::unordered_map<const CItem*, LONGLONG> adjustedSizes;
+    const CItemRange items(std::span(&rootItem, 1),
+        [](const CItem* item) { return item->IsTypeOrFlag(IT_DRIVE, ITF_HARDLINK) && !item->IsTypeOrFlag(IT_HLINKS); },
+        [](const CItem* item) { return !item->IsTypeOrFlag(IT_HLINKS); });
     for (const auto* item : items) [[msvc::forceinline_calls]]
     {
         if (item->IsTypeOrFlag(IT_DRIVE))
@@ -477,7 +483,7 @@ static std::unordered_map<const CItem*, LONGLONG>
     return adjustedSizes;
 }
 
-static bool SaveResultsCsv(std::ofstream& outf, const std::vector<const CItem*>& items,
+static bool SaveResultsCsv(std::ofstream& outf, CItem* rootItem,
     const std::vector<std::wstring>& cols, const std::unordered_map<const CItem*, LONGLONG>& adjustedSizes,
     const bool includeOwner)
 {
@@ -485,8 +491,9 @@ static bool SaveResultsCsv(std::ofstream& outf, const std::vector<const CItem*>&
     for (size_t i = 0; i < cols.size(); ++i)
         outf << QuoteAndConvert(cols[i]) << (i + 1 < cols.size() ? "," : "");
 
-    // Rows
-    for (const auto* item : items)
+    // Rows (items are in depth-first order so the path builder only appends each name)
+    CItemPathBuilder paths;
+    ForEachExportItem(rootItem, [&](const CItem* item)
     {
         const bool nonPathItem = item->IsTypeOrFlag(IT_MYCOMPUTER);
         const ITEMTYPE itemType = item->GetRawType() & ~ITF_HARDLINK & ~ITHASH_MASK & ~ITF_EXTDATA;
@@ -495,7 +502,7 @@ static bool SaveResultsCsv(std::ofstream& outf, const std::vector<const CItem*>&
         // MTP indices are process-local path registrations and must not be serialized
         const ULONGLONG index = item->IsTypeOrFlag(ITF_MTP) ? 0 : item->GetIndex();
         std::format_to(std::ostreambuf_iterator(outf), "\r\n{},{},{},{},{},{},{},0x{:08X},0x{:016X}",
-            QuoteAndConvert(nonPathItem ? item->GetName() : item->GetPath()),
+            QuoteAndConvert(nonPathItem ? item->GetNameView() : paths.Get(item)),
             item->GetFilesCount(),
             item->GetFoldersCount(),
             item->GetSizeLogical(),
@@ -505,7 +512,7 @@ static bool SaveResultsCsv(std::ofstream& outf, const std::vector<const CItem*>&
             static_cast<std::uint32_t>(itemType),
             index);
         if (includeOwner) outf << "," << QuoteAndConvert(item->GetOwner(true));
-    }
+    });
     outf.flush();
     return outf.good();
 }
@@ -513,7 +520,7 @@ static bool SaveResultsCsv(std::ofstream& outf, const std::vector<const CItem*>&
 // ── JSON save ─────────────────────────────────────────────────────────────────
 
 static bool SaveResultsJson(std::ofstream& outf,
-    const std::vector<const CItem*>& items,
+    CItem* rootItem,
     const std::vector<std::wstring>& cols,
     const std::unordered_map<const CItem*, LONGLONG>& adjustedSizes,
     const bool includeOwner)
@@ -525,7 +532,8 @@ static bool SaveResultsJson(std::ofstream& outf,
 
     outf << "[\r\n";
     bool firstItem = true;
-    for (const auto* item : items)
+    CItemPathBuilder paths;
+    ForEachExportItem(rootItem, [&](const CItem* item)
     {
         if (!firstItem) outf << ",\r\n";
         firstItem = false;
@@ -539,7 +547,7 @@ static bool SaveResultsJson(std::ofstream& outf,
 
         // Write one JSON object per item
         outf << "{\r\n";
-        outf << "  " << jk[FIELD_NAME]           << ": " << JsonQuoteW(nonPathItem ? item->GetName() : item->GetPath()) << ",\r\n";
+        outf << "  " << jk[FIELD_NAME]           << ": " << JsonQuoteW(nonPathItem ? item->GetNameView() : paths.Get(item)) << ",\r\n";
         outf << "  " << jk[FIELD_FILES]          << ": " << item->GetFilesCount()                                       << ",\r\n";
         outf << "  " << jk[FIELD_FOLDERS]        << ": " << item->GetFoldersCount()                                     << ",\r\n";
         outf << "  " << jk[FIELD_SIZE_LOGICAL]   << ": " << item->GetSizeLogical()                                      << ",\r\n";
@@ -552,7 +560,7 @@ static bool SaveResultsJson(std::ofstream& outf,
         if (includeOwner)
             outf << ",\r\n  " << jkOwner << ": " << JsonQuoteW(item->GetOwner(true));
         outf << "\r\n}";
-    }
+    });
     outf << "\r\n]\r\n";
     outf.flush();
     return outf.good();
@@ -560,8 +568,7 @@ static bool SaveResultsJson(std::ofstream& outf,
 
 bool SaveResults(const std::wstring& path, CItem* rootItem)
 {
-    const std::vector<const CItem*> items       = CollectItems(rootItem);
-    const auto                      adjustedSizes = ComputeAdjustedSizes(items);
+    const auto adjustedSizes = ComputeAdjustedSizes(rootItem);
     const bool includeOwner = COptions::IsColumnVisible(COptions::FileTreeColumnVisibility.Obj(), COL_OWNER);
 
     std::vector cols =
@@ -582,8 +589,8 @@ bool SaveResults(const std::wstring& path, CItem* rootItem)
     if (!outf.is_open()) return false;
 
     return IsJsonPath(path)
-        ? SaveResultsJson(outf, items, cols, adjustedSizes, includeOwner)
-        : SaveResultsCsv (outf, items, cols, adjustedSizes, includeOwner);
+        ? SaveResultsJson(outf, rootItem, cols, adjustedSizes, includeOwner)
+        : SaveResultsCsv (outf, rootItem, cols, adjustedSizes, includeOwner);
 }
 
 static std::vector<std::tuple<std::wstring, const CItem*>>
@@ -615,11 +622,12 @@ static bool SaveDuplicatesCsv(std::ofstream& outf, const std::vector<std::wstrin
         outf << QuoteAndConvert(cols[i]) << (i + 1 < cols.size() ? "," : "");
     outf << "\r\n";
 
+    CItemPathBuilder paths;
     for (const auto& [hash, linkedItem] : dupeItems)
     {
         std::format_to(std::ostreambuf_iterator(outf), "{},{},{},{},{},{}\r\n",
             QuoteAndConvert(hash),
-            QuoteAndConvert(linkedItem->GetPath()),
+            QuoteAndConvert(paths.Get(linkedItem)),
             linkedItem->GetSizeLogical(),
             linkedItem->GetSizePhysicalRaw(),
             ToTimePoint(linkedItem->GetLastChange()),
@@ -644,13 +652,14 @@ static bool SaveDuplicatesJson(std::ofstream& outf,
 
     outf << "[\r\n";
     bool first = true;
+    CItemPathBuilder paths;
     for (const auto& [hash, item] : dupeItems)
     {
         if (!first) outf << ",\r\n";
         first = false;
         outf << "{\r\n";
         outf << "  " << jHash     << ": " << JsonQuoteW(hash) << ",\r\n";
-        outf << "  " << jName     << ": " << JsonQuoteW(item->GetPath()) << ",\r\n";
+        outf << "  " << jName     << ": " << JsonQuoteW(paths.Get(item)) << ",\r\n";
         outf << "  " << jSizeLog  << ": " << item->GetSizeLogical() << ",\r\n";
         outf << "  " << jSizePhys << ": " << item->GetSizePhysicalRaw() << ",\r\n";
         outf << "  " << jLastChg  << ": " << JsonQuote(ToTimePoint(item->GetLastChange())) << ",\r\n";
@@ -763,3 +772,232 @@ bool SavePermissions(const std::wstring& path, const std::vector<const CItemPerm
         ? SavePermissionsJson(outf, cols, items)
         : SavePermissionsCsv (outf, cols, items);
 }
+
+// ── query results save ────────────────────────────────────────────────────────
+
+static bool SaveQueryResultsCsv(std::ofstream& outf, const std::vector<std::wstring>& cols,
+    const CQueryEngine::Result& result)
+{
+    for (size_t i = 0; i < cols.size(); ++i)
+        outf << QuoteAndConvert(cols[i]) << (i + 1 < cols.size() ? "," : "");
+    outf << "\r\n";
+
+    if (result.grouped) for (const auto& [key, aggregate] : result.groups)
+    {
+        std::format_to(std::ostreambuf_iterator(outf), "{},{},{},{},{}\r\n",
+            QuoteAndConvert(key),
+            aggregate.items,
+            aggregate.sizeLogical,
+            aggregate.sizePhysical,
+            ToTimePoint(aggregate.newest));
+    }
+    else
+    {
+        CItemPathBuilder paths;
+        for (const auto* item : result.items)
+        {
+            std::format_to(std::ostreambuf_iterator(outf), "{},{},{},{},{}\r\n",
+                QuoteAndConvert(paths.Get(item)),
+                item->GetSizeLogical(),
+                item->GetSizePhysical(),
+                ToTimePoint(item->GetLastChange()),
+                QuoteAndConvert(FormatAttributes(item->GetAttributes())));
+        }
+    }
+    outf.flush();
+    return outf.good();
+}
+
+static bool SaveQueryResultsJson(std::ofstream& outf, const std::vector<std::wstring>& cols,
+    const CQueryEngine::Result& result)
+{
+    // cols order: NAME, then ITEMS, SIZE_LOGICAL, SIZE_PHYSICAL, LAST_CHANGE when grouped
+    // or SIZE_LOGICAL, SIZE_PHYSICAL, LAST_CHANGE, ATTRIBUTES otherwise
+    std::vector<std::string> jCols;
+    for (const auto& col : cols) jCols.push_back(JsonQuoteW(col));
+
+    outf << "[\r\n";
+    bool first = true;
+    if (result.grouped) for (const auto& [key, aggregate] : result.groups)
+    {
+        if (!first) outf << ",\r\n";
+        first = false;
+        outf << "{\r\n";
+        outf << "  " << jCols[0] << ": " << JsonQuoteW(key) << ",\r\n";
+        outf << "  " << jCols[1] << ": " << aggregate.items << ",\r\n";
+        outf << "  " << jCols[2] << ": " << aggregate.sizeLogical << ",\r\n";
+        outf << "  " << jCols[3] << ": " << aggregate.sizePhysical << ",\r\n";
+        outf << "  " << jCols[4] << ": " << JsonQuote(ToTimePoint(aggregate.newest)) << "\r\n";
+        outf << "}";
+    }
+    else
+    {
+        CItemPathBuilder paths;
+        for (const auto* item : result.items)
+        {
+            if (!first) outf << ",\r\n";
+            first = false;
+            outf << "{\r\n";
+            outf << "  " << jCols[0] << ": " << JsonQuoteW(paths.Get(item)) << ",\r\n";
+            outf << "  " << jCols[1] << ": " << item->GetSizeLogical() << ",\r\n";
+            outf << "  " << jCols[2] << ": " << item->GetSizePhysical() << ",\r\n";
+            outf << "  " << jCols[3] << ": " << JsonQuote(ToTimePoint(item->GetLastChange())) << ",\r\n";
+            outf << "  " << jCols[4] << ": " << JsonQuoteW(FormatAttributes(item->GetAttributes())) << "\r\n";
+            outf << "}";
+        }
+    }
+    outf << "\r\n]\r\n";
+    outf.flush();
+    return outf.good();
+}
+
+bool SaveQueryResults(const std::wstring& path, const CQueryEngine::Result& result)
+{
+    std::ofstream outf(path, std::ios::binary);
+    if (!outf.is_open()) return false;
+
+    const std::vector cols = result.grouped ? std::vector
+    {
+        Localization::Lookup(IDS_COL_NAME),
+        Localization::Lookup(IDS_COL_ITEMS),
+        Localization::Lookup(IDS_COL_SIZE_LOGICAL),
+        Localization::Lookup(IDS_COL_SIZE_PHYSICAL),
+        Localization::Lookup(IDS_COL_LAST_CHANGE)
+    } : std::vector
+    {
+        Localization::Lookup(IDS_COL_NAME),
+        Localization::Lookup(IDS_COL_SIZE_LOGICAL),
+        Localization::Lookup(IDS_COL_SIZE_PHYSICAL),
+        Localization::Lookup(IDS_COL_LAST_CHANGE),
+        Localization::Lookup(IDS_COL_ATTRIBUTES)
+    };
+
+    return IsJsonPath(path)
+        ? SaveQueryResultsJson(outf, cols, result)
+        : SaveQueryResultsCsv (outf, cols, result);
+}
+
+// ── folder rankings save ──────────────────────────────────────────────────────
+
+static bool SaveFolderRankingsCsv(std::ofstream& outf, const std::vector<std::wstring>& cols,
+    const CFolderRankings& rankings)
+{
+    for (size_t i = 0; i < cols.size(); ++i)
+        outf << QuoteAndConvert(cols[i]) << (i + 1 < cols.size() ? "," : "");
+    outf << "\r\n";
+
+    CItemPathBuilder paths;
+    for (const auto ranking : std::views::iota(0, +CFolderRankings::RankingCount))
+    {
+        const auto title = CFolderRankings::GetTitle(static_cast<CFolderRankings::Ranking>(ranking));
+        for (const auto& [folder, value] : rankings.Get(static_cast<CFolderRankings::Ranking>(ranking)))
+        {
+            std::format_to(std::ostreambuf_iterator(outf), "{},{},{},{},{}\r\n",
+                QuoteAndConvert(title),
+                QuoteAndConvert(paths.Get(folder)),
+                value,
+                folder->GetSizeLogical(),
+                folder->GetFilesCount());
+        }
+    }
+    outf.flush();
+    return outf.good();
+}
+
+static bool SaveFolderRankingsJson(std::ofstream& outf, const std::vector<std::wstring>& cols,
+    const CFolderRankings& rankings)
+{
+    // cols order: DESCRIPTION, NAME, VALUE, SIZE_LOGICAL, FILES
+    const auto jDesc    = JsonQuoteW(cols[0]);
+    const auto jName    = JsonQuoteW(cols[1]);
+    const auto jValue   = JsonQuoteW(cols[2]);
+    const auto jSizeLog = JsonQuoteW(cols[3]);
+    const auto jFiles   = JsonQuoteW(cols[4]);
+
+    outf << "[\r\n";
+    bool first = true;
+    CItemPathBuilder paths;
+    for (const auto ranking : std::views::iota(0, +CFolderRankings::RankingCount))
+    {
+        const auto title = JsonQuoteW(CFolderRankings::GetTitle(static_cast<CFolderRankings::Ranking>(ranking)));
+        for (const auto& [folder, value] : rankings.Get(static_cast<CFolderRankings::Ranking>(ranking)))
+        {
+            if (!first) outf << ",\r\n";
+            first = false;
+            outf << "{\r\n";
+            outf << "  " << jDesc    << ": " << title << ",\r\n";
+            outf << "  " << jName    << ": " << JsonQuoteW(paths.Get(folder)) << ",\r\n";
+            outf << "  " << jValue   << ": " << value << ",\r\n";
+            outf << "  " << jSizeLog << ": " << folder->GetSizeLogical() << ",\r\n";
+            outf << "  " << jFiles   << ": " << folder->GetFilesCount() << "\r\n";
+            outf << "}";
+        }
+    }
+    outf << "\r\n]\r\n";
+    outf.flush();
+    return outf.good();
+}
+
+bool SaveFolderRankings(const std::wstring& path, const CFolderRankings& rankings)
+{
+    std::ofstream outf(path, std::ios::binary);
+    if (!outf.is_open()) return false;
+
+    const std::vector cols =
+    {
+        Localization::Lookup(IDS_COL_DESCRIPTION),
+        Localization::Lookup(IDS_COL_NAME),
+        Localization::Lookup(IDS_COL_VALUE),
+        Localization::Lookup(IDS_COL_SIZE_LOGICAL),
+        Localization::Lookup(IDS_COL_FILES)
+    };
+
+    return IsJsonPath(path)
+        ? SaveFolderRankingsJson(outf, cols, rankings)
+        : SaveFolderRankingsCsv (outf, cols, rankings);
+}
+
+// ── scan statistics save ──────────────────────────────────────────────────────
+
+bool SaveScanStatistics(const std::wstring& path, const SScanStatistics& statistics, const ULONGLONG teardownBytes)
+{
+    std::ofstream outf(path, std::ios::binary);
+    if (!outf.is_open()) return false;
+
+    // Statistic names are identifiers for scripts and are not localized
+    const std::array<std::pair<std::string_view, ULONGLONG>, 15> rows =
+    { {
+        { "EnumerateMilliseconds", statistics.enumerateTicks },
+        { "FinalizeMilliseconds", statistics.finalizeTicks },
+        { "FilterMilliseconds", statistics.filterNanoseconds / 1'000'000 },
+        { "FolderRankingMilliseconds", statistics.folderRankingTicks },
+        { "NameIndexMilliseconds", statistics.nameIndexTicks },
+        { "NameIndexBytes", statistics.nameIndexBytes },
+        { "HashMilliseconds", statistics.hashTicks },
+        { "HashCacheHits", statistics.hashCacheHits },
+        { "HashCacheMisses", statistics.hashCacheMisses },
+        { "HashCacheNanosecondsPerLookup", statistics.hashCacheLookupNanoseconds },
+        { "HashBytesPerConfirmed", statistics.hashBytesConfirmed },
+        { "HashBytesPerRejected", statistics.hashBytesRejected },
+        { "PartialDupeMilliseconds", statistics.partialDupeTicks },
+        { "PartialDupeBytes", statistics.partialDupeBytes },
+        { "TeardownBytesReleased", teardownBytes }
+    } };
+
+    if (IsJsonPath(path))
+    {
+        outf << "{\r\n";
+        for (size_t i = 0; i < rows.size(); ++i)
+            outf << "  " << JsonQuote(rows[i].first) << ": " << rows[i].second << (i + 1 < rows.size() ? ",\r\n" : "\r\n");
+        outf << "}\r\n";
+    }
+    else
+    {
+        outf << QuoteAndConvert(Localization::Lookup(IDS_COL_NAME)) << ","
+            << QuoteAndConvert(Localization::Lookup(IDS_COL_VALUE)) << "\r\n";
+        for (const auto& [name, value] : rows)
+            std::format_to(std::ostreambuf_iterator(outf), "{},{}\r\n", name, value);
+    }
+    outf.flush();
+    return outf.good();
+}
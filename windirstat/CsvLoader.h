@@ -19,8 +19,13 @@
 
 #include "pch.h"
 #include "ItemPerm.h"
+#include "QueryEngine.h"
+#include "FolderRankings.h"
 
 bool SaveResults(const std::wstring& path, CItem* rootItem);
 CItem* LoadResults(const std::wstring& path);
 bool SaveDuplicates(const std::wstring& path, const CItemDupe* rootDupe);
 bool SavePermissions(const std::wstring& path, const std::vector<const CItemPerm*>& items);
+bool SaveQueryResults(const std::wstring& path, const CQueryEngine::Result& result);
+bool SaveFolderRankings(const std::wstring& path, const CFolderRankings& rankings);
+bool SaveScanStatistics(const std::wstring& path, const SScanStatistics& statistics, ULONGLONG teardownBytes);
@@ -52,7 +52,8 @@ public:
 
     // Methods for task lambda to interact with the dialog
     bool IsCancelled() const noexcept { return m_cancelRequested.load(); }
-    size_t Increment() noexcept { return ++m_current; }
+    size_t Increment(const size_t count = 1) noexcept { return m_current += count; }
+    size_t GetCurrent() const noexcept { return m_current; }
     size_t GetTotal() const noexcept { return m_total; }
     bool HasFlag(const Flags flag) const noexcept
     {
@@ -0,0 +1,140 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "FilterView.h"
+#include "Filtering.h"
+
+CFilterView::CFilterView(CItem* root)
+{
+    // Collect the folders filters apply to with every parent ahead of its children
+    for (std::vector stack({ root }); !stack.empty();)
+    {
+        CItem* item = stack.back();
+        stack.pop_back();
+        if (!IsProjected(item)) continue;
+        m_folders.push_back(item);
+        stack.insert(stack.end(), item->GetChildren().begin(), item->GetChildren().end());
+    }
+
+    m_projections.reserve(m_folders.size());
+    for (const CItem* folder : m_folders) m_projections.try_emplace(folder);
+
+    // Each folder decides its own visibility and that of its files independently
+    std::for_each(std::execution::par, m_folders.begin(), m_folders.end(), [this](const CItem* folder)
+    {
+        SFilterProjection& projection = m_projections.find(folder)->second;
+        const bool scoped = folder->IsTypeOrFlag(IT_DRIVE, IT_DIRECTORY);
+        const CFiltering::DirectoryScope scope(scoped ? folder->GetPathRef() : std::wstring());
+        projection.hidden = scoped && scope.IsFilteredOut();
+        if (projection.hidden) return;
+
+        for (CItem* child : folder->GetChildren())
+        {
+            if (IsProjected(child))
+            {
+                // Folded in below once the child's own projection is complete
+                projection.children.push_back(child);
+                continue;
+            }
+
+            if (child->IsTypeOrFlag(IT_FILE) &&
+                scope.IsFileFilteredOut(child->GetName(), child->GetSizeLogical(), child->GetLastChange())) continue;
+
+            projection.children.push_back(child);
+            projection.sizePhysical += child->GetSizePhysical();
+            projection.sizeLogical += child->GetSizeLogical();
+            projection.files += child->IsTypeOrFlag(IT_FILE) ? 1 : child->GetFilesCount();
+            projection.subdirs += child->GetFoldersCount();
+        }
+    });
+
+    // The root stays in place even when nothing below it remains
+    m_projections[root].hidden = false;
+
+    // Hidden folders hide everything below them
+    for (const CItem* folder : m_folders)
+    {
+        if (!m_projections[folder].hidden) continue;
+        for (const CItem* child : folder->GetChildren())
+        {
+            if (IsProjected(child)) m_projections[child].hidden = true;
+        }
+    }
+
+    // Children complete before their parents when walking the folders backwards
+    for (const CItem* folder : std::views::reverse(m_folders))
+    {
+        SFilterProjection& projection = m_projections[folder];
+        if (projection.hidden) continue;
+
+        // Direct multi-root branches are not included in the synthetic root's folder count
+        const ULONG self = folder->IsTypeOrFlag(IT_MYCOMPUTER) ? 0 : 1;
+        std::erase_if(projection.children, [&](const CItem* child)
+        {
+            if (!IsProjected(child)) return false;
+            const SFilterProjection& childProjection = m_projections.find(child)->second;
+            if (childProjection.hidden) return true;
+
+            projection.sizePhysical += childProjection.sizePhysical;
+            projection.sizeLogical += childProjection.sizeLogical;
+            projection.files += childProjection.files;
+            projection.subdirs += childProjection.subdirs + self;
+            return false;
+        });
+    }
+
+    std::erase_if(m_projections, [](const auto& entry) { return entry.second.hidden; });
+    std::erase_if(m_folders, [this](const CItem* folder) { return !m_projections.contains(folder); });
+    if (const auto it = m_projections.find(root); it != m_projections.end())
+    {
+        m_visibleItems = static_cast<ULONGLONG>(it->second.files) + it->second.subdirs;
+    }
+
+    SortChildren();
+}
+
+std::shared_ptr<const SFilterProjection> CFilterView::Find(const CItem* item)
+{
+    if (!s_anyActive.load(std::memory_order_acquire)) return nullptr;
+    const auto view = s_active.load();
+    if (view == nullptr) return nullptr;
+
+    // The projection shares ownership of its view
+    const auto it = view->m_projections.find(item);
+    return it != view->m_projections.end() ? std::shared_ptr<const SFilterProjection>(view, &it->second) : nullptr;
+}
+
+void CFilterView::SortChildren()
+{
+    // Sort by the projected sizes for proper treemap rendering
+    const bool useLogical = COptions::TreeMapUseLogical;
+    const auto sizeOf = [this, useLogical](const CItem* item)
+    {
+        if (const auto it = m_projections.find(item); it != m_projections.end())
+        {
+            return useLogical ? it->second.sizeLogical : it->second.sizePhysical;
+        }
+        return useLogical ? item->GetSizeLogical() : item->GetSizePhysical();
+    };
+
+    std::for_each(std::execution::par, m_folders.begin(), m_folders.end(), [&](const CItem* folder)
+    {
+        auto& children = m_projections.find(folder)->second.children;
+        std::ranges::sort(children, [&](const CItem* a, const CItem* b) { return sizeOf(a) > sizeOf(b); });
+    });
+}
@@ -0,0 +1,81 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+// Sizes, counts and visible children of a folder as seen through the filters
+struct SFilterProjection
+{
+    std::vector<CItem*> children; // Visible children, largest first
+    ULONGLONG sizePhysical = 0;
+    ULONGLONG sizeLogical = 0;
+    ULONG files = 0;
+    ULONG subdirs = 0;
+    bool hidden = false;
+};
+
+//
+// CFilterView. The scanned tree as seen through the current filters, shown in
+// place of the scanned totals so filters can be tried out without a rescan.
+// Sizes, counts and visible children of every folder are computed in one
+// parallel pass while the tree itself is left untouched. Only the tree list,
+// treemap and extension list display the view; exports, queries and rankings
+// keep reporting the scanned values. The view is derived from what was
+// scanned, so it can hide items but never bring back ones that the scan
+// itself filtered out. Any change to the tree discards it.
+//
+class CFilterView final
+{
+public:
+
+    explicit CFilterView(CItem* root);
+
+    CFilterView(const CFilterView&) = delete;
+    CFilterView& operator=(const CFilterView&) = delete;
+
+    // The view items are displayed through; null while the scanned totals are shown.
+    // Readers hold the view they loaded, so replacing it never frees one in use.
+    static std::shared_ptr<CFilterView> GetActive() noexcept { return s_active.load(); }
+    static void SetActive(std::shared_ptr<CFilterView> view) noexcept
+    {
+        const bool active = view != nullptr;
+        s_active.store(std::move(view));
+        s_anyActive.store(active, std::memory_order_release);
+    }
+
+    // Projection of a folder in the active view, or null when the item reports its own values
+    static std::shared_ptr<const SFilterProjection> Find(const CItem* item);
+
+    void SortChildren();
+    ULONGLONG GetVisibleItems() const noexcept { return m_visibleItems; }
+
+private:
+
+    static bool IsProjected(const CItem* item) noexcept
+    {
+        return !item->IsLeaf() && item->IsTypeOrFlag(IT_MYCOMPUTER, IT_DRIVE, IT_DIRECTORY);
+    }
+
+    inline static std::atomic<std::shared_ptr<CFilterView>> s_active;
+    inline static std::atomic<bool> s_anyActive = false; // Spares display accessors the view load while none is shown
+
+    std::unordered_map<const CItem*, SFilterProjection> m_projections;
+    std::vector<CItem*> m_folders; // Projected folders, parents before their children
+    ULONGLONG m_visibleItems = 0;
+};
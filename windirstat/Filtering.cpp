@@ -22,14 +22,15 @@
 
 // --- Static member definitions ---
 
-std::vector<std::wregex> CFiltering::ExcludeDirsRegex;
-std::vector<std::wregex> CFiltering::ExcludeFilesRegex;
-std::vector<std::wregex> CFiltering::IncludeDirsRegex;
-std::vector<std::wregex> CFiltering::IncludeFilesRegex;
+std::vector<CFiltering::FilterPattern> CFiltering::ExcludeDirsPatterns;
+CFiltering::NameFilter CFiltering::ExcludeFilesPatterns;
+std::vector<CFiltering::FilterPattern> CFiltering::IncludeDirsPatterns;
+CFiltering::NameFilter CFiltering::IncludeFilesPatterns;
 std::vector<std::wstring> CFiltering::IncludeDirsAnchors;
 ULONGLONG CFiltering::SizeMinimumCalculated = 0;
 FILETIME  CFiltering::MaxAgeFileTimeCutoff  = {};
 bool      CFiltering::FilterActive          = false;
+std::atomic<ULONGLONG> CFiltering::EvaluationNanoseconds = 0;
 
 // --- Private helpers ---
 
@@ -62,6 +63,53 @@ static bool CompareFileAge(const FILETIME& lastWriteTime, const FILETIME& cutoff
     return comparison == 1 ? (lastWriteCmp < 0) : (lastWriteCmp > 0);
 }
 
+// Moves patterns that only name an extension ("*.txt", or ".*\.txt" as a regex)
+// or a literal file name into the filter's hash sets. Anything using wildcards
+// beyond the leading star is left for the general matcher.
+static bool AddToLookup(const std::wstring_view pattern, const bool useRegex, CFiltering::NameFilter& filter)
+{
+    const auto fold = [](const std::wstring_view text)
+    {
+        std::wstring folded(text);
+        std::ranges::transform(folded, folded.begin(), FoldCase);
+        return folded;
+    };
+
+    if (!useRegex)
+    {
+        if (pattern.starts_with(L"*.") && pattern.find_first_of(L"*?.", 2) == std::wstring_view::npos)
+        {
+            filter.extensions.emplace(fold(pattern.substr(2)));
+            return true;
+        }
+        if (pattern.find_first_of(L"*?") == std::wstring_view::npos)
+        {
+            filter.names.emplace(fold(pattern));
+            return true;
+        }
+        return false;
+    }
+
+    // Regular expressions qualify only when built from plain word characters and escaped dots
+    std::wstring_view body = pattern;
+    if (body.starts_with(L'^')) body.remove_prefix(1);
+    if (body.ends_with(L'$') && !body.ends_with(L"\\$")) body.remove_suffix(1);
+    const bool isExtension = body.starts_with(L".*\\.");
+    if (isExtension) body.remove_prefix(4);
+
+    std::wstring literal;
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        if (body[i] == L'\\' && i + 1 < body.size() && body[i + 1] == L'.' && !isExtension) literal.push_back(body[++i]);
+        else if (std::iswalnum(body[i]) || body[i] == L'_' || body[i] == L'-' || body[i] == L' ') literal.push_back(body[i]);
+        else return false;
+    }
+    if (literal.empty()) return false;
+
+    (isExtension ? filter.extensions : filter.names).emplace(fold(literal));
+    return true;
+}
+
 // Extracts the longest fixed-path prefix from an include-dir pattern that can
 // be used as a scan anchor (i.e., the deepest directory that must exist for
 // the pattern to ever match). Examples:
@@ -144,21 +192,23 @@ std::wstring CFiltering::NormalizePathRegex(const std::wstring_view pattern)
 
 void CFiltering::CompileFilters()
 {
-    ExcludeDirsRegex.clear();
-    ExcludeFilesRegex.clear();
-    IncludeDirsRegex.clear();
-    IncludeFilesRegex.clear();
+    ExcludeDirsPatterns.clear();
+    ExcludeFilesPatterns.clear();
+    IncludeDirsPatterns.clear();
+    IncludeFilesPatterns.clear();
     IncludeDirsAnchors.clear();
 
-    for (const auto& [optionString, optionRegex] : {
-        std::pair{COptions::FilteringExcludeDirs.Obj(), std::ref(ExcludeDirsRegex)},
-        std::pair{COptions::FilteringExcludeFiles.Obj(), std::ref(ExcludeFilesRegex)},
-        std::pair{COptions::FilteringIncludeDirs.Obj(), std::ref(IncludeDirsRegex)},
-        std::pair{COptions::FilteringIncludeFiles.Obj(), std::ref(IncludeFilesRegex)}})
+    for (const auto& [optionString, optionPatterns] : {
+        std::pair{COptions::FilteringExcludeDirs.Obj(), std::ref(ExcludeDirsPatterns)},
+        std::pair{COptions::FilteringExcludeFiles.Obj(), std::ref(ExcludeFilesPatterns.patterns)},
+        std::pair{COptions::FilteringIncludeDirs.Obj(), std::ref(IncludeDirsPatterns)},
+        std::pair{COptions::FilteringIncludeFiles.Obj(), std::ref(IncludeFilesPatterns.patterns)}})
     {
-        const bool isIncludeDirs = &optionRegex.get() == &IncludeDirsRegex;
-        const bool isExcludeDirs = &optionRegex.get() == &ExcludeDirsRegex;
+        const bool isIncludeDirs = &optionPatterns.get() == &IncludeDirsPatterns;
+        const bool isExcludeDirs = &optionPatterns.get() == &ExcludeDirsPatterns;
         const bool isPathFilter = isIncludeDirs || isExcludeDirs;
+        NameFilter* const nameFilter = &optionPatterns.get() == &ExcludeFilesPatterns.patterns ? &ExcludeFilesPatterns :
+            &optionPatterns.get() == &IncludeFilesPatterns.patterns ? &IncludeFilesPatterns : nullptr;
         for (auto& token : SplitString(optionString, L'\n'))
         {
             try
@@ -171,11 +221,24 @@ void CFiltering::CompileFilters()
                 const std::wstring normalized = (COptions::FilteringUseRegex && isPathFilter)
                     ? NormalizePathRegex(token) : token;
 
-                // Directory filters apply to the directory itself and everything below it.
-                std::wstring expr = COptions::FilteringUseRegex ? normalized : GlobToRegex(normalized, false);
-                if (isIncludeDirs || isExcludeDirs) expr = MatchDirectoryAndDescendants(std::move(expr));
-                optionRegex.get().emplace_back(expr,
-                    std::regex_constants::icase | std::regex_constants::optimize);
+                // Simple file name filters skip pattern matching entirely
+                if (nameFilter != nullptr && AddToLookup(normalized, COptions::FilteringUseRegex, *nameFilter))
+                {
+                    continue;
+                }
+
+                // Directory filters apply to the directory itself and everything below it;
+                // compiled globs check ancestors when matching instead
+                if (!COptions::FilteringUseRegex)
+                {
+                    optionPatterns.get().emplace_back(std::in_place_type<CGlobMatcher>, normalized);
+                }
+                else
+                {
+                    const std::wstring expr = isPathFilter ? MatchDirectoryAndDescendants(normalized) : normalized;
+                    optionPatterns.get().emplace_back(std::in_place_type<std::wregex>, expr,
+                        std::regex_constants::icase | std::regex_constants::optimize);
+                }
 
                 if (isIncludeDirs)
                 {
@@ -202,8 +265,8 @@ void CFiltering::CompileFilters()
     }
 
     // Cache whether any filter is active so callers can short-circuit cheaply
-    FilterActive = !ExcludeDirsRegex.empty() || !ExcludeFilesRegex.empty() ||
-                   !IncludeDirsRegex.empty()  || !IncludeFilesRegex.empty() ||
+    FilterActive = !ExcludeDirsPatterns.empty() || !ExcludeFilesPatterns.empty() ||
+                   !IncludeDirsPatterns.empty()  || !IncludeFilesPatterns.empty() ||
                    SizeMinimumCalculated != 0  ||
                    std::bit_cast<ULONGLONG>(MaxAgeFileTimeCutoff) != 0;
 
@@ -217,28 +280,49 @@ std::wstring_view CFiltering::WithoutTrailingBackslashes(std::wstring_view path)
     return path;
 }
 
-bool CFiltering::MatchesAnyPath(const std::wstring& path, const std::vector<std::wregex>& patterns)
+bool CFiltering::MatchesAnyPath(const std::wstring& path, const std::vector<FilterPattern>& patterns)
 {
-    if (patterns.empty()) return false;
+    const std::wstring_view trimmed = WithoutTrailingBackslashes(path);
+    return std::ranges::any_of(patterns, [&](const auto& pattern)
+    {
+        if (const auto* glob = std::get_if<CGlobMatcher>(&pattern)) return glob->MatchesPathOrAncestor(path);
 
-    const auto matches = [&patterns](std::wstring_view candidate)
+        const auto& regex = std::get<std::wregex>(pattern);
+        return std::regex_match(path, regex) ||
+            trimmed.size() != path.size() && std::regex_match(trimmed.begin(), trimmed.end(), regex);
+    });
+}
+
+bool CFiltering::MatchesAnyName(const std::wstring& name, const std::vector<FilterPattern>& patterns)
+{
+    return std::ranges::any_of(patterns, [&name](const auto& pattern)
     {
-        return std::ranges::any_of(patterns,
-            [&candidate](const auto& pattern) { return std::regex_match(candidate.begin(), candidate.end(), pattern); });
-    };
+        if (const auto* glob = std::get_if<CGlobMatcher>(&pattern)) return glob->Matches(name);
+        return std::regex_match(name, std::get<std::wregex>(pattern));
+    });
+}
 
-    if (matches(path)) return true;
+bool CFiltering::MatchesAnyName(const std::wstring& name, const NameFilter& filter)
+{
+    if (!filter.extensions.empty() || !filter.names.empty())
+    {
+        thread_local std::wstring folded;
+        folded.resize(name.size());
+        std::ranges::transform(name, folded.begin(), FoldCase);
 
-    const std::wstring_view trimmed = WithoutTrailingBackslashes(path);
-    return trimmed != path && matches(trimmed);
+        if (filter.names.contains(folded)) return true;
+        if (const size_t dot = folded.rfind(L'.'); dot != std::wstring::npos &&
+            filter.extensions.contains(std::wstring_view(folded).substr(dot + 1))) return true;
+    }
+    return MatchesAnyName(name, filter.patterns);
 }
 
 bool CFiltering::IsFilteredOut(const std::wstring& directoryName)
 {
     if (!FilterActive) return false;
-    if (MatchesAnyPath(directoryName, ExcludeDirsRegex)) return true;
-    if (IncludeDirsRegex.empty()) return false;
-    if (MatchesAnyPath(directoryName, IncludeDirsRegex)) return false;
+    if (MatchesAnyPath(directoryName, ExcludeDirsPatterns)) return true;
+    if (IncludeDirsPatterns.empty()) return false;
+    if (MatchesAnyPath(directoryName, IncludeDirsPatterns)) return false;
 
     // Check if path is the same as or an ancestor of any include-anchor,
     // meaning we still need to descend into this directory to reach an included one.
@@ -253,27 +337,17 @@ bool CFiltering::IsFilteredOut(const std::wstring& directoryName)
     });
 }
 
-bool CFiltering::IsFilteredOut(const std::wstring& fileName, const std::wstring& filePath,
+bool CFiltering::IsFileFilteredOut(const std::wstring& fileName,
     const ULONGLONG fileSizeLogical, const FILETIME& lastWriteTime)
 {
-    if (!FilterActive) return false;
-
     // Exclude files matching name filter
-    if (!ExcludeFilesRegex.empty() && std::ranges::any_of(ExcludeFilesRegex,
-        [&fileName](const auto& pattern) { return std::regex_match(fileName, pattern); }))
-    {
-        return true;
-    }
-
-    // Include only files whose path matches the include directory filter
-    if (!IncludeDirsRegex.empty() && !MatchesAnyPath(filePath, IncludeDirsRegex))
+    if (MatchesAnyName(fileName, ExcludeFilesPatterns))
     {
         return true;
     }
 
     // Include only files whose name matches the include name filter
-    if (!IncludeFilesRegex.empty() && std::ranges::none_of(IncludeFilesRegex,
-        [&fileName](const auto& pattern) { return std::regex_match(fileName, pattern); }))
+    if (!IncludeFilesPatterns.empty() && !MatchesAnyName(fileName, IncludeFilesPatterns))
     {
         return true;
     }
@@ -295,10 +369,192 @@ bool CFiltering::IsFilteredOut(const std::wstring& fileName, const std::wstring&
     return false;
 }
 
+bool CFiltering::IsFilteredOut(const std::wstring& fileName, const std::wstring& filePath,
+    const ULONGLONG fileSizeLogical, const FILETIME& lastWriteTime)
+{
+    if (!FilterActive) return false;
+
+    // Include only files whose path matches the include directory filter
+    if (!IncludeDirsPatterns.empty() && !MatchesAnyPath(filePath, IncludeDirsPatterns))
+    {
+        return true;
+    }
+
+    return IsFileFilteredOut(fileName, fileSizeLogical, lastWriteTime);
+}
+
 bool CFiltering::IsFilteredOut(const CItem* item)
 {
     if (item->IsTypeOrFlag(IT_FILE))
-        return IsFilteredOut(item->GetName(), item->GetPath(),
+        return IsFilteredOut(item->GetName(), item->GetPathRef(),
             item->GetSizeLogical(), item->GetLastChange());
-    return IsFilteredOut(item->GetPath());
+    return IsFilteredOut(item->GetPathRef());
+}
+
+// --- Directory scopes ---
+
+CFiltering::DirectoryScope::DirectoryScope(const std::wstring& directoryPath)
+{
+    if (!FilterActive) return;
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto isRegex = [](const auto& pattern) { return std::holds_alternative<std::wregex>(pattern); };
+    m_useRegex = std::ranges::any_of(ExcludeDirsPatterns, isRegex) || std::ranges::any_of(IncludeDirsPatterns, isRegex);
+
+    // Walk each glob along the path, keeping those that may still match further down
+    const std::wstring_view trimmed = WithoutTrailingBackslashes(directoryPath);
+    const auto walkPatterns = [&](const std::vector<FilterPattern>& patterns, std::vector<Walk>& walks)
+    {
+        if (m_useRegex) return MatchesAnyPath(directoryPath, patterns);
+
+        bool matched = false;
+        for (const auto& pattern : patterns)
+        {
+            const auto& glob = std::get<CGlobMatcher>(pattern);
+            size_t state = 0;
+            wchar_t separator = L'\0';
+            for (size_t next = 0; state != CGlobMatcher::NO_MATCH && !glob.IsComplete(state);)
+            {
+                const size_t end = std::min(trimmed.size(), trimmed.find(L'\\', next));
+                state = glob.Advance(state, separator, trimmed.substr(next, end - next));
+                if (end == trimmed.size()) break;
+                separator = L'\\';
+                next = end + 1;
+            }
+
+            // Completing at any backslash covers the directory; a root also offers its trailing backslash
+            if (glob.IsComplete(state) || trimmed.size() < directoryPath.size() && glob.IsComplete(
+                glob.Advance(state, L'\\', std::wstring_view(directoryPath).substr(trimmed.size() + 1))))
+            {
+                matched = true;
+            }
+            else if (state != CGlobMatcher::NO_MATCH) walks.push_back({ &glob, state });
+        }
+        return matched;
+    };
+
+    m_excluded = walkPatterns(ExcludeDirsPatterns, m_excludeWalks);
+    if (!m_excluded && !IncludeDirsPatterns.empty())
+    {
+        m_included = walkPatterns(IncludeDirsPatterns, m_includeWalks);
+
+        // Keep the rest of each include anchor this directory leads to
+        for (const auto& anchor : IncludeDirsAnchors)
+        {
+            const std::wstring_view a = WithoutTrailingBackslashes(anchor);
+            if (a.empty()) m_anyAnchor = true;
+            else if (!trimmed.empty() && trimmed.size() <= a.size() &&
+                _wcsnicmp(trimmed.data(), a.data(), trimmed.size()) == 0)
+            {
+                if (trimmed.size() == a.size()) m_anchorRests.emplace_back();
+                else if (a[trimmed.size()] == L'\\') m_anchorRests.push_back(a.substr(trimmed.size() + 1));
+            }
+        }
+        m_filteredOut = !m_included && !m_anyAnchor && m_anchorRests.empty();
+    }
+    m_filteredOut |= m_excluded;
+
+    if (m_useRegex) m_base = std::wstring(trimmed) + L'\\';
+    m_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+CFiltering::DirectoryScope::DirectoryScope(const DirectoryScope& parent, const std::wstring_view name) :
+    m_useRegex(parent.m_useRegex), m_excluded(parent.m_excluded), m_included(parent.m_included), m_anyAnchor(parent.m_anyAnchor)
+{
+    if (!FilterActive) return;
+    const auto start = std::chrono::steady_clock::now();
+
+    // Regular expressions see the full path, which extends the parent's by this name
+    const std::wstring path = m_useRegex ? parent.m_base + std::wstring(name) : std::wstring();
+    m_excluded = m_excluded || (m_useRegex ? MatchesAnyPath(path, ExcludeDirsPatterns) :
+        AdvanceAll(parent.m_excludeWalks, name, m_excludeWalks));
+    if (!m_excluded && !IncludeDirsPatterns.empty())
+    {
+        m_included = m_included || (m_useRegex ? MatchesAnyPath(path, IncludeDirsPatterns) :
+            AdvanceAll(parent.m_includeWalks, name, m_includeWalks));
+
+        // Anchors the parent leads to continue only through this name
+        for (const std::wstring_view rest : parent.m_anchorRests)
+        {
+            if (rest.size() < name.size() || _wcsnicmp(rest.data(), name.data(), name.size()) != 0) continue;
+            if (rest.size() == name.size()) m_anchorRests.emplace_back();
+            else if (rest[name.size()] == L'\\') m_anchorRests.push_back(rest.substr(name.size() + 1));
+        }
+        m_filteredOut = !m_included && !m_anyAnchor && m_anchorRests.empty();
+    }
+    m_filteredOut |= m_excluded;
+
+    if (m_useRegex) m_base = path + L'\\';
+    m_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+CFiltering::DirectoryScope::~DirectoryScope()
+{
+    if (m_nanoseconds > 0) EvaluationNanoseconds += m_nanoseconds;
+}
+
+bool CFiltering::DirectoryScope::CompletesAny(const std::vector<Walk>& walks, const std::wstring_view name)
+{
+    return std::ranges::any_of(walks, [name](const Walk& walk)
+    {
+        return walk.glob->IsComplete(walk.glob->Advance(walk.state, L'\\', name));
+    });
+}
+
+bool CFiltering::DirectoryScope::AdvanceAll(const std::vector<Walk>& walks, const std::wstring_view name,
+    std::vector<Walk>& advanced)
+{
+    // Walks that still match below the name carry on; one completing covers the directory
+    for (const auto& [glob, state] : walks)
+    {
+        const size_t next = glob->Advance(state, L'\\', name);
+        if (glob->IsComplete(next)) return true;
+        if (next != CGlobMatcher::NO_MATCH) advanced.push_back({ glob, next });
+    }
+    return false;
+}
+
+template <typename Check>
+bool CFiltering::DirectoryScope::Timed(Check check) const
+{
+    if (!FilterActive) return false;
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool result = check();
+    m_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+bool CFiltering::DirectoryScope::IsFileFilteredOut(const std::wstring& name,
+    const ULONGLONG fileSizeLogical, const FILETIME& lastWriteTime) const
+{
+    return Timed([&]
+    {
+        // Include only files whose path matches the include directory filter
+        if (!IncludeDirsPatterns.empty() && !m_included &&
+            !(m_useRegex ? MatchesAnyPath(m_base + name, IncludeDirsPatterns) : CompletesAny(m_includeWalks, name)))
+        {
+            return true;
+        }
+
+        return CFiltering::IsFileFilteredOut(name, fileSizeLogical, lastWriteTime);
+    });
+}
+
+// --- Pending scopes ---
+
+void CPendingFilterScopes::Push(const CItem* item, std::unique_ptr<const CFiltering::DirectoryScope> scope)
+{
+    std::scoped_lock lock(m_mutex);
+    m_scopes.insert_or_assign(item, std::move(scope));
+}
+
+std::unique_ptr<const CFiltering::DirectoryScope> CPendingFilterScopes::Take(const CItem* item)
+{
+    std::scoped_lock lock(m_mutex);
+    auto node = m_scopes.extract(item);
+    return node.empty() ? nullptr : std::move(node.mapped());
 }
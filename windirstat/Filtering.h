@@ -18,30 +18,112 @@
 #pragma once
 
 #include "pch.h"
+#include "GlobMatcher.h"
 
 class CFiltering final
 {
     static std::wstring ExtractIncludeAnchor(std::wstring_view pattern, bool useRegex);
     static std::wstring NormalizePathRegex(std::wstring_view pattern);
+    static bool IsFileFilteredOut(const std::wstring& fileName, ULONGLONG fileSizeLogical, const FILETIME& lastWriteTime);
 
 public:
     CFiltering() = delete;
 
-    static std::vector<std::wregex> ExcludeDirsRegex;
-    static std::vector<std::wregex> ExcludeFilesRegex;
-    static std::vector<std::wregex> IncludeDirsRegex;
-    static std::vector<std::wregex> IncludeFilesRegex;
+    // Globs are compiled to a dedicated matcher; only regex mode uses std::wregex
+    using FilterPattern = std::variant<CGlobMatcher, std::wregex>;
+
+    // File name filters of the form "*.ext" or a plain name are answered by one
+    // hash lookup; only the remaining patterns are matched one at a time
+    struct NameFilter
+    {
+        std::unordered_set<std::wstring, string_hash, std::equal_to<>> extensions; // Folded, after the last dot
+        std::unordered_set<std::wstring, string_hash, std::equal_to<>> names;      // Folded
+        std::vector<FilterPattern> patterns;
+
+        bool empty() const noexcept { return extensions.empty() && names.empty() && patterns.empty(); }
+        void clear() { extensions.clear(); names.clear(); patterns.clear(); }
+    };
+
+    static std::vector<FilterPattern> ExcludeDirsPatterns;
+    static NameFilter ExcludeFilesPatterns;
+    static std::vector<FilterPattern> IncludeDirsPatterns;
+    static NameFilter IncludeFilesPatterns;
     static std::vector<std::wstring> IncludeDirsAnchors;
     static ULONGLONG SizeMinimumCalculated;
     static FILETIME MaxAgeFileTimeCutoff;
     static bool FilterActive;
+    static std::atomic<ULONGLONG> EvaluationNanoseconds; // Total time spent in directory scopes
+
+    //
+    // Filter state for the entries of one directory. The directory's path is
+    // walked once and each glob that may still match below it keeps its place,
+    // so entries are then checked by their name alone and no path is built.
+    // A subdirectory's scope continues from its parent's by one name.
+    // Regular expressions cannot resume mid-path and still see full paths.
+    //
+    class DirectoryScope final
+    {
+    public:
+
+        explicit DirectoryScope(const std::wstring& directoryPath);
+        DirectoryScope(const DirectoryScope& parent, std::wstring_view name);
+        ~DirectoryScope();
+
+        DirectoryScope(const DirectoryScope&) = delete;
+        DirectoryScope& operator=(const DirectoryScope&) = delete;
+
+        bool IsFilteredOut() const noexcept { return m_filteredOut; }
+        bool IsFileFilteredOut(const std::wstring& name, ULONGLONG fileSizeLogical, const FILETIME& lastWriteTime) const;
+
+    private:
+
+        struct Walk
+        {
+            const CGlobMatcher* glob;
+            size_t state;
+        };
+
+        static bool CompletesAny(const std::vector<Walk>& walks, std::wstring_view name);
+        static bool AdvanceAll(const std::vector<Walk>& walks, std::wstring_view name, std::vector<Walk>& advanced);
+        template <typename Check> bool Timed(Check check) const;
+
+        std::vector<Walk> m_excludeWalks;
+        std::vector<Walk> m_includeWalks;
+        std::vector<std::wstring_view> m_anchorRests; // Parts of include anchors below this directory
+        std::wstring m_base;                          // Path with a trailing backslash in regex mode
+        mutable ULONGLONG m_nanoseconds = 0;
+        bool m_useRegex = false;
+        bool m_excluded = false;
+        bool m_included = false;                      // Matched by an include filter, as are all entries
+        bool m_anyAnchor = false;                     // An include filter may match anywhere
+        bool m_filteredOut = false;
+    };
 
     static void CompileFilters();
     static bool IsFilterActive() { return FilterActive; }
     static std::wstring_view WithoutTrailingBackslashes(std::wstring_view path);
-    static bool MatchesAnyPath(const std::wstring& path, const std::vector<std::wregex>& patterns);
+    static bool MatchesAnyPath(const std::wstring& path, const std::vector<FilterPattern>& patterns);
+    static bool MatchesAnyName(const std::wstring& name, const std::vector<FilterPattern>& patterns);
+    static bool MatchesAnyName(const std::wstring& name, const NameFilter& filter);
     static bool IsFilteredOut(const std::wstring& directoryName);
     static bool IsFilteredOut(const std::wstring& fileName, const std::wstring& filePath,
         ULONGLONG fileSizeLogical, const FILETIME& lastWriteTime);
     static bool IsFilteredOut(const CItem* item);
 };
+
+//
+// CPendingFilterScopes. Holds the filter scopes of queued directories from
+// the moment their parent queues them until a worker starts enumerating them.
+//
+class CPendingFilterScopes final
+{
+public:
+
+    void Push(const CItem* item, std::unique_ptr<const CFiltering::DirectoryScope> scope);
+    std::unique_ptr<const CFiltering::DirectoryScope> Take(const CItem* item);
+
+private:
+
+    std::mutex m_mutex;
+    std::unordered_map<const CItem*, std::unique_ptr<const CFiltering::DirectoryScope>> m_scopes;
+};
@@ -81,6 +81,15 @@ public:
         return path;
     }
 
+    // Same as above but reuses a caller-owned buffer when a prefix must be added
+    static const std::wstring& MakeLongPathCompatible(const std::wstring& path, std::wstring& buffer)
+    {
+        if (path.find(L":\\", 1) == 1) return buffer.assign(s_longPath).append(path);
+        if (path.starts_with(L"\\\\?")) return path;
+        if (path.starts_with(L"\\\\")) return buffer.assign(s_longUNCPath).append(path, 2);
+        return path;
+    }
+
     using REPARSE_DATA_BUFFER = struct REPARSE_DATA_BUFFER {
         ULONG  ReparseTag;
         USHORT ReparseDataLength;
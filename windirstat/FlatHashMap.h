@@ -0,0 +1,166 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// CFlatHashMap. Hash map whose entries live contiguously in one vector and
+// are found through a power-of-two table of entry indices using linear
+// probing. Lookups touch one index slot and one entry instead of chasing a
+// node per element, and iteration walks the vector. Erasing moves the last
+// entry into the hole, so erasure invalidates iterators and references to
+// the moved entry; references to other entries stay valid until the next
+// insertion grows the vector.
+//
+template<typename K, typename V, typename Hash = std::hash<K>>
+class CFlatHashMap final
+{
+public:
+
+    using value_type = std::pair<K, V>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    iterator begin() noexcept { return m_entries.begin(); }
+    iterator end() noexcept { return m_entries.end(); }
+    const_iterator begin() const noexcept { return m_entries.begin(); }
+    const_iterator end() const noexcept { return m_entries.end(); }
+    size_t size() const noexcept { return m_entries.size(); }
+    bool empty() const noexcept { return m_entries.empty(); }
+
+    iterator find(const K& key)
+    {
+        const size_t slot = FindSlot(key);
+        return m_slots.empty() || m_slots[slot] == EMPTY ? end() : begin() + m_slots[slot];
+    }
+
+    const_iterator find(const K& key) const
+    {
+        const size_t slot = FindSlot(key);
+        return m_slots.empty() || m_slots[slot] == EMPTY ? end() : begin() + m_slots[slot];
+    }
+
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(const K& key, Args&&... args)
+    {
+        if ((m_entries.size() + 1) * 8 > m_slots.size() * 7) Rehash(std::max<size_t>(16, m_slots.size() * 2));
+        const size_t slot = FindSlot(key);
+        if (m_slots[slot] != EMPTY) return { begin() + m_slots[slot], false };
+
+        m_slots[slot] = static_cast<Index>(m_entries.size());
+        m_entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return { std::prev(end()), true };
+    }
+
+    V& operator[](const K& key) { return emplace(key).first->second; }
+
+    iterator erase(const_iterator position)
+    {
+        const auto index = static_cast<Index>(position - begin());
+        RemoveSlot(FindSlot(m_entries[index].first));
+
+        // Fill the hole with the last entry and repoint its slot
+        if (const auto last = static_cast<Index>(m_entries.size() - 1); index != last)
+        {
+            m_slots[FindSlot(m_entries[last].first)] = index;
+            m_entries[index] = std::move(m_entries[last]);
+        }
+        m_entries.pop_back();
+        return begin() + index;
+    }
+
+    size_t erase(const K& key)
+    {
+        const auto it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    template<typename Predicate>
+    friend size_t erase_if(CFlatHashMap& map, Predicate predicate)
+    {
+        const size_t before = map.size();
+        for (auto it = map.begin(); it != map.end();)
+        {
+            if (predicate(std::as_const(*it))) it = map.erase(it);
+            else ++it;
+        }
+        return before - map.size();
+    }
+
+    void clear() noexcept
+    {
+        m_entries.clear();
+        m_slots.clear();
+    }
+
+private:
+
+    using Index = std::uint32_t;
+    static constexpr Index EMPTY = std::numeric_limits<Index>::max();
+
+    size_t HomeSlot(const K& key) const noexcept
+    {
+        // Fibonacci hashing spreads weak hashes such as pointers across the table
+        return static_cast<size_t>((static_cast<std::uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+
+    // Slot holding the key, or the empty slot where it would be inserted
+    size_t FindSlot(const K& key) const
+    {
+        if (m_slots.empty()) return 0;
+        const size_t mask = m_slots.size() - 1;
+        for (size_t slot = HomeSlot(key);; slot = (slot + 1) & mask)
+        {
+            if (m_slots[slot] == EMPTY || m_entries[m_slots[slot]].first == key) return slot;
+        }
+    }
+
+    void RemoveSlot(size_t hole)
+    {
+        // Shift later members of the probe run back so no lookup stops early at the hole
+        const size_t mask = m_slots.size() - 1;
+        for (size_t slot = (hole + 1) & mask; m_slots[slot] != EMPTY; slot = (slot + 1) & mask)
+        {
+            const size_t home = HomeSlot(m_entries[m_slots[slot]].first);
+            if (((slot - home) & mask) < ((slot - hole) & mask)) continue;
+            m_slots[hole] = m_slots[slot];
+            hole = slot;
+        }
+        m_slots[hole] = EMPTY;
+    }
+
+    void Rehash(const size_t slotCount)
+    {
+        m_slots.assign(slotCount, EMPTY);
+        m_shift = 64 - std::countr_zero(slotCount);
+        for (Index index = 0; index < m_entries.size(); ++index)
+        {
+            m_slots[FindSlot(m_entries[index].first)] = index;
+        }
+    }
+
+    std::vector<value_type> m_entries;
+    std::vector<Index> m_slots;
+    int m_shift = 64;
+};
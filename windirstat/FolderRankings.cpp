@@ -0,0 +1,288 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "FolderRankings.h"
+
+static constexpr ULONGLONG KEY_BASIS = 14695981039346656037ull;
+static constexpr ULONGLONG KEY_PRIME = 1099511628211ull;
+
+namespace
+{
+    constexpr DWORD SNAPSHOTS_MAGIC = 0x46534457; // "WDSF"
+    constexpr DWORD SNAPSHOTS_VERSION = 1;
+
+    // On-disk layouts are spelled out field by field with no implicit padding
+    struct SnapshotsHeader
+    {
+        DWORD magic;
+        DWORD version;
+        ULONGLONG count;
+    };
+
+    struct SnapshotHeader
+    {
+        ULONGLONG rootKey;
+        ULONGLONG count;
+    };
+
+    struct SnapshotRecord
+    {
+        ULONGLONG key;
+        ULONGLONG size;
+    };
+
+    static_assert(sizeof(SnapshotsHeader) == 16 && std::has_unique_object_representations_v<SnapshotsHeader>);
+    static_assert(sizeof(SnapshotHeader) == 16 && std::has_unique_object_representations_v<SnapshotHeader>);
+    static_assert(sizeof(SnapshotRecord) == 16 && std::has_unique_object_representations_v<SnapshotRecord>);
+}
+
+CFolderRankings::Worker::Worker(const size_t count) : heaps{
+    EntryHeap(count, &Entry::value), EntryHeap(count, &Entry::value),
+    EntryHeap(count, &Entry::value), EntryHeap(count, &Entry::value) } {}
+
+CFolderRankings::CFolderRankings(CItem* root, const size_t count, const Snapshots& previous)
+{
+    const ULONGLONG start = GetTickCount64();
+    const size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    m_previous = &previous;
+
+    // Each thread keeps its own heaps and snapshots; the extra worker belongs to this thread
+    std::vector<Worker> workers;
+    workers.reserve(threadCount + 1);
+    for (size_t i = 0; i <= threadCount; i++) workers.emplace_back(count);
+    Worker& local = workers.back();
+
+    // Split the tree level by level until every thread has plenty of subtrees to take
+    std::vector<Unit> units;
+    Expand({ root, KEY_BASIS }, local, units);
+    const auto branches = [](const Unit& unit) { return !unit.folder->IsLeaf(); };
+    for (std::vector<Unit> next; units.size() < threadCount * 16 && std::ranges::any_of(units, branches); units.swap(next))
+    {
+        next.clear();
+        for (const Unit& unit : units)
+        {
+            if (branches(unit)) Expand(unit, local, next);
+            else next.push_back(unit);
+        }
+    }
+
+    std::atomic<size_t> nextUnit = 0;
+    {
+        std::vector<std::jthread> threads;
+        for (size_t thread = 0; thread < threadCount; thread++) threads.emplace_back([&, thread]
+        {
+            std::vector<Unit> pending;
+            for (size_t unit; (unit = nextUnit++) < units.size();)
+            {
+                pending.assign(1, units[unit]);
+                while (!pending.empty())
+                {
+                    const Unit current = pending.back();
+                    pending.pop_back();
+                    Expand(current, workers[thread], pending);
+                }
+            }
+        });
+    }
+
+    size_t folders = 0;
+    std::unordered_map<ULONGLONG, Snapshot> snapshots;
+    for (auto& worker : workers)
+    {
+        if (&worker != &local)
+        {
+            for (const auto ranking : std::views::iota(0, +RankingCount))
+                local.heaps[ranking].Merge(std::move(worker.heaps[ranking]));
+        }
+        for (auto& [rootKey, snapshot] : worker.snapshots)
+        {
+            folders += snapshot.size();
+            if (auto& merged = snapshots[rootKey]; merged.empty()) merged = std::move(snapshot);
+            else merged.insert(merged.end(), snapshot.begin(), snapshot.end());
+        }
+        worker.snapshots.clear();
+    }
+
+    for (const auto ranking : std::views::iota(0, +RankingCount)) m_rankings[ranking] = local.heaps[ranking].Take();
+    for (auto& [rootKey, snapshot] : snapshots)
+    {
+        std::sort(std::execution::par, snapshot.begin(), snapshot.end());
+        m_snapshots.emplace_back(rootKey, std::move(snapshot));
+    }
+    m_previous = nullptr;
+    m_ticks = GetTickCount64() - start;
+
+    VTRACE(L"Folder rankings: {} folders on {} threads in {} ms, {} folders/s", folders,
+        threadCount, m_ticks, folders * 1000 / std::max(1ull, m_ticks));
+}
+
+std::wstring CFolderRankings::GetTitle(const Ranking ranking)
+{
+    switch (ranking)
+    {
+    case OwnSize: return Localization::Lookup(IDS_LARGEST_FOLDERS_OWN);
+    case TotalSize: return Localization::Lookup(IDS_LARGEST_FOLDERS);
+    case Files: return Localization::Lookup(IDS_FOLDERS_MOST_FILES);
+    case Growth: return Localization::Lookup(IDS_FOLDERS_FASTEST_GROWING);
+    default: return {};
+    }
+}
+
+void CFolderRankings::Expand(const Unit& unit, Worker& worker, std::vector<Unit>& pending) const
+{
+    // The computer root only groups the drives, which are keyed as if scanned alone
+    CItem* folder = unit.folder;
+    const bool grouping = !IsFolder(folder);
+    const ULONGLONG key = GetKey(unit.parentKey, folder->GetNameView());
+
+    // Scanned folders and drives rank against their own earlier snapshot
+    Unit scope = unit;
+    if (unit.rootKey == 0 && !grouping)
+    {
+        scope.rootKey = key;
+        const auto previous = std::ranges::find(*m_previous, key, &Snapshots::value_type::first);
+        scope.previous = previous != m_previous->end() ? &previous->second : nullptr;
+    }
+
+    // Files directly inside are summed here; only folders are visited on their own
+    ULONGLONG ownSize = 0;
+    if (!folder->IsLeaf()) for (CItem* child : folder->GetChildren())
+    {
+        if (child->IsTypeOrFlag(IT_FILE)) ownSize += child->GetSizeLogical();
+        else if (IsFolder(child)) pending.push_back({ child, grouping ? KEY_BASIS : key, scope.rootKey, scope.previous });
+    }
+    if (grouping) return;
+
+    const ULONGLONG totalSize = folder->GetSizeLogical();
+    worker.snapshots[scope.rootKey].emplace_back(key, totalSize);
+    if (ownSize > 0) worker.heaps[OwnSize].Push({ folder, ownSize });
+    if (totalSize > 0) worker.heaps[TotalSize].Push({ folder, totalSize });
+    if (const ULONG files = folder->GetFilesCount(); files > 0) worker.heaps[Files].Push({ folder, files });
+
+    // Folders missing from the snapshot are new and grew by their whole size
+    if (scope.previous == nullptr) return;
+    const auto it = std::ranges::lower_bound(*scope.previous, key, {}, &Snapshot::value_type::first);
+    const ULONGLONG previousSize = it != scope.previous->end() && it->first == key ? it->second : 0;
+    if (totalSize > previousSize) worker.heaps[Growth].Push({ folder, totalSize - previousSize });
+}
+
+ULONGLONG CFolderRankings::GetKey(ULONGLONG parentKey, const std::wstring_view name) noexcept
+{
+    // Names compare without case on Windows
+    parentKey = (parentKey ^ L'\\') * KEY_PRIME;
+    for (const wchar_t c : name) parentKey = (parentKey ^ FoldCase(c)) * KEY_PRIME;
+    return parentKey;
+}
+
+bool CFolderRankings::IsFolder(const CItem* item) noexcept
+{
+    return item->IsTypeOrFlag(IT_DIRECTORY, IT_DRIVE);
+}
+
+std::wstring CFolderRankings::GetSnapshotsPath()
+{
+    // Portable installs keep the snapshots beside the executable like the ini file
+    if (CDirStatApp::InPortableMode()) return GetAppFileName(L"folders");
+
+    CComHeapPtr<wchar_t> localAppData;
+    if (SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &localAppData) != S_OK) return {};
+    return (std::filesystem::path(static_cast<LPWSTR>(localAppData)) / L"WinDirStat" / L"FolderSnapshots.dat").wstring();
+}
+
+CFolderRankings::Snapshots CFolderRankings::LoadSnapshots()
+{
+    Snapshots snapshots;
+    const std::wstring path = GetSnapshotsPath();
+    if (path.empty()) return snapshots;
+
+    std::error_code ec;
+    ULONGLONG remaining = std::filesystem::file_size(path, ec);
+    std::ifstream file(path, std::ios::binary);
+    SnapshotsHeader header{};
+    if (ec || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != SNAPSHOTS_MAGIC || header.version != SNAPSHOTS_VERSION) return snapshots;
+    remaining -= sizeof(header);
+
+    // A snapshot cut short is dropped along with the ones after it
+    std::vector<SnapshotRecord> records;
+    for (ULONGLONG i = 0; i < std::min<ULONGLONG>(header.count, MAX_SNAPSHOTS); i++)
+    {
+        SnapshotHeader snapshotHeader{};
+        if (!file.read(reinterpret_cast<char*>(&snapshotHeader), sizeof(snapshotHeader))) break;
+        remaining -= sizeof(snapshotHeader);
+        if (snapshotHeader.count > remaining / sizeof(SnapshotRecord)) break;
+
+        records.resize(static_cast<size_t>(snapshotHeader.count));
+        if (!file.read(reinterpret_cast<char*>(records.data()),
+            static_cast<std::streamsize>(records.size() * sizeof(SnapshotRecord)))) break;
+        remaining -= records.size() * sizeof(SnapshotRecord);
+
+        Snapshot snapshot;
+        snapshot.reserve(records.size());
+        for (const auto& [key, size] : records) snapshot.emplace_back(key, size);
+        snapshots.emplace_back(snapshotHeader.rootKey, std::move(snapshot));
+    }
+    return snapshots;
+}
+
+void CFolderRankings::SaveSnapshots(const Snapshots& snapshots)
+{
+    const std::wstring path = GetSnapshotsPath();
+    if (path.empty()) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    // Write to a side file and swap so an interrupted save keeps the old snapshots
+    const std::wstring tempPath = path + L".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        const SnapshotsHeader header{ SNAPSHOTS_MAGIC, SNAPSHOTS_VERSION, snapshots.size() };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::vector<SnapshotRecord> records;
+        for (const auto& [rootKey, snapshot] : snapshots)
+        {
+            const SnapshotHeader snapshotHeader{ rootKey, snapshot.size() };
+            file.write(reinterpret_cast<const char*>(&snapshotHeader), sizeof(snapshotHeader));
+
+            records.clear();
+            for (const auto& [key, size] : snapshot) records.push_back({ key, size });
+            file.write(reinterpret_cast<const char*>(records.data()),
+                static_cast<std::streamsize>(records.size() * sizeof(SnapshotRecord)));
+        }
+        if (!file.flush()) return;
+    }
+
+    MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+bool CFolderRankings::MergeSnapshots(Snapshots& kept, Snapshots&& taken)
+{
+    // Snapshots that already lead the list unchanged would be put back where they are
+    if (taken.size() <= kept.size() && std::equal(taken.begin(), taken.end(), kept.begin())) return false;
+
+    // Folders and drives scanned again replace their snapshot; the least recent ones make room
+    std::erase_if(kept, [&](const auto& snapshot)
+    {
+        return std::ranges::find(taken, snapshot.first, &Snapshots::value_type::first) != taken.end();
+    });
+    kept.insert(kept.begin(), std::make_move_iterator(taken.begin()), std::make_move_iterator(taken.end()));
+    if (kept.size() > MAX_SNAPSHOTS) kept.resize(MAX_SNAPSHOTS);
+    return true;
+}
@@ -0,0 +1,98 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+#include "BoundedHeap.h"
+
+//
+// CFolderRankings. Ranks the folders of a scanned tree by the size of the files
+// directly inside them, by their total size, by their file count and by how
+// much they grew since an earlier snapshot. All rankings are filled in a single
+// walk over the tree on all cores, each thread keeping bounded heaps of its
+// own. The same walk records the total size of every folder as the snapshot
+// for the next ranking. Folders are keyed by a hash of their case folded path
+// that is extended one name at a time, so no path is ever built. Every scanned
+// folder or drive keeps a snapshot of its own, so a drive ranks against its
+// last scan whether it was scanned alone or with others, and the snapshots
+// are kept on disk for the next session.
+//
+class CFolderRankings final
+{
+public:
+
+    enum Ranking : BYTE { OwnSize, TotalSize, Files, Growth, RankingCount };
+
+    struct Entry
+    {
+        CItem* folder = nullptr;
+        ULONGLONG value = 0;
+    };
+
+    // Total size by folder key, sorted by key
+    using Snapshot = std::vector<std::pair<ULONGLONG, ULONGLONG>>;
+
+    // Snapshots by the key of the scanned folder or drive they were taken of, most recent first
+    using Snapshots = std::vector<std::pair<ULONGLONG, Snapshot>>;
+
+    CFolderRankings() = default;
+    CFolderRankings(CItem* root, size_t count, const Snapshots& previous);
+
+    const std::vector<Entry>& Get(const Ranking ranking) const noexcept { return m_rankings[ranking]; }
+    Snapshots TakeSnapshots() noexcept { return std::move(m_snapshots); }
+    ULONGLONG GetTicks() const noexcept { return m_ticks; }
+    static std::wstring GetTitle(Ranking ranking);
+
+    static Snapshots LoadSnapshots();
+    static void SaveSnapshots(const Snapshots& snapshots);
+    static bool MergeSnapshots(Snapshots& kept, Snapshots&& taken); // False when nothing changed
+
+private:
+
+    static constexpr size_t MAX_SNAPSHOTS = 32; // Folders and drives remembered at once
+
+    using EntryHeap = CBoundedHeap<Entry, decltype(&Entry::value)>;
+
+    // A folder still to be visited with the key of its parent and of the scanned folder or
+    // drive it belongs to; previous is the earlier snapshot of that folder or drive, if any
+    struct Unit
+    {
+        CItem* folder;
+        ULONGLONG parentKey;
+        ULONGLONG rootKey = 0;
+        const Snapshot* previous = nullptr;
+    };
+
+    struct Worker
+    {
+        explicit Worker(size_t count);
+
+        std::array<EntryHeap, RankingCount> heaps;
+        std::unordered_map<ULONGLONG, Snapshot> snapshots; // By root key
+    };
+
+    void Expand(const Unit& unit, Worker& worker, std::vector<Unit>& pending) const;
+    static ULONGLONG GetKey(ULONGLONG parentKey, std::wstring_view name) noexcept;
+    static bool IsFolder(const CItem* item) noexcept;
+    static std::wstring GetSnapshotsPath();
+
+    const Snapshots* m_previous = nullptr; // Only set while ranking
+    std::array<std::vector<Entry>, RankingCount> m_rankings;
+    Snapshots m_snapshots;
+    ULONGLONG m_ticks = 0;
+};
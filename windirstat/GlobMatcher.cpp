@@ -0,0 +1,137 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "GlobMatcher.h"
+
+CGlobMatcher::CGlobMatcher(const std::wstring_view glob)
+{
+    m_pattern.reserve(glob.size());
+    for (const wchar_t c : glob)
+    {
+        if (c == L'*' && !m_pattern.empty() && m_pattern.back() == L'*') continue;
+        m_pattern.push_back(c == L'*' || c == L'?' ? c : Fold(c));
+    }
+
+    // Lengths rather than views are kept so the matcher stays valid when copied
+    const size_t firstStar = m_pattern.find(L'*');
+    m_prefixLength = firstStar == std::wstring::npos ? m_pattern.size() : firstStar;
+    m_suffixLength = firstStar == std::wstring::npos ? 0 : m_pattern.size() - m_pattern.rfind(L'*') - 1;
+    m_minLength = m_pattern.size() - std::ranges::count(m_pattern, L'*');
+
+    // Split the same way per component for walking a path one name at a time
+    for (size_t start = 0, end = 0; end <= m_pattern.size(); start = ++end)
+    {
+        while (end < m_pattern.size() && !IsSeparator(m_pattern[end])) end++;
+
+        const std::wstring_view part = std::wstring_view(m_pattern).substr(start, end - start);
+        const size_t partStar = part.find(L'*');
+        m_components.push_back({ start == 0 ? L'\0' : m_pattern[start - 1], start, part.size(),
+            partStar == std::wstring_view::npos ? part.size() : partStar,
+            partStar == std::wstring_view::npos ? 0 : part.size() - part.rfind(L'*') - 1,
+            part.size() - std::ranges::count(part, L'*') });
+    }
+}
+
+bool CGlobMatcher::MatchesFixed(const std::wstring_view pattern, const std::wstring_view text) const
+{
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        if (pattern[i] == L'?' ? IsSeparator(text[i]) : pattern[i] != Fold(text[i])) return false;
+    }
+    return true;
+}
+
+bool CGlobMatcher::MatchesWildcards(const std::wstring_view middle, const std::wstring_view text) const
+{
+    // Only the latest star is ever extended: the segments before it were placed as early
+    // as possible and no star can absorb a separator, so extending an earlier star
+    // could not produce a match that this one misses
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::wstring_view::npos;
+    size_t starText = 0;
+    while (t < text.size())
+    {
+        if (p < middle.size() && middle[p] == L'*')
+        {
+            star = p++;
+            starText = t;
+        }
+        else if (p < middle.size() && (middle[p] == L'?' ? !IsSeparator(text[t]) : middle[p] == Fold(text[t])))
+        {
+            p++;
+            t++;
+        }
+        else if (star != std::wstring_view::npos && !IsSeparator(text[starText]))
+        {
+            p = star + 1;
+            t = ++starText;
+        }
+        else return false;
+    }
+
+    while (p < middle.size() && middle[p] == L'*') p++;
+    return p == middle.size();
+}
+
+bool CGlobMatcher::MatchesSplit(const std::wstring_view pattern, const size_t prefixLength,
+    const size_t suffixLength, const size_t minLength, const std::wstring_view text) const
+{
+    if (text.size() < minLength) return false;
+    if (prefixLength == pattern.size()) return text.size() == prefixLength && MatchesFixed(pattern, text);
+
+    return MatchesFixed(pattern.substr(0, prefixLength), text.substr(0, prefixLength)) &&
+        MatchesFixed(pattern.substr(pattern.size() - suffixLength), text.substr(text.size() - suffixLength)) &&
+        MatchesWildcards(pattern.substr(prefixLength, pattern.size() - prefixLength - suffixLength),
+            text.substr(prefixLength, text.size() - prefixLength - suffixLength));
+}
+
+bool CGlobMatcher::Matches(const std::wstring_view text) const
+{
+    return MatchesSplit(m_pattern, m_prefixLength, m_suffixLength, m_minLength, text);
+}
+
+bool CGlobMatcher::MatchesPathOrAncestor(const std::wstring_view path) const
+{
+    // Every candidate shares the path's start so a prefix mismatch rules them all out
+    if (path.size() < m_prefixLength || !MatchesFixed(Prefix(), path.substr(0, m_prefixLength))) return false;
+
+    for (size_t end = path.find(L'\\', m_minLength); end != std::wstring_view::npos; end = path.find(L'\\', end + 1))
+    {
+        if (Matches(path.substr(0, end))) return true;
+    }
+    return Matches(path);
+}
+
+size_t CGlobMatcher::Advance(size_t state, wchar_t separator, const std::wstring_view text) const
+{
+    // Wildcards never span a separator, so each text component pairs with one pattern component
+    for (size_t start = 0; state < m_components.size(); state++)
+    {
+        const size_t end = std::min(text.size(), text.find_first_of(L"\\/:", start));
+        const Component& component = m_components[state];
+        if (component.separator != separator || !MatchesSplit(
+            std::wstring_view(m_pattern).substr(component.offset, component.length), component.prefixLength,
+            component.suffixLength, component.minLength, text.substr(start, end - start))) return NO_MATCH;
+
+        if (end == text.size()) return state + 1;
+        separator = text[end];
+        start = end + 1;
+    }
+    return NO_MATCH;
+}
@@ -0,0 +1,83 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// CGlobMatcher. Case-insensitive glob pattern compiled for repeated matching.
+// It has the same semantics as the expression built by GlobToRegex: '*' matches
+// any run and '?' any single character other than a path separator, and all
+// other characters are literal. The literal prefix, suffix and minimum length
+// reject most candidates before the wildcard portion is examined, and that
+// portion is matched greedily without backtracking past a separator. Since no
+// wildcard crosses a separator, a path can also be matched one component at a
+// time so a walk down the tree only examines each new name.
+//
+class CGlobMatcher final
+{
+public:
+
+    static constexpr size_t NO_MATCH = SIZE_MAX;
+
+    explicit CGlobMatcher(std::wstring_view glob);
+
+    // Matches the whole text
+    bool Matches(std::wstring_view text) const;
+
+    // Matches the path itself or any of its ancestors, so a folder pattern covers its descendants
+    bool MatchesPathOrAncestor(std::wstring_view path) const;
+
+    // Continues a component walk: the state counts the pattern components matched so far,
+    // starting from zero, and the text follows the separator (zero at the start of a path)
+    size_t Advance(size_t state, wchar_t separator, std::wstring_view text) const;
+    bool IsComplete(const size_t state) const noexcept { return state == m_components.size(); }
+
+private:
+
+    // A run of the pattern between separators, split like the whole pattern
+    struct Component
+    {
+        wchar_t separator = 0;
+        size_t offset = 0;
+        size_t length = 0;
+        size_t prefixLength = 0;
+        size_t suffixLength = 0;
+        size_t minLength = 0;
+    };
+
+    static constexpr bool IsSeparator(const wchar_t c) noexcept { return c == L'\\' || c == L'/' || c == L':'; }
+
+    bool MatchesFixed(std::wstring_view pattern, std::wstring_view text) const;
+    bool MatchesWildcards(std::wstring_view middle, std::wstring_view text) const;
+    // The pattern splits into a prefix before the first star, the wildcard portion
+    // from the first star through the last one, and a suffix after the last star
+    bool MatchesSplit(std::wstring_view pattern, size_t prefixLength, size_t suffixLength,
+        size_t minLength, std::wstring_view text) const;
+    wchar_t Fold(const wchar_t c) const { return m_traits.translate_nocase(c); }
+
+    // The literal run before the first star
+    std::wstring_view Prefix() const noexcept { return std::wstring_view(m_pattern).substr(0, m_prefixLength); }
+
+    std::regex_traits<wchar_t> m_traits; // Folds case exactly like icase regular expressions
+    std::wstring m_pattern;              // Folded, with runs of stars collapsed
+    size_t m_prefixLength = 0;
+    size_t m_suffixLength = 0;
+    size_t m_minLength = 0;
+    std::vector<Component> m_components;
+};
@@ -0,0 +1,258 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "HashCache.h"
+
+namespace
+{
+    constexpr DWORD CACHE_MAGIC = 0x48534457; // "WDSH"
+    constexpr DWORD CACHE_VERSION = 2;
+
+    // On-disk layouts are spelled out field by field with no implicit padding
+    struct CacheHeader
+    {
+        DWORD magic;
+        DWORD version;
+        ULONGLONG count;
+        DWORD session;
+        DWORD reserved;
+    };
+
+    struct CacheRecord
+    {
+        ULONGLONG fileId;
+        ULONGLONG hashSizeLimit;
+        ULONGLONG size;
+        ULONGLONG lastWrite;
+        DWORD volumeSerial;
+        DWORD algorithm;
+        DWORD lastUsed;
+        BYTE hashLength;
+        std::array<BYTE, 16> hash;
+        std::array<BYTE, 3> reserved;
+    };
+
+    static_assert(sizeof(CacheHeader) == 24 && std::has_unique_object_representations_v<CacheHeader>);
+    static_assert(sizeof(CacheRecord) == 64 && std::has_unique_object_representations_v<CacheRecord>);
+}
+
+CHashCache* CHashCache::Get()
+{
+    static CHashCache instance;
+    return &instance;
+}
+
+std::wstring CHashCache::GetCachePath()
+{
+    // Portable installs keep the cache beside the executable like the ini file
+    if (CDirStatApp::InPortableMode()) return GetAppFileName(L"hashcache");
+
+    CComHeapPtr<wchar_t> localAppData;
+    if (SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &localAppData) != S_OK) return {};
+    return (std::filesystem::path(static_cast<LPWSTR>(localAppData)) / L"WinDirStat" / L"HashCache.dat").wstring();
+}
+
+DWORD CHashCache::GetVolumeSerial(const CItem* item)
+{
+    const std::wstring rootPath = item->GetVolumeRoot()->GetPath();
+
+    std::scoped_lock lock(m_volumeMutex);
+    if (const auto it = m_volumeSerials.find(rootPath); it != m_volumeSerials.end()) return it->second;
+
+    // Resolve the enclosing volume since the scan root may be any folder
+    DWORD serial = 0;
+    std::array<WCHAR, MAX_PATH> volumePath;
+    if (GetVolumePathName(rootPath.c_str(), volumePath.data(), static_cast<DWORD>(volumePath.size())))
+    {
+        GetVolumeInformation(volumePath.data(), nullptr, 0, &serial, nullptr, nullptr, nullptr, 0);
+    }
+    m_volumeSerials.emplace(rootPath, serial);
+    return serial;
+}
+
+bool CHashCache::MakeKey(const CItem* item, const ULONGLONG hashSizeLimit, const int algorithm, const HashLayout layout, Key& key)
+{
+    // Without a stable file ID there is nothing to key on
+    if (item->IsTypeOrFlag(ITF_MTP) || item->GetIndex() == 0) return false;
+
+    const DWORD serial = GetVolumeSerial(item);
+    if (serial == 0) return false;
+
+    key = { item->GetIndex(), hashSizeLimit, serial, static_cast<DWORD>(algorithm) | static_cast<DWORD>(layout) << 24 };
+    return true;
+}
+
+bool CHashCache::Lookup(const CItem* item, const ULONGLONG hashSizeLimit, const int algorithm, const HashLayout layout, std::vector<BYTE>& hash)
+{
+    if (!COptions::PersistHashCache) return false;
+    std::call_once(m_loaded, &CHashCache::Load, this);
+
+    const auto start = std::chrono::steady_clock::now();
+    bool found = false;
+    if (Key key; MakeKey(item, hashSizeLimit, algorithm, layout, key))
+    {
+        std::shared_lock lock(m_mutex);
+        if (const auto it = m_entries.find(key); it != m_entries.end() &&
+            it->second.size == item->GetSizeLogical() &&
+            it->second.lastWrite == std::bit_cast<ULONGLONG>(item->GetLastChange()))
+        {
+            hash.assign(it->second.hash.begin(), it->second.hash.begin() + it->second.hashLength);
+            found = true;
+
+            // Lookups share the lock so the session stamp is written atomically
+            if (const std::atomic_ref lastUsed(it->second.lastUsed); lastUsed.load(std::memory_order_relaxed) != m_session)
+            {
+                lastUsed.store(m_session, std::memory_order_relaxed);
+                m_dirty = true;
+            }
+        }
+    }
+
+    m_lookupNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (found) ++m_hits;
+    else ++m_misses;
+    return found;
+}
+
+void CHashCache::Store(const CItem* item, const ULONGLONG hashSizeLimit, const int algorithm, const HashLayout layout, const std::span<const BYTE> hash)
+{
+    if (!COptions::PersistHashCache || hash.empty() || hash.size() > MAX_HASH_SIZE) return;
+    std::call_once(m_loaded, &CHashCache::Load, this);
+
+    Key key;
+    if (!MakeKey(item, hashSizeLimit, algorithm, layout, key)) return;
+
+    Entry entry{ item->GetSizeLogical(), std::bit_cast<ULONGLONG>(item->GetLastChange()), {},
+        static_cast<BYTE>(hash.size()), m_session };
+    std::ranges::copy(hash, entry.hash.begin());
+
+    // Changed files overwrite their previous entry; new files push out the least recently used
+    std::unique_lock lock(m_mutex);
+    if (const auto it = m_entries.find(key); it != m_entries.end()) it->second = entry;
+    else
+    {
+        if (m_entries.size() >= MAX_ENTRIES) EvictLeastRecentlyUsed();
+        m_entries.emplace(key, entry);
+    }
+    m_dirty = true;
+}
+
+void CHashCache::EvictLeastRecentlyUsed()
+{
+    // Evict a batch at a time so a full cache does not sort on every new file
+    std::vector<std::pair<DWORD, Key>> ages;
+    ages.reserve(m_entries.size());
+    for (const auto& [key, entry] : m_entries) ages.emplace_back(entry.lastUsed, key);
+    const auto evicted = ages.begin() + static_cast<std::ptrdiff_t>(std::min(EVICTED_ENTRIES, ages.size()));
+    std::ranges::nth_element(ages, evicted, {}, &std::pair<DWORD, Key>::first);
+    for (const auto& key : std::ranges::subrange(ages.begin(), evicted) | std::views::values) m_entries.erase(key);
+}
+
+void CHashCache::Load()
+{
+    const std::wstring path = GetCachePath();
+    if (path.empty()) return;
+
+    std::ifstream file(path, std::ios::binary);
+    CacheHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) return;
+
+    std::unique_lock lock(m_mutex);
+    m_session = header.session + 1;
+    m_entries.reserve(static_cast<size_t>(std::min<ULONGLONG>(header.count, MAX_ENTRIES)));
+    for (ULONGLONG i = 0; i < header.count && m_entries.size() < MAX_ENTRIES; i++)
+    {
+        CacheRecord record;
+        static_assert(sizeof(record.hash) == MAX_HASH_SIZE);
+        if (!file.read(reinterpret_cast<char*>(&record), sizeof(record))) break;
+        if (record.hashLength == 0 || record.hashLength > MAX_HASH_SIZE) continue;
+        m_entries.emplace(Key{ record.fileId, record.hashSizeLimit, record.volumeSerial, record.algorithm },
+            Entry{ record.size, record.lastWrite, record.hash, record.hashLength, record.lastUsed });
+    }
+}
+
+void CHashCache::Save()
+{
+    if (!COptions::PersistHashCache) return;
+
+    const std::wstring path = GetCachePath();
+    if (path.empty()) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    // Write to a side file and swap so an interrupted save keeps the old cache
+    std::scoped_lock saveLock(m_saveMutex);
+    const std::wstring tempPath = path + L".tmp";
+    if (std::shared_lock lock(m_mutex); m_dirty.exchange(false))
+    {
+        // Entries no session has used for a while belong to files that are gone or no longer scanned
+        std::vector<CacheRecord> records;
+        records.reserve(m_entries.size());
+        for (auto& [key, entry] : m_entries)
+        {
+            const DWORD lastUsed = std::atomic_ref(entry.lastUsed).load(std::memory_order_relaxed);
+            if (m_session - lastUsed > MAX_IDLE_SESSIONS) continue;
+            records.push_back({ key.fileId, key.hashSizeLimit, entry.size, entry.lastWrite, key.volumeSerial,
+                key.algorithm, lastUsed, entry.hashLength, entry.hash, {} });
+        }
+
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        const CacheHeader header{ CACHE_MAGIC, CACHE_VERSION, records.size(), m_session, 0 };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(CacheRecord)));
+
+        if (!file.flush())
+        {
+            m_dirty = true;
+            return;
+        }
+    }
+    else return;
+
+    if (!MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) m_dirty = true;
+}
+
+void CHashCache::SaveInBackground()
+{
+    // A save still in flight is left alone; whatever it misses is written by the next save or Flush
+    std::scoped_lock lock(m_saveTaskMutex);
+    if (!m_dirty || m_saveTask.valid() &&
+        m_saveTask.wait_for(std::chrono::seconds::zero()) != std::future_status::ready) return;
+    m_saveTask = std::async(std::launch::async, [this] { Save(); });
+}
+
+void CHashCache::Flush()
+{
+    if (std::scoped_lock lock(m_saveTaskMutex); m_saveTask.valid()) m_saveTask.get();
+    Save();
+}
+
+void CHashCache::ResetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_lookupNanoseconds = 0;
+}
+
+CHashCache::Statistics CHashCache::GetStatistics() const
+{
+    return { m_hits.load(), m_misses.load(), m_lookupNanoseconds.load() };
+}
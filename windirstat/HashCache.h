@@ -0,0 +1,112 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// CHashCache. Persistent store of file content hashes so unchanged files
+// are not reread on later scans. Entries are keyed by volume serial, file ID,
+// hash algorithm and hash size limit; the file size and last write time are
+// kept alongside the hash and any mismatch is treated as a miss. Each entry
+// records the last session that used it; entries idle for too many sessions
+// are dropped when saving and the least recently used ones make room once
+// the cache is full.
+//
+class CHashCache final
+{
+public:
+
+    struct Statistics
+    {
+        ULONGLONG hits = 0;
+        ULONGLONG misses = 0;
+        ULONGLONG lookupNanoseconds = 0; // Total time spent in lookups
+    };
+
+    static CHashCache* Get();
+
+    bool Lookup(const CItem* item, ULONGLONG hashSizeLimit, int algorithm, HashLayout layout, std::vector<BYTE>& hash);
+    void Store(const CItem* item, ULONGLONG hashSizeLimit, int algorithm, HashLayout layout, std::span<const BYTE> hash);
+    void Save();
+    void SaveInBackground();
+    void Flush(); // Waits for a background save and writes anything stored since
+
+    void ResetStatistics();
+    Statistics GetStatistics() const;
+
+private:
+
+    static constexpr size_t MAX_HASH_SIZE = 16;
+    static constexpr size_t MAX_ENTRIES = wds::Mi;
+    static constexpr size_t EVICTED_ENTRIES = MAX_ENTRIES / 8; // Made room for at once when full
+    static constexpr DWORD MAX_IDLE_SESSIONS = 32;
+
+    struct Key
+    {
+        ULONGLONG fileId;
+        ULONGLONG hashSizeLimit;
+        DWORD volumeSerial;
+        DWORD algorithm; // Hash layout in the high byte
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const noexcept
+        {
+            size_t seed = std::hash<ULONGLONG>{}(key.fileId);
+            seed ^= std::hash<ULONGLONG>{}(key.hashSizeLimit) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            seed ^= (static_cast<size_t>(key.volumeSerial) << 8) ^ key.algorithm;
+            return seed;
+        }
+    };
+
+    struct Entry
+    {
+        ULONGLONG size;
+        ULONGLONG lastWrite;
+        std::array<BYTE, MAX_HASH_SIZE> hash;
+        BYTE hashLength;
+        DWORD lastUsed; // Session number, updated through atomic_ref by concurrent lookups
+    };
+
+    CHashCache() = default;
+
+    bool MakeKey(const CItem* item, ULONGLONG hashSizeLimit, int algorithm, HashLayout layout, Key& key);
+    DWORD GetVolumeSerial(const CItem* item);
+    void Load();
+    void EvictLeastRecentlyUsed();
+    static std::wstring GetCachePath();
+
+    std::once_flag m_loaded;
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<Key, Entry, KeyHash> m_entries;
+    std::unordered_map<std::wstring, DWORD> m_volumeSerials;
+    std::mutex m_volumeMutex;
+    std::mutex m_saveMutex;
+    std::atomic<bool> m_dirty = false;
+    std::future<void> m_saveTask;
+    std::mutex m_saveTaskMutex;
+    DWORD m_session = 1; // Number of this session, one past the last session saved
+
+    std::atomic<ULONGLONG> m_hits = 0;
+    std::atomic<ULONGLONG> m_misses = 0;
+    std::atomic<ULONGLONG> m_lookupNanoseconds = 0;
+};
@@ -279,6 +279,12 @@ std::wstring MakeLower(const std::wstring& s)
     return lower;
 }
 
+wchar_t FoldCase(const wchar_t c)
+{
+    static const std::regex_traits<wchar_t> traits;
+    return traits.translate_nocase(c);
+}
+
 std::wstring JoinString(const std::vector<std::wstring>& items, const WCHAR delim)
 {
     if (items.empty()) return {};
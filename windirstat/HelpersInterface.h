@@ -74,6 +74,7 @@ std::wstring GlobToRegex(const std::wstring& glob, bool useAnchors = true);
 void ReplaceString(std::wstring& subject, std::wstring_view search, std::wstring_view replace);
 std::wstring& TrimString(std::wstring& s, wchar_t c = L' ', bool endOnly = false) noexcept;
 std::wstring MakeLower(const std::wstring& s);
+wchar_t FoldCase(wchar_t c); // Folds like case-insensitive regular expressions and globs
 std::wstring JoinString(const std::vector<std::wstring>& items, WCHAR delim = wds::chrPipe);
 std::vector<std::wstring> SplitString(const std::wstring& string, WCHAR delim = wds::chrPipe);
 
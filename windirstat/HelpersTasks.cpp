@@ -18,6 +18,7 @@
 #include "pch.h"
 #include "HelpersTasks.h"
 #include "FinderBasic.h"
+#include "OverlappedReader.h"
 
 #pragma comment(lib,"powrprof.lib")
 #pragma comment(lib,"wbemuuid.lib")
@@ -230,6 +231,33 @@ bool IsLocalDrive(const std::wstring& path) noexcept
     return driveType == DRIVE_REMOVABLE || driveType == DRIVE_FIXED;
 }
 
+bool HasSeekPenalty(const std::wstring& path) noexcept
+{
+    // Resolve the volume holding the path since scan roots can be plain folders
+    std::array<WCHAR, MAX_PATH> volumeRoot{};
+    std::array<WCHAR, MAX_PATH> volumeName{};
+    if (!GetVolumePathName(path.c_str(), volumeRoot.data(), static_cast<DWORD>(volumeRoot.size())) ||
+        !GetVolumeNameForVolumeMountPoint(volumeRoot.data(), volumeName.data(), static_cast<DWORD>(volumeName.size())))
+    {
+        return false;
+    }
+
+    // The volume opens as a device without its trailing backslash
+    std::wstring device(volumeName.data());
+    if (device.ends_with(wds::chrBackslash)) device.pop_back();
+    SmartPointer hVolume(CloseHandle, HANDLE{});
+    if ((hVolume = CreateFile(device.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, 0, nullptr)) == INVALID_HANDLE_VALUE) return false;
+
+    // Devices that do not report a seek penalty are treated as solid state
+    STORAGE_PROPERTY_QUERY query{ .PropertyId = StorageDeviceSeekPenaltyProperty, .QueryType = PropertyStandardQuery };
+    DEVICE_SEEK_PENALTY_DESCRIPTOR penalty{};
+    DWORD bytesReturned = 0;
+    return DeviceIoControl(hVolume, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+        &penalty, sizeof(penalty), &bytesReturned, nullptr) != 0 &&
+        bytesReturned >= sizeof(penalty) && penalty.IncursSeekPenalty;
+}
+
 std::wstring GetVolumeName(const std::wstring& rootPath)
 {
     std::wstring volumeName(MAX_PATH, L'\0');
@@ -698,6 +726,30 @@ bool CreateHardlinkFromFile(const std::wstring& pathOne, const std::wstring& pat
 
 // File hashing
 static std::mutex mtpStreamMutex;
+static std::mutex threadIoMutex;
+static std::unordered_multimap<DWORD, HANDLE> threadIoFiles;
+
+void RegisterThreadIo(const HANDLE file, const DWORD threadId)
+{
+    const std::scoped_lock lock(threadIoMutex);
+    threadIoFiles.emplace(threadId, file);
+}
+
+void UnregisterThreadIo(const HANDLE file)
+{
+    const std::scoped_lock lock(threadIoMutex);
+    std::erase_if(threadIoFiles, [file](const auto& pair) { return pair.second == file; });
+}
+
+void CancelThreadIo(const HANDLE thread)
+{
+    CancelSynchronousIo(thread);
+
+    // Handles stay registered until their reader has stopped using them, so none is closed here
+    const std::scoped_lock lock(threadIoMutex);
+    const auto [first, last] = threadIoFiles.equal_range(GetThreadId(thread));
+    for (const HANDLE file : std::ranges::subrange(first, last) | std::views::values) CancelIoEx(file, nullptr);
+}
 
 HRESULT OpenMtpStream(const CItem* item, CComPtr<IStream>& stream)
 {
@@ -722,20 +774,29 @@ HRESULT ReadFileContent(HANDLE file, IStream* stream, void* buffer, const ULONG
     return stream->Read(buffer, size, bytesRead);
 }
 
+HRESULT SeekFileContent(HANDLE file, IStream* stream, const ULONGLONG offset)
+{
+    LARGE_INTEGER position{ .QuadPart = static_cast<LONGLONG>(offset) };
+    if (!stream) return SetFilePointerEx(file, position, nullptr, FILE_BEGIN) ? S_OK :
+        HRESULT_FROM_WIN32(GetLastError());
+    const std::scoped_lock lock(mtpStreamMutex);
+    return stream->Seek(position, STREAM_SEEK_SET, nullptr);
+}
+
 std::wstring ComputeFileHashes(const CItem* item, CProgressDlg* pProgressDlg)
 {
-    // Open MTP content through the shell and filesystem content through a native handle
+    // Open MTP content through the shell and stream filesystem content with several
+    // unbuffered reads in flight so hashing overlaps with the following reads
     const ComApartmentScope com;
-    SmartPointer hFile(CloseHandle, HANDLE{});
     CComPtr<IStream> fileStream;
+    std::optional<COverlappedReader> reader;
     if (item->IsTypeOrFlag(ITF_MTP))
     {
         if (!com) return TranslateError(CO_E_NOTINITIALIZED);
         if (const HRESULT result = OpenMtpStream(item, fileStream); FAILED(result)) return TranslateError(result);
     }
-    else if ((hFile = CreateFile(item->GetPathLong().c_str(), GENERIC_READ,
-        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
-        FILE_FLAG_SEQUENTIAL_SCAN, nullptr)) == INVALID_HANDLE_VALUE) return TranslateError();
+    else if (!reader.emplace(item->GetPathLongRef(), 0, std::numeric_limits<ULONGLONG>::max(),
+        COptions::HashReadQueueDepth, true).IsOpen()) return TranslateError();
 
     // Initialize all hash contexts
     using HashContext = struct HashContext {
@@ -793,20 +854,27 @@ std::wstring ComputeFileHashes(const CItem* item, CProgressDlg* pProgressDlg)
     }
 
     // Read file and update all hashes
-    constexpr size_t BUFFER_SIZE = wds::Mi; // 1MB chunks
-    std::vector<BYTE> buffer(BUFFER_SIZE);
-    DWORD bytesRead;
-    HRESULT readResult = S_OK;
+    constexpr size_t BUFFER_SIZE = COverlappedReader::BUFFER_SIZE; // 1MB chunks
+    std::vector<BYTE> buffer(fileStream ? BUFFER_SIZE : 0);
+    const auto readNext = [&](std::span<const BYTE>& data)
+    {
+        if (reader) return reader->Next(data);
+        DWORD bytesRead = 0;
+        const HRESULT result = ReadFileContent(nullptr, fileStream, buffer.data(), BUFFER_SIZE, &bytesRead);
+        data = { buffer.data(), bytesRead };
+        return result;
+    };
 
     // Update all valid hashes with the same buffer in parallel
-    while (SUCCEEDED(readResult = ReadFileContent(hFile, fileStream,
-        buffer.data(), BUFFER_SIZE, &bytesRead)) && bytesRead > 0)
+    HRESULT readResult = S_OK;
+    for (std::span<const BYTE> data; SUCCEEDED(readResult = readNext(data)) && !data.empty();)
     {
         if (pProgressDlg->IsCancelled()) return wds::strEmpty;
+        const auto bytesRead = static_cast<ULONG>(data.size());
         std::for_each(std::execution::par, contexts.begin(), contexts.end(),
-            [&buffer, bytesRead](auto& ctx) {
-                if (ctx.xxHash.IsValid()) XXH3_64bits_update(ctx.xxHash, buffer.data(), bytesRead);
-                else (void)BCryptHashData(ctx.hHash, buffer.data(), bytesRead, 0);
+            [&data, bytesRead](auto& ctx) {
+                if (ctx.xxHash.IsValid()) XXH3_64bits_update(ctx.xxHash, data.data(), bytesRead);
+                else (void)BCryptHashData(ctx.hHash, const_cast<PUCHAR>(data.data()), bytesRead, 0);
             });
         pProgressDlg->Increment();
         // Some shell streams report the final successful partial read with S_FALSE
@@ -42,6 +42,13 @@ using HashAlgorithm = enum HashAlgorithm {
     HASH_XXHASH
 };
 
+// How file content is fed to the hash; each layout yields distinct values
+using HashLayout = enum HashLayout : std::uint8_t {
+    HASH_LAYOUT_STREAM,  // Leading content read in order
+    HASH_LAYOUT_SAMPLED, // Fixed blocks spread across the file
+    HASH_LAYOUT_CHUNKED  // Digests of fixed chunks combined into one hash
+};
+
 struct HashAlgorithmInfo
 {
     HashAlgorithm algorithm;
@@ -85,6 +92,7 @@ std::vector<std::wstring> GetDriveList(
 bool FolderExists(const std::wstring& path) noexcept;
 bool DriveExists(const std::wstring& path) noexcept;
 bool IsLocalDrive(const std::wstring& path) noexcept;
+bool HasSeekPenalty(const std::wstring& path) noexcept;
 std::wstring GetVolumeName(const std::wstring& rootPath);
 bool DeleteFileForce(const std::wstring& path, DWORD attributes = INVALID_FILE_ATTRIBUTES);
 
@@ -118,8 +126,15 @@ bool CreateHardlinkFromFile(const std::wstring& pathOne, const std::wstring& pat
 class CItem;
 HRESULT OpenMtpStream(const CItem* item, CComPtr<IStream>& stream);
 HRESULT ReadFileContent(HANDLE file, IStream* stream, void* buffer, ULONG size, ULONG* bytesRead);
+HRESULT SeekFileContent(HANDLE file, IStream* stream, ULONGLONG offset);
 std::wstring ComputeFileHashes(const CItem* item, CProgressDlg* pProgressDlg);
 
+// Overlapped reads are out of reach of CancelSynchronousIo, so their handles are
+// registered against the thread they read for and cancelled along with it
+void RegisterThreadIo(HANDLE file, DWORD threadId);
+void UnregisterThreadIo(HANDLE file);
+void CancelThreadIo(HANDLE thread);
+
 // Process priority and VHD optimization
 void SetProcessPriority(int level) noexcept;
 bool OptimizeVhd(const std::wstring& vhdPath) noexcept;
@@ -17,6 +17,8 @@
 
 #include "pch.h"
 #include "Item.h"
+#include "HashCache.h"
+#include "OverlappedReader.h"
 
 static constexpr wchar_t AsciiLower(const wchar_t value) noexcept
 {
@@ -185,13 +187,13 @@ std::wstring CItem::GetText(const int subitem) const
         }
         if (IsTypeOrFlag(IT_HLINKS_FILE))
         {
-            return L"⫘ " + FormatBytes(GetSizePhysical());
+            return L"⫘ " + FormatBytes(GetDisplaySizePhysical());
         }
-        return FormatBytes(GetSizePhysical());
+        return FormatBytes(GetDisplaySizePhysical());
 
     case COL_SIZE_LOGICAL:
     {
-        return FormatBytes(GetSizeLogical());
+        return FormatBytes(GetDisplaySizeLogical());
     }
 
     case COL_NAME:
@@ -227,21 +229,21 @@ std::wstring CItem::GetText(const int subitem) const
     case COL_ITEMS:
         if (!IsTypeOrFlag(IT_FILE, IT_FREESPACE, IT_UNKNOWN, IT_HLINKS, IT_HLINKS_SET, IT_HLINKS_IDX))
         {
-            return FormatCount(GetItemsCount());
+            return FormatCount(GetDisplayItemsCount());
         }
         break;
 
     case COL_FILES:
         if (!IsTypeOrFlag(IT_FILE, IT_FREESPACE, IT_UNKNOWN, IT_HLINKS, IT_HLINKS_SET, IT_HLINKS_IDX))
         {
-            return FormatCount(GetFilesCount());
+            return FormatCount(GetDisplayFilesCount());
         }
         break;
 
     case COL_FOLDERS:
         if (!IsTypeOrFlag(IT_FILE, IT_FREESPACE, IT_UNKNOWN, IT_HLINKS, IT_HLINKS_SET, IT_HLINKS_IDX))
         {
-            return FormatCount(GetFoldersCount());
+            return FormatCount(GetDisplayFoldersCount());
         }
         break;
 
@@ -326,27 +328,27 @@ int CItem::CompareSibling(const CTreeListItem* tlib, const int subitem) const
 
     case COL_SIZE_PHYSICAL:
     {
-        return usignum(GetSizePhysical(), other->GetSizePhysical());
+        return usignum(GetDisplaySizePhysical(), other->GetDisplaySizePhysical());
     }
 
     case COL_SIZE_LOGICAL:
     {
-        return usignum(GetSizeLogical(), other->GetSizeLogical());
+        return usignum(GetDisplaySizeLogical(), other->GetDisplaySizeLogical());
     }
 
     case COL_ITEMS:
     {
-        return usignum(GetItemsCount(), other->GetItemsCount());
+        return usignum(GetDisplayItemsCount(), other->GetDisplayItemsCount());
     }
 
     case COL_FILES:
     {
-        return usignum(GetFilesCount(), other->GetFilesCount());
+        return usignum(GetDisplayFilesCount(), other->GetDisplayFilesCount());
     }
 
     case COL_FOLDERS:
     {
-        return usignum(GetFoldersCount(), other->GetFoldersCount());
+        return usignum(GetDisplayFoldersCount(), other->GetDisplayFoldersCount());
     }
 
     case COL_LAST_CHANGE:
@@ -469,12 +471,17 @@ const CItem* CItem::GetLinkedItem() const noexcept
 int CItem::TmiGetChildCount() const noexcept
 {
     if (m_folderInfo == nullptr || IsTypeOrFlag(IT_HLINKS_IDX)) return 0;
-    return static_cast<int>(m_folderInfo->m_children.size());
+    return static_cast<int>(GetVisibleChildren().size());
+}
+
+CItem* CItem::TmiGetChild(const int c) const noexcept
+{
+    return GetVisibleChildren()[c];
 }
 
 ULONGLONG CItem::TmiGetSize() const noexcept
 {
-    return COptions::TreeMapUseLogical ? GetSizeLogical() : GetSizePhysical();
+    return COptions::TreeMapUseLogical ? GetDisplaySizeLogical() : GetDisplaySizePhysical();
 }
 
 // --- Drive / Volume Specific ---
@@ -938,7 +945,149 @@ void CItem::DoHardlinkAdjustment()
     hardlinksItem->UpwardSetUndone();
 }
 
-std::vector<BYTE> CItem::GetFileHash(const ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue)
+std::vector<BYTE> CItem::GetFileHash(const ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue, const bool sampled)
+{
+    // Full xxHash digests of very large files are split so several threads can read at once;
+    // the choice depends only on size so all candidates of one size share a layout
+    const int hashAlgorithm = COptions::FileHashAlgorithm;
+    const bool chunked = !sampled && hashAlgorithm == HASH_XXHASH && COptions::ParallelLargeFileHash &&
+        GetSizeLogical() >= HASH_CHUNKED_MIN_SIZE && hashSizeLimit >= GetSizeLogical();
+    const HashLayout layout = sampled ? HASH_LAYOUT_SAMPLED : chunked ? HASH_LAYOUT_CHUNKED : HASH_LAYOUT_STREAM;
+
+    // Unchanged files reuse the hash recorded by an earlier scan
+    if (std::vector<BYTE> hash; CHashCache::Get()->Lookup(this, hashSizeLimit, hashAlgorithm, layout, hash)) return hash;
+
+    // Chunks of a file on a rotational volume are read in order so its head is not torn between them
+    std::vector<BYTE> hash = chunked ?
+        ComputeChunkedFileHash(queue, !IsTypeOrFlag(ITF_MTP) && !HasSeekPenalty(GetPath())) :
+        ComputeFileHash(hashSizeLimit, queue, sampled);
+    CHashCache::Get()->Store(this, hashSizeLimit, hashAlgorithm, layout, hash);
+    return hash;
+}
+
+std::vector<BYTE> CItem::ComputeChunkedFileHash(BlockingQueue<CItem*>* queue, const bool parallel)
+{
+    const ULONGLONG fileSize = GetSizeLogical();
+    const size_t chunkCount = static_cast<size_t>((fileSize + HASH_CHUNK_SIZE - 1) / HASH_CHUNK_SIZE);
+    std::vector<XXH64_canonical_t> digests(chunkCount);
+    std::vector<BYTE> chunkDone(chunkCount, FALSE);
+    std::atomic<bool> failed = false;
+    std::atomic<bool> interrupted = false;
+    CComPtr<IStream> mtpStream;
+    ULONGLONG mtpPosition = 0;
+    const DWORD ownerThread = GetCurrentThreadId(); // Chunk reads are cancelled with the hashing worker
+    if (IsTypeOrFlag(ITF_MTP) && FAILED(OpenMtpStream(this, mtpStream))) return {};
+
+    const auto hashChunk = [&](const size_t chunk)
+    {
+        if (failed || interrupted) return;
+
+        thread_local std::vector<BYTE> chunkBuffer(wds::Mi);
+        thread_local SmartPointer<XXH3_state_t*> chunkHasher(FreeXxHashState, nullptr);
+        if (!chunkHasher.IsValid() && (chunkHasher = XXH3_createState()) == nullptr)
+        {
+            failed = true;
+            return;
+        }
+        XXH3_64bits_reset(chunkHasher);
+
+        // Filesystem chunks are streamed on their own handle with several reads in flight
+        const ULONGLONG chunkStart = chunk * HASH_CHUNK_SIZE;
+        const ULONGLONG chunkLength = std::min(HASH_CHUNK_SIZE, fileSize - chunkStart);
+        if (!IsTypeOrFlag(ITF_MTP))
+        {
+            COverlappedReader reader(GetPathLongRef(), chunkStart, chunkLength, COptions::HashReadQueueDepth, true, ownerThread);
+            ULONGLONG chunkHashed = 0;
+            for (std::span<const BYTE> data; reader.IsOpen() && SUCCEEDED(reader.Next(data)) && !data.empty();)
+            {
+                // Give up the chunk on suspension; the calling worker waits and retries it
+                if (queue->IsSuspended())
+                {
+                    interrupted = true;
+                    return;
+                }
+
+                XXH3_64bits_update(chunkHasher, data.data(), data.size());
+                chunkHashed += data.size();
+                UpwardDrivePacman();
+            }
+
+            if (chunkHashed != chunkLength) failed = true;
+        }
+        else
+        {
+            // Chunks are read in order from one device stream; a stream that cannot seek back to
+            // a chunk left unfinished by a suspension is reopened and read through to it
+            if (mtpPosition != chunkStart && FAILED(SeekFileContent(nullptr, mtpStream, chunkStart)))
+            {
+                if (mtpPosition > chunkStart) mtpStream.Release();
+                if (!mtpStream)
+                {
+                    mtpPosition = 0;
+                    if (FAILED(OpenMtpStream(this, mtpStream)))
+                    {
+                        failed = true;
+                        return;
+                    }
+                }
+            }
+            else mtpPosition = chunkStart;
+
+            while (mtpPosition < chunkStart + chunkLength)
+            {
+                if (queue->IsSuspended())
+                {
+                    interrupted = true;
+                    return;
+                }
+
+                ULONG readBytes = 0;
+                const ULONGLONG readEnd = mtpPosition < chunkStart ? chunkStart : chunkStart + chunkLength;
+                if (FAILED(ReadFileContent(nullptr, mtpStream, chunkBuffer.data(), static_cast<ULONG>(
+                    std::min<ULONGLONG>(readEnd - mtpPosition, chunkBuffer.size())), &readBytes)) || readBytes == 0)
+                {
+                    failed = true;
+                    return;
+                }
+
+                if (mtpPosition >= chunkStart) XXH3_64bits_update(chunkHasher, chunkBuffer.data(), readBytes);
+                mtpPosition += readBytes;
+                UpwardDrivePacman();
+            }
+        }
+        if (failed) return;
+
+        XXH64_canonicalFromHash(&digests[chunk], XXH3_64bits_digest(chunkHasher));
+        chunkDone[chunk] = TRUE;
+    };
+
+    while (true)
+    {
+        std::vector<size_t> pending;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            if (!chunkDone[chunk]) pending.push_back(chunk);
+        }
+
+        // Device streams and rotational volumes are read on this thread one chunk after another
+        if (parallel) std::for_each(std::execution::par, pending.begin(), pending.end(), hashChunk);
+        else std::ranges::for_each(pending, hashChunk);
+
+        if (failed) return {};
+        if (!interrupted) break;
+
+        // Throws if the stage was cancelled while suspended
+        interrupted = false;
+        queue->WaitIfSuspended();
+    }
+
+    // Combine the chunk digests in file order
+    XXH64_canonical_t canonical;
+    XXH64_canonicalFromHash(&canonical, XXH3_64bits(digests.data(), digests.size() * sizeof(XXH64_canonical_t)));
+    return { canonical.digest, canonical.digest + sizeof(canonical.digest) };
+}
+
+std::vector<BYTE> CItem::ComputeFileHash(const ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue, const bool sampled)
 {
     const HashAlgorithm hashAlgorithm = static_cast<HashAlgorithm>(COptions::FileHashAlgorithm.Obj());
     const auto& hashAlgorithmInfo = HashAlgorithms[hashAlgorithm];
@@ -991,38 +1140,98 @@ std::vector<BYTE> CItem::GetFileHash(const ULONGLONG hashSizeLimit, BlockingQueu
         return {};
     }
 
-    // Open content for reading - avoid filesystem files that are actively being written to
+    // Open content for reading - avoid filesystem files that are actively being written to.
+    // Prefixes longer than one buffer are streamed with several reads in flight.
     SmartPointer hFile(CloseHandle, HANDLE{});
     CComPtr<IStream> fileStream;
+    std::optional<COverlappedReader> reader;
+    const ULONGLONG readLength = std::min(hashSizeLimit, GetSizeLogical());
     if (IsTypeOrFlag(ITF_MTP))
     {
         if (FAILED(OpenMtpStream(this, fileStream))) return {};
     }
-    else if ((hFile = CreateFile(GetPathLong().c_str(), GENERIC_READ,
+    else if (!sampled && readLength > COverlappedReader::BUFFER_SIZE)
+    {
+        // Whole large files bypass the file cache so they do not evict everything else
+        const bool unbuffered = readLength == GetSizeLogical() && readLength >= HASH_UNBUFFERED_MIN_SIZE;
+        reader.emplace(GetPathLongRef(), 0, hashSizeLimit, COptions::HashReadQueueDepth, unbuffered);
+        if (!reader->IsOpen()) return {};
+    }
+    else if ((hFile = CreateFile(GetPathLongRef().c_str(), GENERIC_READ,
         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
-        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_SEQUENTIAL_SCAN, nullptr)) == INVALID_HANDLE_VALUE) return {};
+        FILE_FLAG_BACKUP_SEMANTICS | (sampled ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN),
+        nullptr)) == INVALID_HANDLE_VALUE) return {};
 
     // Hash data one read at a time
     HRESULT iReadResult = E_FAIL;
     DWORD iHashResult = 0;
     DWORD iReadBytes = 0;
     ULONGLONG totalBytesHashed = 0;
-
-    while (SUCCEEDED(iReadResult = ReadFileContent(hFile, fileStream, fileBuffer.data(), static_cast<DWORD>(
-        std::min<ULONGLONG>(hashSizeLimit - totalBytesHashed, fileBuffer.size())), &iReadBytes)) && iReadBytes > 0)
+    const auto hashData = [&](const BYTE* data, const DWORD size)
     {
         UpwardDrivePacman();
+        if (useXxHash) XXH3_64bits_update(xxHasher, data, size);
+        else iHashResult = BCryptHashData(hashHandle, const_cast<PUCHAR>(data), size, 0);
+        totalBytesHashed += size;
+        return iHashResult == 0;
+    };
+
+    if (sampled)
+    {
+        // Interior blocks are aligned down to the block size; the last one ends at end of file
+        const ULONGLONG fileSize = GetSizeLogical();
+        const ULONGLONG lastOffset = fileSize > HASH_SAMPLE_BLOCK_SIZE ? fileSize - HASH_SAMPLE_BLOCK_SIZE : 0;
+        ULONGLONG position = 0;
+        bool seekable = true;
+        for (ULONG block = 0; block < HASH_SAMPLE_BLOCKS; block++)
+        {
+            const ULONGLONG offset = block + 1 == HASH_SAMPLE_BLOCKS ? lastOffset :
+                lastOffset / (HASH_SAMPLE_BLOCKS - 1) * block / HASH_SAMPLE_BLOCK_SIZE * HASH_SAMPLE_BLOCK_SIZE;
 
-        // Hash the data
-        if (useXxHash) XXH3_64bits_update(xxHasher, fileBuffer.data(), iReadBytes);
-        else
+            // Streams that cannot seek, as on most MTP devices, are read through to each block
+            // so they hash the same blocks as seekable copies of the same size
+            if (seekable && FAILED(iReadResult = SeekFileContent(hFile, fileStream, offset)))
+            {
+                if (!fileStream) break;
+                seekable = false;
+                iReadResult = S_OK;
+            }
+            if (seekable) position = offset;
+            else if (position > offset) iReadResult = E_FAIL;
+            else while (position < offset && SUCCEEDED(iReadResult = ReadFileContent(hFile, fileStream, fileBuffer.data(),
+                static_cast<DWORD>(std::min<ULONGLONG>(offset - position, fileBuffer.size())), &iReadBytes)))
+            {
+                if (iReadBytes == 0)
+                {
+                    iReadResult = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                    break;
+                }
+                position += iReadBytes;
+                queue->WaitIfSuspended();
+            }
+
+            if (FAILED(iReadResult) ||
+                FAILED(iReadResult = ReadFileContent(hFile, fileStream, fileBuffer.data(),
+                    HASH_SAMPLE_BLOCK_SIZE, &iReadBytes)) || !hashData(fileBuffer.data(), iReadBytes)) break;
+            position += iReadBytes;
+
+            queue->WaitIfSuspended();
+        }
+    }
+    else if (reader)
+    {
+        for (std::span<const BYTE> data; SUCCEEDED(iReadResult = reader->Next(data)) && !data.empty();)
         {
-            iHashResult = BCryptHashData(hashHandle, fileBuffer.data(), iReadBytes, 0);
-            if (iHashResult != 0) break;
+            if (!hashData(data.data(), static_cast<DWORD>(data.size()))) break;
+            queue->WaitIfSuspended();
         }
+    }
+    else while (SUCCEEDED(iReadResult = ReadFileContent(hFile, fileStream, fileBuffer.data(), static_cast<DWORD>(
+        std::min<ULONGLONG>(hashSizeLimit - totalBytesHashed, fileBuffer.size())), &iReadBytes)) && iReadBytes > 0)
+    {
+        if (!hashData(fileBuffer.data(), iReadBytes)) break;
 
         // Stop if we've reached the hash size limit
-        totalBytesHashed += iReadBytes;
         if (totalBytesHashed >= hashSizeLimit || iReadResult == S_FALSE) break;
 
         queue->WaitIfSuspended();
@@ -1053,6 +1262,66 @@ std::vector<BYTE> CItem::GetFileHash(const ULONGLONG hashSizeLimit, BlockingQueu
     return { hashBuffer.begin(), hashBuffer.begin() + ReducedHashInBytes };
 }
 
+ULONGLONG CItem::GetExtentSignature() const
+{
+    // Files that share every cluster (hardlinks, block clones) yield the same signature;
+    // zero means the layout is unknown or has no allocated clusters to compare
+    if (IsTypeOrFlag(ITF_MTP)) return 0;
+
+    SmartPointer hFile(CloseHandle, HANDLE{});
+    if ((hFile = CreateFile(GetPathLongRef().c_str(), FILE_READ_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS, nullptr)) == INVALID_HANDLE_VALUE) return 0;
+
+    const SmartPointer<XXH3_state_t*> state(FreeXxHashState, XXH3_createState());
+    if (!state.IsValid()) return 0;
+    XXH3_64bits_reset(state);
+
+    // Walk the whole extent map a buffer at a time
+    thread_local std::vector<BYTE> buffer(64 * wds::Ki);
+    const auto pointers = reinterpret_cast<const RETRIEVAL_POINTERS_BUFFER*>(buffer.data());
+    STARTING_VCN_INPUT_BUFFER input = {};
+    bool allocated = false;
+    while (true)
+    {
+        DWORD bytesReturned = 0;
+        const BOOL complete = DeviceIoControl(hFile, FSCTL_GET_RETRIEVAL_POINTERS, &input, sizeof(input),
+            buffer.data(), static_cast<DWORD>(buffer.size()), &bytesReturned, nullptr);
+        if (!complete && GetLastError() != ERROR_MORE_DATA) return 0;
+        if (pointers->ExtentCount == 0) break;
+
+        const std::span extents(pointers->Extents, pointers->ExtentCount);
+        allocated |= std::ranges::any_of(extents, [](const auto& extent) { return extent.Lcn.QuadPart >= 0; });
+        XXH3_64bits_update(state, extents.data(), extents.size_bytes());
+        if (complete) break;
+        input.StartingVcn = extents.back().NextVcn;
+    }
+
+    return allocated ? XXH3_64bits_digest(state) | 1 : 0;
+}
+
+LONGLONG CItem::GetFirstLcn() const
+{
+    // Device content and files without clusters (resident, other filesystems) have no location
+    constexpr LONGLONG unknownLcn = std::numeric_limits<LONGLONG>::max();
+    if (IsTypeOrFlag(ITF_MTP)) return unknownLcn;
+
+    SmartPointer hFile(CloseHandle, HANDLE{});
+    if ((hFile = CreateFile(GetPathLongRef().c_str(), FILE_READ_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS, nullptr)) == INVALID_HANDLE_VALUE) return unknownLcn;
+
+    // Only the first extent is needed so a partial result is sufficient
+    STARTING_VCN_INPUT_BUFFER input = {};
+    RETRIEVAL_POINTERS_BUFFER output = {};
+    DWORD bytesReturned = 0;
+    if (DeviceIoControl(hFile, FSCTL_GET_RETRIEVAL_POINTERS, &input, sizeof(input),
+        &output, sizeof(output), &bytesReturned, nullptr) == 0 && GetLastError() != ERROR_MORE_DATA) return unknownLcn;
+
+    // Sparse and compressed runs report a negative LCN
+    return output.ExtentCount > 0 && output.Extents[0].Lcn.QuadPart >= 0 ? output.Extents[0].Lcn.QuadPart : unknownLcn;
+}
+
 // --- Private Helpers ---
 
 ULONGLONG CItem::GetProgressRangeMyComputer() const
@@ -18,6 +18,7 @@
 #include "pch.h"
 #include "Item.h"
 #include "Filtering.h"
+#include "FilterView.h"
 #include "FinderBasic.h"
 #include "FinderMtp.h"
 #include "FinderNtfs.h"
@@ -121,6 +122,36 @@ const std::vector<CItem*>& CItem::GetChildren() const noexcept
     return m_folderInfo->m_children;
 }
 
+int CItem::GetTreeListChildCount() const noexcept
+{
+    return IsLeaf() ? 0 : static_cast<int>(GetVisibleChildren().size());
+}
+
+CTreeListItem* CItem::GetTreeListChild(const int i) const noexcept
+{
+    return GetVisibleChildren()[i];
+}
+
+bool CItem::IsAncestorOf(const CItem* item) const noexcept
+{
+    // Only containers carry an index; fall back to walking parents otherwise
+    if (IsLeaf()) return item == this;
+    const ULONG enter = m_folderInfo->m_enter;
+    const ULONG exit = m_folderInfo->m_exit;
+    if (enter == 0) return CTreeListItem::IsAncestorOf(item);
+
+    // Branches added since the last index update are not numbered yet so
+    // climb to the nearest indexed container and test its range instead
+    for (auto* parent = item; parent != nullptr; parent = parent->GetParent())
+    {
+        if (parent == this) return true;
+        if (parent->IsLeaf()) continue;
+        if (const ULONG parentEnter = parent->m_folderInfo->m_enter; parentEnter != 0)
+            return enter <= parentEnter && parentEnter < exit;
+    }
+    return false;
+}
+
 CItem* CItem::GetEnumRoot() const noexcept
 {
     // Resolve the selected folder, drive, or MTP branch without crossing a multi-root container.
@@ -214,7 +245,7 @@ void CItem::RemoveAllChildren() const
 
     if (IsRootItem())
     {
-        CWinDirStatModel::Get()->GetExtensionData()->clear();
+        CWinDirStatModel::Get()->ClearExtensionData();
     }
 
     if (IsLeaf()) return;
@@ -223,11 +254,8 @@ void CItem::RemoveAllChildren() const
         CFileTreeControl::Get()->OnRemovingAllChildren(this);
     });
 
-    for (const auto& child : m_folderInfo->m_children)
-    {
-        delete child;
-    }
-    m_folderInfo->m_children.clear();
+    // Detach the children and let the model free them in the background
+    CWinDirStatModel::Get()->DeleteItemsAsync(std::exchange(m_folderInfo->m_children, {}));
 }
 
 CItem* CItem::AddDirectory(const Finder& finder)
@@ -369,12 +397,12 @@ double CItem::GetFraction() const noexcept
     {
         return 1.0;
     }
-    const ULONGLONG parentSize = COptions::TreeMapUseLogical ? GetParent()->GetSizeLogical() : GetParent()->GetSizePhysical();
+    const ULONGLONG parentSize = COptions::TreeMapUseLogical ? GetParent()->GetDisplaySizeLogical() : GetParent()->GetDisplaySizePhysical();
     if (parentSize == 0)
     {
         return 1.0;
     }
-    const ULONGLONG size = COptions::TreeMapUseLogical ? GetSizeLogical() : GetSizePhysical();
+    const ULONGLONG size = COptions::TreeMapUseLogical ? GetDisplaySizeLogical() : GetDisplaySizePhysical();
     return static_cast<double>(size) / static_cast<double>(parentSize);
 }
 
@@ -391,27 +419,68 @@ double CItem::GetAbsoluteFraction() const noexcept
         root = root->GetParent();
     }
 
-    const ULONGLONG rootSize = COptions::TreeMapUseLogical ? root->GetSizeLogical() : root->GetSizePhysical();
+    const ULONGLONG rootSize = COptions::TreeMapUseLogical ? root->GetDisplaySizeLogical() : root->GetDisplaySizePhysical();
     if (rootSize == 0)
     {
         return 0.0;
     }
 
-    const ULONGLONG size = COptions::TreeMapUseLogical ? GetSizeLogical() : GetSizePhysical();
+    const ULONGLONG size = COptions::TreeMapUseLogical ? GetDisplaySizeLogical() : GetDisplaySizePhysical();
     return static_cast<double>(size) / static_cast<double>(rootSize);
 }
 
 ULONGLONG CItem::GetItemsCount() const noexcept
 {
-    if (IsLeaf()) return 0;
-    return static_cast<ULONGLONG>(m_folderInfo->m_files) + static_cast<ULONGLONG>(m_folderInfo->m_subdirs);
+    return static_cast<ULONGLONG>(GetFilesCount()) + static_cast<ULONGLONG>(GetFoldersCount());
+}
+
+std::shared_ptr<const SFilterProjection> CItem::GetProjection() const noexcept
+{
+    // Only folders are projected
+    if (IsLeaf()) return nullptr;
+    return CFilterView::Find(this);
+}
+
+ULONGLONG CItem::GetDisplaySizePhysical() const noexcept
+{
+    if (const auto projection = GetProjection()) return projection->sizePhysical;
+    return GetSizePhysical();
+}
+
+ULONGLONG CItem::GetDisplaySizeLogical() const noexcept
+{
+    if (const auto projection = GetProjection()) return projection->sizeLogical;
+    return GetSizeLogical();
+}
+
+ULONG CItem::GetDisplayFilesCount() const noexcept
+{
+    if (const auto projection = GetProjection()) return projection->files;
+    return GetFilesCount();
+}
+
+ULONG CItem::GetDisplayFoldersCount() const noexcept
+{
+    if (const auto projection = GetProjection()) return projection->subdirs;
+    return GetFoldersCount();
+}
+
+ULONGLONG CItem::GetDisplayItemsCount() const noexcept
+{
+    return static_cast<ULONGLONG>(GetDisplayFilesCount()) + static_cast<ULONGLONG>(GetDisplayFoldersCount());
+}
+
+const std::vector<CItem*>& CItem::GetVisibleChildren() const noexcept
+{
+    // The view is only replaced on the UI thread, which is also the only one walking visible children
+    if (const auto projection = GetProjection()) return projection->children;
+    return GetChildren();
 }
 
 void CItem::ExtensionDataAdd()
 {
     if (!IsTypeOrFlag(IT_FILE) || IsTypeOrFlag(ITF_EXTDATA)) return;
-    const auto record = CWinDirStatModel::Get()->GetExtensionDataRecord(GetExtension());
-    record->AddFile(GetSizeLogical());
+    CWinDirStatModel::Get()->AddExtensionFile(this);
     SetFlag(ITF_EXTDATA);
 }
 
@@ -434,7 +503,7 @@ void CItem::ExtensionDataProcessChildren(const bool remove)
 
         if (item->IsTypeOrFlag(IT_MYCOMPUTER, IT_DIRECTORY, IT_DRIVE))
         {
-            for (const auto& child : item->GetChildren())
+            for (const auto& child : item->GetVisibleChildren())
             {
                 childStack.push_back(child);
             }
@@ -573,13 +642,29 @@ bool CItem::HasExtension(const std::wstring_view extension) const noexcept
 
 std::wstring CItem::GetExtension() const
 {
-    if (!IsTypeOrFlag(IT_FILE)) return GetName();
+    std::wstring extension;
+    GetExtension(extension);
+    return extension;
+}
+
+void CItem::GetExtension(std::wstring& extension) const
+{
+    if (!IsTypeOrFlag(IT_FILE))
+    {
+        extension.assign(GetNameView());
+        return;
+    }
+
     const auto extName = GetNameView();
     const auto pos = extName.rfind('.');
-    if (pos == std::wstring_view::npos) return {};
-    std::wstring extLower(extName.substr(pos));
-    _wcslwr_s(extLower.data(), extLower.size() + 1);
-    return extLower;
+    if (pos == std::wstring_view::npos)
+    {
+        extension.clear();
+        return;
+    }
+
+    extension.assign(extName.substr(pos));
+    _wcslwr_s(extension.data(), extension.size() + 1);
 }
 
 std::wstring CItem::GetPath() const
@@ -694,6 +779,21 @@ std::wstring CItem::GetPathLong() const
     return FinderBasic::MakeLongPathCompatible(GetPath());
 }
 
+const std::wstring& CItem::GetPathRef() const
+{
+    // Build without caching ancestors across calls since items may be freed in between
+    thread_local CItemPathBuilder builder;
+    builder.Reset();
+    return builder.Get(this);
+}
+
+const std::wstring& CItem::GetPathLongRef() const
+{
+    thread_local CItemPathBuilder builder;
+    builder.Reset();
+    return builder.GetLong(this);
+}
+
 std::wstring CItem::GetFolderPath() const
 {
     if (IsTypeOrFlag(ITF_MTP))
@@ -785,6 +885,77 @@ std::wstring CItem::GetPathWithoutSlash() const
     return path;
 }
 
+void CItemPathBuilder::Reset() noexcept
+{
+    m_parts.clear();
+    m_path.clear();
+}
+
+void CItemPathBuilder::Push(const CItem* item)
+{
+    // Mirror the component rules of CItem::GetPathWithoutSlash()
+    m_parts.push_back({ item, m_path.size() });
+    if (item->IsTypeOrFlag(IT_MYCOMPUTER)) return;
+
+    if (!m_path.empty() && m_path.back() != L'\\') m_path += L'\\';
+    if (item->IsTypeOrFlag(IT_DRIVE))
+    {
+        m_path.append(item->GetNameView().substr(0, 2)).append(L"\\");
+    }
+    else
+    {
+        // Root folders may be named with trailing backslashes
+        const size_t start = m_path.size();
+        m_path.append(item->GetNameView());
+        if (const auto pos = m_path.find_last_not_of(L'\\'); pos != std::wstring::npos && pos + 1 >= start)
+        {
+            m_path.erase(pos + 1);
+        }
+    }
+}
+
+const std::wstring& CItemPathBuilder::Get(const CItem* item)
+{
+    // Shell and hardlink index items resolve their paths through separate rules
+    // and are kept apart so the cached components still match the buffer
+    if (item->IsTypeOrFlag(ITF_MTP, IT_HLINKS_FILE, IT_HLINKS_SET, IT_HLINKS_IDX))
+    {
+        m_resolved = item->GetPath();
+        return m_resolved;
+    }
+
+    // Fast path for repeated lookups and for children of the previous item
+    if (!m_parts.empty() && m_parts.back().item == item) return m_path;
+    if (!m_parts.empty() && m_parts.back().item == item->GetParent())
+    {
+        Push(item);
+        return m_path;
+    }
+
+    // Keep the longest cached prefix shared with the item's ancestry
+    m_chain.clear();
+    for (const CItem* p = item; p != nullptr; p = p->GetParent()) m_chain.push_back(p);
+    size_t shared = 0;
+    while (shared < m_parts.size() && shared < m_chain.size() &&
+        m_parts[shared].item == m_chain[m_chain.size() - 1 - shared]) ++shared;
+    m_path.resize(shared < m_parts.size() ? m_parts[shared].length : shared == 0 ? 0 : m_path.size());
+    m_parts.resize(shared);
+
+    // Append the remaining components from the outermost to the item itself
+    for (size_t i = m_chain.size() - shared; i > 0; --i) [[msvc::forceinline_calls]]
+    {
+        Push(m_chain[i - 1]);
+    }
+    return m_path;
+}
+
+const std::wstring& CItemPathBuilder::GetLong(const CItem* item)
+{
+    const std::wstring& path = Get(item);
+    if (item->IsTypeOrFlag(ITF_MTP)) return path;
+    return FinderBasic::MakeLongPathCompatible(path, m_long);
+}
+
 // --- Scanning & Done State ---
 
 void CItem::SetDone()
@@ -905,8 +1076,11 @@ void CItem::SortItemsBySizePhysical() const
     if (IsLeaf()) return;
 
     // sort by size for proper treemap rendering
-    m_folderInfo->m_children.shrink_to_fit();
-    std::ranges::sort(m_folderInfo->m_children, std::ranges::greater{}, &CItem::GetSizePhysical);
+    auto& children = m_folderInfo->m_children;
+    children.shrink_to_fit();
+    const auto compare = [](const CItem* a, const CItem* b) { return a->GetSizePhysical() > b->GetSizePhysical(); };
+    if (children.size() >= PARALLEL_SORT_THRESHOLD) std::sort(std::execution::par, children.begin(), children.end(), compare);
+    else std::ranges::sort(children, compare);
 }
 
 void CItem::SortItemsBySizeLogical() const
@@ -914,8 +1088,33 @@ void CItem::SortItemsBySizeLogical() const
     if (IsLeaf()) return;
 
     // sort by size for proper treemap rendering
-    m_folderInfo->m_children.shrink_to_fit();
-    std::ranges::sort(m_folderInfo->m_children, std::ranges::greater{}, &CItem::GetSizeLogical);
+    auto& children = m_folderInfo->m_children;
+    children.shrink_to_fit();
+    const auto compare = [](const CItem* a, const CItem* b) { return a->GetSizeLogical() > b->GetSizeLogical(); };
+    if (children.size() >= PARALLEL_SORT_THRESHOLD) std::sort(std::execution::par, children.begin(), children.end(), compare);
+    else std::ranges::sort(children, compare);
+}
+
+void CItem::SortItemsRecursive(CItem* item)
+{
+    if (item == nullptr) return;
+
+    // Collect every container first so each one can be sorted independently
+    std::vector<CItem*> folders;
+    for (std::vector stack({ item }); !stack.empty();)
+    {
+        CItem* qitem = stack.back();
+        stack.pop_back();
+        if (qitem->IsLeaf()) continue;
+        folders.push_back(qitem);
+        stack.insert(stack.end(), qitem->GetChildren().begin(), qitem->GetChildren().end());
+    }
+
+    const bool useLogical = COptions::TreeMapUseLogical;
+    std::for_each(std::execution::par, folders.begin(), folders.end(), [useLogical](const CItem* folder)
+    {
+        useLogical ? folder->SortItemsBySizeLogical() : folder->SortItemsBySizePhysical();
+    });
 }
 
 void CItem::UpdateStatsFromDisk()
@@ -965,13 +1164,18 @@ void CItem::UpdateStatsFromDisk()
     }
 }
 
-void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextNtfs, FinderBasicContext& contextBasic)
+void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextNtfs, FinderBasicContext& contextBasic,
+    CPendingFilterScopes& filterScopes)
 {
     // Reuse one finder for each storage backend throughout this worker
     FinderNtfs finderNtfs(&contextNtfs);
     FinderBasic finderBasic(&contextBasic);
     FinderMtp finderMtp;
 
+    // Count extensions into a shard of this worker rather than the shared table
+    const std::unique_ptr<SExtensionShard, decltype(&CWinDirStatModel::ReleaseExtensionShard)> extensionShard(
+        CWinDirStatModel::Get()->AcquireExtensionShard(), &CWinDirStatModel::ReleaseExtensionShard);
+
     for (auto itemOpt = queue->Pop(); itemOpt.has_value(); itemOpt = queue->Pop())
     {
         // Fetch item from queue
@@ -980,21 +1184,25 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextN
         // Mark the time we started evaluating this node
         item->ResetScanStartTime();
 
-        if (item->IsTypeOrFlag(IT_DRIVE, IT_DIRECTORY) && CFiltering::IsFilteredOut(item->GetPath()))
+        if (item->IsTypeOrFlag(IT_DRIVE, IT_DIRECTORY))
         {
-            item->UpwardSubtractReadJobs(1);
-            item->UpwardDrivePacman();
-            continue;
-        }
+            // Folders queued by a scanned parent carry a scope continued from the parent's;
+            // others match the filters against their path once so entries are checked by name
+            auto filterScope = filterScopes.Take(item);
+            if (filterScope == nullptr) filterScope = std::make_unique<const CFiltering::DirectoryScope>(item->GetPathRef());
+            if (filterScope->IsFilteredOut())
+            {
+                item->UpwardSubtractReadJobs(1);
+                item->UpwardDrivePacman();
+                continue;
+            }
 
-        // Try to load NTFS MFT
-        if (item->IsTypeOrFlag(IT_DRIVE) && COptions::UseFastScanEngine)
-        {
-            contextNtfs.LoadRoot(item);
-        }
+            // Try to load NTFS MFT
+            if (item->IsTypeOrFlag(IT_DRIVE) && COptions::UseFastScanEngine)
+            {
+                contextNtfs.LoadRoot(item);
+            }
 
-        if (item->IsTypeOrFlag(IT_DRIVE, IT_DIRECTORY))
-        {
             // Select the enumeration backend for the queued item
             Finder* finder = item->IsTypeOrFlag(ITF_MTP) ? static_cast<Finder*>(&finderMtp) :
                 contextNtfs.IsLoaded() && !item->IsTypeOrFlag(ITF_BASIC) ?
@@ -1005,15 +1213,20 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextN
                 if (finder->IsDirectory())
                 {
                     if (COptions::ExcludeHiddenDirectory && finder->IsHidden() ||
-                        COptions::ExcludeProtectedDirectory && finder->IsHiddenSystem() ||
-                        CFiltering::IsFilteredOut(finder->GetFilePath()))
+                        COptions::ExcludeProtectedDirectory && finder->IsHiddenSystem())
                     {
                         continue;
                     }
 
+                    // The subfolder's scope decides whether it is filtered and is kept for its enumeration
+                    auto childScope = CFiltering::IsFilterActive() ? std::make_unique<const CFiltering::DirectoryScope>(
+                        *filterScope, finder->GetFileName()) : nullptr;
+                    if (childScope != nullptr && childScope->IsFilteredOut()) continue;
+
                     item->UpwardAddFolders(1);
                     if (CItem* newitem = item->AddDirectory(*finder); newitem->GetReadJobs() > 0)
                     {
+                        if (childScope != nullptr) filterScopes.Push(newitem, std::move(childScope));
                         queue->Push(newitem);
                     }
                 }
@@ -1022,7 +1235,7 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextN
                     if (COptions::ExcludeHiddenFile && finder->IsHidden() ||
                         COptions::ExcludeProtectedFile && finder->IsHiddenSystem() ||
                         COptions::ExcludeSymbolicLinksFile && finder->GetReparseTag() == IO_REPARSE_TAG_SYMLINK ||
-                        CFiltering::IsFilteredOut(finder->GetFileName(), finder->GetFilePath(),
+                        filterScope->IsFileFilteredOut(finder->GetFileName(),
                             finder->GetFileSizeLogical(), finder->GetLastWriteTime()))
                     {
                         continue;
@@ -1030,7 +1243,7 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextN
 
                     item->UpwardAddFiles(1);
                     CItem* newitem = item->AddFile(*finder);
-                    CFileDupeControl::Get()->ProcessDuplicate(newitem, queue);
+                    CFileDupeControl::Get()->ProcessDuplicate(newitem);
                     CFileTopControl::Get()->ProcessTop(newitem);
                     queue->WaitIfSuspended();
                 }
@@ -1043,7 +1256,7 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextN
         {
             // Only used for refreshes
             item->UpdateStatsFromDisk();
-            CFileDupeControl::Get()->ProcessDuplicate(item, queue);
+            CFileDupeControl::Get()->ProcessDuplicate(item);
             CFileTopControl::Get()->ProcessTop(item);
             item->SetDone();
         }
@@ -1063,16 +1276,82 @@ void CItem::ScanItems(BlockingQueue<CItem*> * queue, FinderNtfsContext& contextN
 void CItem::ScanItemsFinalize(CItem* item)
 {
     if (item == nullptr) return;
-    std::vector queue({item});
-    while (!queue.empty()) [[msvc::forceinline_calls]]
+
+    // Gather the unfinished items by depth; most folders were already sorted by
+    // the worker that completed them so this usually only covers refreshed branches
+    std::vector<std::vector<CItem*>> levels;
+    for (std::vector queue({ std::pair{ item, size_t{ 0 } } }); !queue.empty();) [[msvc::forceinline_calls]]
     {
-        const auto & qitem = queue.back();
+        const auto [qitem, depth] = queue.back();
         queue.pop_back();
-        qitem->SetDone();
+        if (levels.size() <= depth) levels.resize(depth + 1);
+        levels[depth].push_back(qitem);
         if (qitem->m_folderInfo == nullptr) continue;
         for (const auto& child : qitem->GetChildren())
         {
-            if (!child->IsDone()) queue.push_back(child);
+            if (!child->IsDone()) queue.emplace_back(child, depth + 1);
+        }
+    }
+
+    // Finish the deepest level first so a folder sorting its children never
+    // runs while one of those children still updates its own flags. Volume
+    // roots adjust their space items and ancestor sizes so finalize those in
+    // order; the remaining items only sort their own children.
+    for (auto& level : levels | std::views::reverse)
+    {
+        for (CItem* qitem : level)
+        {
+            if (qitem->SupportsSpaceItems()) qitem->SetDone();
+        }
+        std::for_each(std::execution::par, level.begin(), level.end(), [](CItem* qitem)
+        {
+            qitem->SetDone();
+        });
+    }
+}
+
+void CItem::UpdateTreeIndex(CItem* root, const std::span<CItem* const> refreshed)
+{
+    if (root == nullptr || root->IsLeaf()) return;
+
+    // Renumber refreshed branches inside the range they already occupy and
+    // only renumber the whole tree if one of them no longer fits
+    bool renumberAll = root->m_folderInfo->m_enter == 0;
+    for (CItem* item : refreshed)
+    {
+        if (renumberAll) break;
+        if (item->IsLeaf()) continue;
+
+        const ULONG enter = item->m_folderInfo->m_enter;
+        const ULONG exit = item->m_folderInfo->m_exit;
+        renumberAll = enter == 0 || IndexSubtree(item, enter) > exit;
+        if (!renumberAll) item->m_folderInfo->m_exit = exit;
+    }
+
+    if (renumberAll) IndexSubtree(root, 1);
+}
+
+ULONG CItem::IndexSubtree(CItem* item, ULONG next)
+{
+    // Containers are numbered in pre-order; the exit number is assigned once
+    // all descendants are numbered so each subtree forms a contiguous range
+    std::vector<std::pair<CItem*, bool>> stack{ { item, false } };
+    while (!stack.empty())
+    {
+        const auto [qitem, exiting] = stack.back();
+        stack.pop_back();
+        if (exiting)
+        {
+            qitem->m_folderInfo->m_exit = next;
+            continue;
+        }
+
+        qitem->m_folderInfo->m_enter = next++;
+        stack.emplace_back(qitem, true);
+        for (CItem* child : qitem->GetChildren())
+        {
+            if (!child->IsLeaf()) stack.emplace_back(child, false);
         }
     }
+    return next;
 }
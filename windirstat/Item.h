@@ -24,6 +24,8 @@
 class Finder;
 class FinderNtfsContext;
 class FinderBasicContext;
+class CPendingFilterScopes;
+struct SFilterProjection;
 
 // Columns
 enum ITEMCOLUMNS : std::uint8_t
@@ -136,8 +138,8 @@ public:
     std::wstring GetText(int subitem) const override;
     COLORREF GetItemTextColor() const override;
     int CompareSibling(const CTreeListItem* tlib, int subitem) const override;
-    int GetTreeListChildCount() const noexcept override { return IsLeaf() ? 0 : static_cast<int>(GetChildren().size()); }
-    CTreeListItem* GetTreeListChild(const int i) const noexcept override { return GetChildren()[i]; }
+    int GetTreeListChildCount() const noexcept override;
+    CTreeListItem* GetTreeListChild(int i) const noexcept override;
     HICON GetIcon() override;
     void DrawAdditionalState(CDC* pdc, const CRect& rcLabel) const override;
     CItem* GetLinkedItem() noexcept override;
@@ -145,9 +147,12 @@ public:
 
     // Hierarchy / Navigation
     const std::vector<CItem*>& GetChildren() const noexcept;
+    const std::vector<CItem*>& GetVisibleChildren() const noexcept;
     bool IsLeaf() const noexcept { return m_folderInfo == nullptr; }
     bool HasChildren() const noexcept { return m_folderInfo != nullptr && !m_folderInfo->m_children.empty(); }
     CItem* GetParent() const noexcept { return reinterpret_cast<CItem*>(CTreeListItem::GetParent()); }
+    using CTreeListItem::IsAncestorOf;
+    bool IsAncestorOf(const CItem* item) const noexcept;
     CItem* GetEnumRoot() const noexcept;
     CItem* GetParentDrive() const noexcept;
     CItem* GetVolumeRoot() const noexcept;
@@ -201,9 +206,12 @@ public:
     std::wstring_view GetNameView(bool stripDrivePrefix = false) const noexcept;
     bool HasExtension(std::wstring_view extension) const noexcept;
     std::wstring GetExtension() const;
+    void GetExtension(std::wstring& extension) const; // Reuses the caller's buffer
     std::wstring GetPath() const;
     int ComparePath(const CItem* other) const;
     std::wstring GetPathLong() const;
+    const std::wstring& GetPathRef() const;
+    const std::wstring& GetPathLongRef() const;
     std::wstring GetFolderPath() const;
     bool HasUncPath() const;
     CItem* FindItemByPath(const std::wstring& path) const;
@@ -222,15 +230,18 @@ public:
     static void ResumeScanClock() noexcept;
     void SortItemsBySizePhysical() const;
     void SortItemsBySizeLogical() const;
+    static void SortItemsRecursive(CItem* item);
     void UpdateStatsFromDisk();
-    static void ScanItems(BlockingQueue<CItem*>*, FinderNtfsContext& contextNtfs, FinderBasicContext& contextBasic);
+    static void ScanItems(BlockingQueue<CItem*>*, FinderNtfsContext& contextNtfs, FinderBasicContext& contextBasic,
+        CPendingFilterScopes& filterScopes);
     static void ScanItemsFinalize(CItem* item);
+    static void UpdateTreeIndex(CItem* root, std::span<CItem* const> refreshed);
 
     // CTreeMap Interface
     bool TmiIsLeaf() const noexcept { return IsLeaf() || IsTypeOrFlag(IT_HLINKS_IDX); }
     COLORREF TmiGetGraphColor() const { return GetGraphColor(); }
     int TmiGetChildCount() const noexcept;
-    CItem* TmiGetChild(const int c) const noexcept { return m_folderInfo->m_children[c]; }
+    CItem* TmiGetChild(int c) const noexcept;
     ULONGLONG TmiGetSize() const noexcept;
 
     // Drive/Volume Specific
@@ -253,12 +264,22 @@ public:
     void UpwardDrivePacman() const;
 
     // Hardlinks & Hashing
+    // Sampled hashes cover blocks at the start, the end and evenly spaced offsets between
+    static constexpr ULONG HASH_SAMPLE_BLOCK_SIZE = 4 * wds::Ki;
+    static constexpr ULONG HASH_SAMPLE_BLOCKS = 16;
+    // Full xxHash digests of files this large combine digests of chunks hashed in parallel
+    static constexpr ULONGLONG HASH_CHUNKED_MIN_SIZE = 256 * wds::Mi;
+    static constexpr ULONGLONG HASH_CHUNK_SIZE = 16 * wds::Mi;
+    // Whole files this large are read around the file cache
+    static constexpr ULONGLONG HASH_UNBUFFERED_MIN_SIZE = 64 * wds::Mi;
     void CreateHardlinksItem();
     CItem* FindHardlinksItem() const;
     CItem* FindHardlinksIndexItem() const;
     void RemoveHardlinksItem();
     void DoHardlinkAdjustment();
-    std::vector<BYTE> GetFileHash(ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue);
+    std::vector<BYTE> GetFileHash(ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue, bool sampled = false);
+    LONGLONG GetFirstLcn() const;
+    ULONGLONG GetExtentSignature() const;
 
     ITEMTYPE GetItemType() const noexcept { return m_type & IT_MASK; }
     ITEMTYPE GetRawType() const noexcept { return m_type; }
@@ -277,29 +298,18 @@ public:
         else m_type = bitOp ? (m_type | type) : ((m_type & ~Mask) | type);
     }
 
-    template<typename Predicate = decltype([](const CItem* item) { return item->IsTypeOrFlag(IT_FILE); }) >
-    static std::vector<CItem*> GetItemsRecursive(const std::vector<CItem*>& initialItems, Predicate&& predicate = {})
-    {
-        std::vector<CItem*> items;
-        for (std::vector childStack{ initialItems }; !childStack.empty();)
-        {
-            CItem* item = childStack.back();
-            childStack.pop_back();
-            if (item->HasChildren())
-            {
-                const auto& children = item->GetChildren();
-                childStack.insert(childStack.end(), children.begin(), children.end());
-            }
-            else if (std::invoke(predicate, item)) items.emplace_back(item);
-        }
-        return items;
-    }
-
     void SetReparseType(const ITEMTYPE type) noexcept { SetType<ITRP_MASK>(type); }
     void SetHashType(const ITEMTYPE type, const bool addType = true) noexcept { SetType<ITHASH_MASK>(type, addType); }
     void SetFlag(const ITEMTYPE type, const bool unsetVal = false) noexcept { SetType<ITF_MASK>(type, true, unsetVal); }
 
 private:
+    // Values shown in the tree and treemap, which follow the active filter view
+    std::shared_ptr<const SFilterProjection> GetProjection() const noexcept;
+    ULONGLONG GetDisplaySizePhysical() const noexcept;
+    ULONGLONG GetDisplaySizeLogical() const noexcept;
+    ULONG GetDisplayFilesCount() const noexcept;
+    ULONG GetDisplayFoldersCount() const noexcept;
+    ULONGLONG GetDisplayItemsCount() const noexcept;
     ULONGLONG GetProgressRangeMyComputer() const;
     ULONGLONG GetProgressRangeDrive() const;
     COLORREF GetGraphColor() const;
@@ -307,6 +317,9 @@ private:
     COLORREF GetPercentageColor() const noexcept;
     std::wstring GetPathWithoutSlash() const;
 
+    // Child lists at least this long are sorted with the parallel algorithm
+    static constexpr size_t PARALLEL_SORT_THRESHOLD = 64 * wds::Ki;
+
     static constexpr ULONGLONG SCAN_CLOCK_SUSPENDED =
         ULONGLONG{ 1 } << (std::numeric_limits<ULONGLONG>::digits - 1);
 
@@ -315,6 +328,9 @@ private:
     static ULONG GetScanTickCount() noexcept;
     CItem* AddDirectory(const Finder& finder);
     CItem* AddFile(const Finder& finder);
+    static ULONG IndexSubtree(CItem* item, ULONG next);
+    std::vector<BYTE> ComputeFileHash(ULONGLONG hashSizeLimit, BlockingQueue<CItem*>* queue, bool sampled);
+    std::vector<BYTE> ComputeChunkedFileHash(BlockingQueue<CItem*>* queue, bool parallel);
 
     // Special structure for container items that is separately allocated to
     // reduce memory usage.  This operates under the assumption that most
@@ -327,6 +343,8 @@ private:
         std::atomic<ULONG> m_files = 0;   // # Files in subtree
         std::atomic<ULONG> m_subdirs = 0; // # Folders in subtree
         std::atomic<ULONG> m_jobs = 0;    // # "read jobs" in subtree.
+        std::atomic<ULONG> m_enter = 0;   // Pre-order container number (0 = not indexed)
+        std::atomic<ULONG> m_exit = 0;    // First number past the indexed subtree
     };
 
     std::unique_ptr<wchar_t[]> m_name;         // Display name
@@ -339,3 +357,117 @@ private:
     USHORT m_attributes = 0xFFFF;              // File or directory attributes of the item
     USHORT m_nameLen = 0;                      // Length of name string
 };
+
+//
+// CItemPathBuilder. Builds item paths into one reusable buffer for bulk consumers.
+// Consecutive lookups only rebuild the components that differ from the previous
+// item, so depth-first or otherwise clustered traversals avoid a full ancestor
+// walk and string allocation per item. The returned reference is only valid
+// until the next call and the tree must not be modified while a builder is used.
+//
+class CItemPathBuilder final
+{
+public:
+    const std::wstring& Get(const CItem* item);
+    const std::wstring& GetLong(const CItem* item);
+    void Reset() noexcept;
+
+private:
+    void Push(const CItem* item);
+
+    struct PathPart
+    {
+        const CItem* item;
+        size_t length; // Buffer length before this item was appended
+    };
+
+    std::vector<PathPart> m_parts;
+    std::vector<const CItem*> m_chain;
+    std::wstring m_path;     // Always the path of the last item in m_parts
+    std::wstring m_resolved; // Paths resolved outside the cached components
+    std::wstring m_long;
+};
+
+//
+// CItemRange. Lazily visits the items below a set of roots in depth-first
+// pre-order without materializing them. Iterators only keep the remaining
+// siblings at each level, so memory is proportional to the tree depth rather
+// than the item count. Containers are entered when the descend predicate holds
+// and items are yielded when the accept predicate holds. The tree must not be
+// modified while a range is iterated.
+//
+struct CItemAcceptFiles
+{
+    bool operator()(const CItem* item) const noexcept { return item->IsTypeOrFlag(IT_FILE); }
+};
+
+struct CItemDescendAll
+{
+    constexpr bool operator()(const CItem*) const noexcept { return true; }
+};
+
+template <typename Accept = CItemAcceptFiles, typename Descend = CItemDescendAll>
+class CItemRange final
+{
+public:
+    class Iterator final
+    {
+    public:
+        using value_type = CItem*;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        explicit Iterator(const CItemRange* range) : m_range(range)
+        {
+            m_levels.emplace_back(range->m_roots);
+            Advance();
+        }
+
+        CItem* operator*() const noexcept { return m_current; }
+        Iterator& operator++() { Advance(); return *this; }
+        void operator++(int) { Advance(); }
+        bool operator==(std::default_sentinel_t) const noexcept { return m_current == nullptr; }
+
+    private:
+        void Advance()
+        {
+            m_current = nullptr;
+            while (!m_levels.empty())
+            {
+                auto& level = m_levels.back();
+                if (level.empty())
+                {
+                    m_levels.pop_back();
+                    continue;
+                }
+
+                // Children are queued before the item is yielded since the
+                // level reference is invalidated by the push
+                CItem* item = level.front();
+                level = level.subspan(1);
+                if (!item->IsLeaf() && std::invoke(m_range->m_descend, item))
+                    m_levels.emplace_back(item->GetChildren());
+                if (std::invoke(m_range->m_accept, item))
+                {
+                    m_current = item;
+                    return;
+                }
+            }
+        }
+
+        const CItemRange* m_range = nullptr;
+        std::vector<std::span<CItem* const>> m_levels;
+        CItem* m_current = nullptr;
+    };
+
+    explicit CItemRange(const std::span<CItem* const> roots, Accept accept = {}, Descend descend = {}) :
+        m_roots(roots.begin(), roots.end()), m_accept(std::move(accept)), m_descend(std::move(descend)) {}
+
+    Iterator begin() const { return Iterator(this); }
+    static std::default_sentinel_t end() noexcept { return std::default_sentinel; }
+
+private:
+    std::vector<CItem*> m_roots;
+    Accept m_accept;
+    Descend m_descend;
+};
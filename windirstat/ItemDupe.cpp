@@ -26,6 +26,11 @@ CItemDupe::CItemDupe(const std::vector<BYTE>& hash) :
 
 CItemDupe::CItemDupe(CItem* item) : m_item(item) {}
 
+CItemDupe::CItemDupe(const std::wstring& sharedLabel) : m_hashString(sharedLabel), m_shared(true) {}
+
+CItemDupe::CItemDupe(const std::wstring& partialLabel, const ULONGLONG sharedBytes) :
+    m_hashString(partialLabel), m_sizePhysical(sharedBytes), m_sizeLogical(sharedBytes), m_partial(true) {}
+
 CItemDupe::~CItemDupe()
 {
     for (const auto& m_child : m_children)
@@ -64,7 +69,7 @@ std::wstring CItemDupe::GetText(const int subitem) const
     if (m_item == nullptr)
     {
         // Handle top-level hash collection nodes
-        if (subitem == COL_ITEMDUP_NAME) return GetHashAndExtensions();
+        if (subitem == COL_ITEMDUP_NAME) return m_partial ? m_hashString : GetHashAndExtensions();
         if (subitem == COL_ITEMDUP_SIZE_PHYSICAL) return FormatBytes(m_sizePhysical);
         if (subitem == COL_ITEMDUP_SIZE_LOGICAL) return FormatBytes(m_sizeLogical);
         if (subitem == COL_ITEMDUP_ITEMS) return FormatCount(GetChildren().size());
@@ -125,6 +130,7 @@ std::wstring CItemDupe::GetHashAndExtensions() const
     std::unordered_set<std::wstring> extensionsSet;
     for (const auto& child : m_children)
     {
+        if (!child->m_item->IsTypeOrFlag(IT_FILE)) continue;
         const auto & ext = child->m_item->GetExtension();
         if (ext.empty()) extensionsSet.emplace(L".???");
         else extensionsSet.emplace(ext);
@@ -149,14 +155,21 @@ std::wstring CItemDupe::GetHashAndExtensions() const
         extensions.pop_back();
     }
 
-    // Format string as Hash (.exta, .extb)
+    // Format string as Hash (.exta, .extb); folder sets show the hash alone
+    if (extensionsSet.empty()) return m_hashString;
     return m_hashString + L" (" + extensions + L")";
 }
 
 void CItemDupe::AddDupeItemChild(CItemDupe* child)
 {
     // Adjust parent item sizes
-    if (const auto childItem = child->GetLinkedItem(); childItem != nullptr)
+    if (const auto childItem = child->GetLinkedItem(); childItem == nullptr || m_partial) {}
+    else if (m_shared)
+    {
+        m_sizeLogical = childItem->GetSizeLogical();
+        m_sizePhysical = std::max(m_sizePhysical, childItem->GetSizePhysicalRaw());
+    }
+    else
     {
         m_sizeLogical += childItem->GetSizeLogical();
         m_sizePhysical += childItem->GetSizePhysical();
@@ -182,7 +195,7 @@ void CItemDupe::RemoveDupeItemChild(CItemDupe* child)
 
     // Adjust parent item sizes
     std::scoped_lock guard(m_protect);
-    if (const auto childItem = child->GetLinkedItem(); childItem != nullptr)
+    if (const auto childItem = child->GetLinkedItem(); childItem != nullptr && !m_partial)
     {
         m_sizeLogical -= childItem->GetSizeLogical();
         m_sizePhysical -= childItem->GetSizePhysical();
@@ -194,4 +207,13 @@ void CItemDupe::RemoveDupeItemChild(CItemDupe* child)
         children.erase(it);
     }
     delete child;
+
+    // Shared sets count the largest remaining copy
+    if (m_shared)
+    {
+        m_sizePhysical = 0;
+        for (const auto* remaining : children)
+            m_sizePhysical = std::max(m_sizePhysical, remaining->m_item->GetSizePhysicalRaw());
+        if (children.empty()) m_sizeLogical = 0;
+    }
 }
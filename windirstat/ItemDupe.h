@@ -38,6 +38,8 @@ class CItemDupe final : public CTreeListItem
     ULONGLONG m_sizeLogical = 0;
     CItem* m_item = nullptr;
     std::shared_mutex m_protect;
+    bool m_shared = false; // Children already share their data so only one copy is counted
+    bool m_partial = false; // Children share part of their content; sizes hold the shared bytes
 
 public:
     CItemDupe(const CItemDupe&) = delete;
@@ -47,6 +49,8 @@ public:
     CItemDupe() = default;
     CItemDupe(const std::vector<BYTE> & hash);
     CItemDupe(CItem* item);
+    explicit CItemDupe(const std::wstring& sharedLabel);
+    CItemDupe(const std::wstring& partialLabel, ULONGLONG sharedBytes);
     ~CItemDupe() override;
 
     // Inherited Overrides
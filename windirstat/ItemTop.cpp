@@ -18,9 +18,14 @@
 #include "pch.h"
 #include "ItemTop.h"
 #include "FileTopControl.h"
+#include "FolderRankings.h"
 
 CItemTop::CItemTop(CItem* item) : m_item(item) {}
 
+CItemTop::CItemTop(std::wstring title, const BYTE group) : m_title(std::move(title)), m_group(group) {}
+
+CItemTop::CItemTop(CItem* folder, const ULONGLONG value, const BYTE group) : m_item(folder), m_value(value), m_group(group) {}
+
 CItemTop::~CItemTop()
 {
     for (const auto& m_child : m_children)
@@ -54,11 +59,17 @@ std::wstring CItemTop::GetText(const int subitem) const
     static std::wstring tops = Localization::Lookup(IDS_LARGEST_FILES);
     if (GetParent() == nullptr) return subitem == COL_ITEMTOP_NAME ? tops : std::wstring{};
 
-    // Parent hash nodes
-    if (m_item == nullptr) return {};
+    // Folder ranking groups
+    if (m_item == nullptr) return subitem == COL_ITEMTOP_NAME ? m_title : std::wstring{};
 
-    // Individual file names
-    if (subitem == COL_ITEMTOP_NAME) return m_item->GetPath();
+    // Individual file names; ranked folders also show what they were ranked by
+    if (subitem == COL_ITEMTOP_NAME)
+    {
+        const int ranking = m_group - 1;
+        if (m_group == 0 || ranking == CFolderRankings::TotalSize) return m_item->GetPath();
+        return std::format(L"{} ({}{})", m_item->GetPath(), ranking == CFolderRankings::Growth ? L"+" : L"",
+            ranking == CFolderRankings::Files ? FormatCount(m_value) : FormatBytes(m_value));
+    }
     const int mapped = GetMappedColumn(subitem);
     return mapped != -1 ? m_item->GetText(mapped) : std::wstring{};
 }
@@ -68,11 +79,17 @@ int CItemTop::CompareSibling(const CTreeListItem* tlib, const int subitem) const
     // Root node
     if (GetParent() == nullptr) return 0;
 
-    // Parent hash nodes
-    if (m_item == nullptr) return 0;
+    // Folder ranking groups follow the largest files in a fixed order
+    const auto* other = reinterpret_cast<const CItemTop*>(tlib);
+    if (m_item == nullptr || other->m_item == nullptr) return usignum(m_group, other->m_group);
+
+    // Ranked folders keep their ranking unless sorted by name or date
+    if (m_group != 0 && subitem != COL_ITEMTOP_NAME && subitem != COL_ITEMTOP_LAST_CHANGE)
+    {
+        return usignum(m_value, other->m_value);
+    }
 
     // Individual file names
-    const auto* other = reinterpret_cast<const CItemTop*>(tlib);
     const int mapped = GetMappedColumn(subitem);
     return mapped != -1 ? m_item->CompareSibling(other->m_item, mapped) : 0;
 }
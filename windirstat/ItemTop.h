@@ -33,7 +33,10 @@ class CItemTop final : public CTreeListItem
 {
     std::shared_mutex m_protect;
     std::vector<CItemTop*> m_children;
+    std::wstring m_title;  // Folder ranking groups only
     CItem* m_item = nullptr;
+    ULONGLONG m_value = 0; // What a ranked folder was ranked by
+    BYTE m_group = 0;      // Zero for the largest files, otherwise one past the folder ranking
 
 public:
     CItemTop(const CItemTop&) = delete;
@@ -42,6 +45,8 @@ public:
     CItemTop& operator=(CItemTop&&) = delete;
     CItemTop() = default;
     CItemTop(CItem* item);
+    CItemTop(std::wstring title, BYTE group);
+    CItemTop(CItem* folder, ULONGLONG value, BYTE group);
     ~CItemTop() override;
 
     // CTreeListItem Interface
@@ -17,6 +17,7 @@
 
 #include "pch.h"
 #include "Filtering.h"
+#include "FilterView.h"
 #include "TreeMap.h"
 #include "VisualizationPane.h"
 #include "FileTabbedView.h"
@@ -545,16 +546,6 @@ void CMainFrame::OnUpdateViewSunburst(CCmdUI* pCmdUI) const
     pCmdUI->SetRadio(GetGraphPaneType() == GraphPane::Sunburst);
 }
 
-static void SortItemRecursive(CItem* item)
-{
-    if (item == nullptr || item->IsLeaf()) return;
-    COptions::TreeMapUseLogical ? item->SortItemsBySizeLogical() : item->SortItemsBySizePhysical();
-    for (CItem* child : item->GetChildren())
-    {
-        SortItemRecursive(child);
-    }
-}
-
 void CMainFrame::OnViewTreeMapUseLogical()
 {
     if (!COptions::TreeMapUseLogical)
@@ -562,7 +553,8 @@ void CMainFrame::OnViewTreeMapUseLogical()
         COptions::TreeMapUseLogical = true;
         if (CItem* root = CWinDirStatModel::Get()->GetRootItem())
         {
-            SortItemRecursive(root);
+            CItem::SortItemsRecursive(root);
+            if (const auto view = CFilterView::GetActive()) view->SortChildren();
             CWinDirStatModel::Get()->NotifyPanes(MODEL_CHANGE_SIZE_MODE);
         }
         UpdatePaneText();
@@ -576,7 +568,8 @@ void CMainFrame::OnViewTreeMapUsePhysical()
         COptions::TreeMapUseLogical = false;
         if (CItem* root = CWinDirStatModel::Get()->GetRootItem())
         {
-            SortItemRecursive(root);
+            CItem::SortItemsRecursive(root);
+            if (const auto view = CFilterView::GetActive()) view->SortChildren();
             CWinDirStatModel::Get()->NotifyPanes(MODEL_CHANGE_SIZE_MODE);
         }
         UpdatePaneText();
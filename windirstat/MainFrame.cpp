@@ -20,6 +20,7 @@
 #include "FileTabbedView.h"
 #include "FileTreeView.h"
 #include "ExtensionView.h"
+#include "HashCache.h"
 #include "PageAdvanced.h"
 #include "PageFiltering.h"
 #include "PageCleanups.h"
@@ -446,6 +447,35 @@ void CMainFrame::UpdateProgress()
     CWinDirStatModel::Get()->SetScanTitlePrefix(titlePrefix);
 }
 
+void CMainFrame::UpdateHashProgress()
+{
+    // Clear the hashing progress once the stage has drained or stopped
+    if (!CFileDupeControl::Get()->IsHashing())
+    {
+        if (!m_hashProgressVisible) return;
+        m_hashProgressVisible = false;
+        if (m_taskbarList) m_taskbarList->SetProgressState(*this, m_taskbarButtonState = TBPF_NOPROGRESS);
+        CWinDirStatModel::Get()->SetScanTitlePrefix(wds::strEmpty);
+        CFileDupeControl::Get()->SortItems();
+        return;
+    }
+
+    const auto [hashed, queued] = CFileDupeControl::Get()->GetHashProgress();
+    if (queued == 0) return;
+    m_hashProgressVisible = true;
+
+    const int pos = static_cast<int>(std::min<size_t>(hashed * 100ull / queued, 100));
+    if (m_taskbarList && m_taskbarButtonState != TBPF_PAUSED)
+    {
+        m_taskbarList->SetProgressState(*this, m_taskbarButtonState = TBPF_NORMAL);
+        m_taskbarList->SetProgressValue(*this, hashed, queued);
+    }
+
+    std::wstring titlePrefix = std::to_wstring(pos) + L"%";
+    if (IsScanSuspended()) titlePrefix += L" " + Localization::Lookup(IDS_SUSPENDED);
+    CWinDirStatModel::Get()->SetScanTitlePrefix(titlePrefix);
+}
+
 void CMainFrame::CreateStatusProgress()
 {
     UpdatePaneText();
@@ -582,6 +612,9 @@ void CMainFrame::OnClose()
     // Stop icon queue
     GetIconHandler()->StopAsyncShellInfoQueue();
 
+    // Finish writing the hash cache that hashing saved in the background
+    CHashCache::Get()->Flush();
+
     // It's too late, to do this in OnDestroy(). Because the toolbar, if undocked,
     // is already destroyed in OnDestroy(). So we must save the toolbar state here
     // in OnClose().
@@ -673,7 +706,10 @@ bool CMainFrame::PreCreateWindow(CREATESTRUCT& cs)
     // Prevent flashing of the main window when launching in non-interactive mode
     if (!CDirStatApp::Get()->GetSaveToPath().empty() ||
         !CDirStatApp::Get()->GetSaveDupesToPath().empty() ||
-        !CDirStatApp::Get()->GetSavePermsToPath().empty())
+        !CDirStatApp::Get()->GetSavePermsToPath().empty() ||
+        !CDirStatApp::Get()->GetSaveQueryToPath().empty() ||
+        !CDirStatApp::Get()->GetSaveFoldersToPath().empty() ||
+        !CDirStatApp::Get()->GetSaveStatsToPath().empty())
     {
         CDirStatApp::Get()->m_nCmdShow = SW_HIDE;
         cs.style &= ~WS_VISIBLE;
@@ -879,6 +915,19 @@ void CMainFrame::OnTimer(const UINT_PTR nIDEvent)
             CFileTopControl::Get()->SortItems();
         }
     }
+    else if (CWinDirStatModel::Get()->IsRootDone())
+    {
+        // Duplicate hashing outlasts the tree scan; stream its results as they arrive
+        UpdateHashProgress();
+        if (CFileDupeControl::Get()->IsHashing() && doInfrequentUpdate &&
+            GetFileTabbedView()->IsFileDupeViewTabActive())
+        {
+            CFileDupeControl::Get()->SortItems();
+        }
+
+        // The largest files are rebuilt from the finished tree off this thread
+        if (CFileTopControl::Get()->IsRebuildReady()) CFileTopControl::Get()->SortItems();
+    }
 
     CWinDirStatModel::Get()->RunPendingHeapCleanup();
 
@@ -189,6 +189,7 @@ public:
     bool IsScanSuspended() const { return m_scanSuspend; }
 
     void UpdateProgress();
+    void UpdateHashProgress();
     void UpdateDynamicMenuItems(CMenu* menu, CMenu* menuHeader = nullptr) const;
     std::pair<CMenu*, int> LocateNamedMenu(const CMenu* menu, const std::wstring& subMenuText, bool removeItems = true) const;
 
@@ -213,6 +214,7 @@ public:
     UINT_PTR m_timer = 0;           // Timer for updating the display
     bool m_progressVisible = false; // True while progress must be shown (either pacman or progress bar)
     bool m_scanSuspend = false;     // True if the scan has been suspended
+    bool m_hashProgressVisible = false; // True while duplicate hashing outlasts the scan
     bool m_shuttingDown = false;    // Marks the process is shutting down so we can exit timers
     ULONGLONG m_progressRange = 0;  // Progress range. A range of 0 means Pacman should be used.
     ULONGLONG m_progressPos = 0;    // Progress position (<= progressRange, or an item count in case of m_progressRang == 0)
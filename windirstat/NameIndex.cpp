@@ -0,0 +1,446 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "NameIndex.h"
+
+// Runs the function over consecutive slices of [0, count) in parallel
+template<typename Function>
+static void ForEachSlice(const size_t count, Function&& function)
+{
+    constexpr size_t sliceSize = 64 * wds::Ki;
+    std::vector<std::pair<size_t, size_t>> slices;
+    for (size_t begin = 0; begin < count; begin += sliceSize)
+    {
+        slices.emplace_back(begin, std::min(count, begin + sliceSize));
+    }
+
+    std::for_each(std::execution::par, slices.begin(), slices.end(), [&](const auto& slice)
+    {
+        for (size_t i = slice.first; i < slice.second; i++) function(i);
+    });
+}
+
+CNameIndex* CNameIndex::Get()
+{
+    static CNameIndex instance;
+    return &instance;
+}
+
+void CNameIndex::CollectBuckets(const std::wstring_view name, const ULONG bucketBits, std::vector<ULONG>& buckets)
+{
+    buckets.clear();
+    if (name.size() < 3) return;
+
+    wchar_t first = FoldCase(name[0]);
+    wchar_t second = FoldCase(name[1]);
+    for (const wchar_t c : name.substr(2))
+    {
+        const wchar_t third = FoldCase(c);
+        const ULONGLONG trigram = static_cast<ULONGLONG>(first) << 32 | static_cast<ULONGLONG>(second) << 16 | third;
+        buckets.push_back(static_cast<ULONG>(trigram * 0x9E3779B97F4A7C15ull >> (64 - bucketBits)));
+        first = second;
+        second = third;
+    }
+
+    std::ranges::sort(buckets);
+    buckets.erase(std::ranges::unique(buckets).begin(), buckets.end());
+}
+
+std::vector<CItem*> CNameIndex::CollectItems(CItem* root)
+{
+    // Index the same items a search walk visits; space and hardlink items come
+    // and go with view options, so searches match them as they are instead
+    std::vector<CItem*> items;
+    for (std::vector stack({ root }); !stack.empty();)
+    {
+        CItem* item = stack.back();
+        stack.pop_back();
+        if (item->IsTypeOrFlag(IT_FREESPACE, IT_UNKNOWN, IT_HLINKS)) continue;
+        items.push_back(item);
+        if (item->IsLeaf()) continue;
+        stack.insert(stack.end(), item->GetChildren().begin(), item->GetChildren().end());
+    }
+    return items;
+}
+
+size_t CNameIndex::Segment::GetBytes() const noexcept
+{
+    return items.capacity() * sizeof(CItem*) +
+        (nameOffsets.capacity() + bucketOffsets.capacity() + postings.capacity()) * sizeof(ULONG);
+}
+
+CNameIndex::Segment CNameIndex::BuildSegment(std::vector<CItem*> items)
+{
+    // Equal names end up next to each other and are indexed once
+    std::sort(std::execution::par, items.begin(), items.end(), [](const CItem* a, const CItem* b)
+    {
+        return a->GetNameView() < b->GetNameView();
+    });
+
+    Segment segment;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (i == 0 || items[i]->GetNameView() != items[i - 1]->GetNameView())
+            segment.nameOffsets.push_back(static_cast<ULONG>(i));
+    }
+    segment.nameOffsets.push_back(static_cast<ULONG>(items.size()));
+    const size_t nameCount = segment.GetNameCount();
+
+    // Buckets scale with the names so a small segment does not carry a full table
+    segment.bucketBits = std::clamp(static_cast<ULONG>(std::bit_width(nameCount)), MIN_BUCKET_BITS, MAX_BUCKET_BITS);
+    const size_t bucketCount = size_t{ 1 } << segment.bucketBits;
+
+    // Count the postings of each bucket, then place every name under its buckets
+    std::vector<std::atomic<ULONG>> cursors(bucketCount);
+    ForEachSlice(nameCount, [&](const size_t name)
+    {
+        thread_local std::vector<ULONG> buckets;
+        CollectBuckets(items[segment.nameOffsets[name]]->GetNameView(), segment.bucketBits, buckets);
+        for (const ULONG bucket : buckets) cursors[bucket].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    segment.bucketOffsets.resize(bucketCount + 1);
+    for (size_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+        segment.bucketOffsets[bucket + 1] = segment.bucketOffsets[bucket] + cursors[bucket].load(std::memory_order_relaxed);
+        cursors[bucket].store(segment.bucketOffsets[bucket], std::memory_order_relaxed);
+    }
+
+    segment.postings.resize(segment.bucketOffsets.back());
+    ForEachSlice(nameCount, [&](const size_t name)
+    {
+        thread_local std::vector<ULONG> buckets;
+        CollectBuckets(items[segment.nameOffsets[name]]->GetNameView(), segment.bucketBits, buckets);
+        for (const ULONG bucket : buckets)
+        {
+            segment.postings[cursors[bucket].fetch_add(1, std::memory_order_relaxed)] = static_cast<ULONG>(name);
+        }
+    });
+
+    // Sorted postings let candidate lists be intersected by merging
+    ForEachSlice(bucketCount, [&](const size_t bucket)
+    {
+        std::sort(segment.postings.begin() + segment.bucketOffsets[bucket],
+            segment.postings.begin() + segment.bucketOffsets[bucket + 1]);
+    });
+
+    segment.items = std::move(items);
+    return segment;
+}
+
+void CNameIndex::Build(CItem* root)
+{
+    Clear();
+    const ULONGLONG start = GetTickCount64();
+    Segment base = BuildSegment(CollectItems(root));
+
+    std::unique_lock lock(m_mutex);
+    m_root = root;
+    m_base = std::move(base);
+    UpdateStatistics(GetTickCount64() - start);
+}
+
+void CNameIndex::Remove(const std::vector<CItem*>& subtrees)
+{
+    std::unique_lock lock(m_mutex);
+    if (m_root == nullptr) return;
+
+    // A refresh that never completed left its subtrees out, so the tree is indexed again
+    if (m_stale)
+    {
+        Reset();
+        return;
+    }
+
+    // Searches walk the tree until the rescanned items are indexed
+    m_stale = true;
+    std::unordered_set<const CItem*> removed;
+    for (CItem* subtree : subtrees)
+    {
+        for (const CItem* item : CollectItems(subtree)) removed.insert(item);
+    }
+    if (removed.empty()) return;
+
+    for (Segment* segment : { &m_base, &m_delta })
+    {
+        std::atomic<size_t> dropped = 0;
+        ForEachSlice(segment->items.size(), [&](const size_t i)
+        {
+            if (segment->items[i] == nullptr || !removed.contains(segment->items[i])) return;
+            segment->items[i] = nullptr;
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        });
+        if (segment == &m_base) m_baseRemoved += dropped;
+    }
+}
+
+void CNameIndex::Update(CItem* root, const std::vector<CItem*>& subtrees)
+{
+    const ULONGLONG start = GetTickCount64();
+    std::unique_lock lock(m_mutex);
+
+    // Items rescanned by earlier refreshes are indexed again along with this one's
+    std::vector<CItem*> items;
+    if (m_root == root && m_stale)
+    {
+        std::ranges::copy_if(m_delta.items, std::back_inserter(items), [](const CItem* item) { return item != nullptr; });
+        for (CItem* subtree : subtrees)
+        {
+            const auto collected = CollectItems(subtree);
+            items.insert(items.end(), collected.begin(), collected.end());
+        }
+    }
+
+    // A new tree, or changes touching a large part of it, are indexed from scratch
+    if (m_root != root || !m_stale || (items.size() + m_baseRemoved) * 4 > m_base.items.size())
+    {
+        lock.unlock();
+        Build(root);
+        return;
+    }
+
+    m_delta = BuildSegment(std::move(items));
+    m_stale = false;
+    UpdateStatistics(GetTickCount64() - start);
+}
+
+void CNameIndex::Clear()
+{
+    std::unique_lock lock(m_mutex);
+    Reset();
+}
+
+void CNameIndex::Reset()
+{
+    m_root = nullptr;
+    m_base = {};
+    m_delta = {};
+    m_baseRemoved = 0;
+    m_stale = false;
+    m_statistics = {};
+}
+
+void CNameIndex::UpdateStatistics(const ULONGLONG buildTicks)
+{
+    m_statistics = { m_base.items.size() - m_baseRemoved + m_delta.items.size(),
+        m_base.GetNameCount() + m_delta.GetNameCount(), m_base.GetBytes() + m_delta.GetBytes(), buildTicks };
+}
+
+CNameIndex::Statistics CNameIndex::GetStatistics() const
+{
+    std::shared_lock lock(m_mutex);
+    return m_statistics;
+}
+
+std::vector<std::wstring> CNameIndex::RequiredLiterals(const std::wstring& searchTerm, const bool searchRegex)
+{
+    std::vector<std::wstring> literals;
+    std::wstring run;
+    const auto endRun = [&]
+    {
+        if (run.size() >= 3) literals.push_back(run);
+        run.clear();
+    };
+
+    if (!searchRegex)
+    {
+        // Wildcards separate the literal parts of a glob
+        for (const wchar_t c : searchTerm)
+        {
+            if (c == L'*' || c == L'?') endRun();
+            else run.push_back(c);
+        }
+        endRun();
+        return literals;
+    }
+
+    // Any alternative may match on its own so nothing is required
+    if (searchTerm.find(L'|') != std::wstring::npos) return {};
+
+    // Only plain characters outside groups and classes are kept; quantifiers
+    // that allow zero occurrences drop the character they follow
+    const auto skipClass = [&](size_t& i)
+    {
+        if (i + 1 < searchTerm.size() && searchTerm[i + 1] == L'^') i++;
+        if (i + 1 < searchTerm.size() && searchTerm[i + 1] == L']') i++;
+        while (++i < searchTerm.size() && searchTerm[i] != L']')
+        {
+            if (searchTerm[i] == L'\\') i++;
+        }
+    };
+
+    for (size_t i = 0; i < searchTerm.size(); i++)
+    {
+        const wchar_t c = searchTerm[i];
+        if (c == L'\\' && i + 1 < searchTerm.size())
+        {
+            const wchar_t escaped = searchTerm[++i];
+            if (!iswalnum(escaped))
+            {
+                run.push_back(escaped);
+                continue;
+            }
+
+            // Character codes are skipped along with their digits
+            endRun();
+            if (escaped == L'x') i += 2;
+            else if (escaped == L'u') i += 4;
+            else if (escaped == L'c') i += 1;
+        }
+        else if (c == L'*' || c == L'?' || c == L'{')
+        {
+            if (!run.empty()) run.pop_back();
+            endRun();
+            if (c == L'{') i = std::min(searchTerm.size(), searchTerm.find(L'}', i));
+        }
+        else if (c == L'+')
+        {
+            // The repeated character still starts whatever follows
+            const wchar_t last = run.empty() ? L'\0' : run.back();
+            endRun();
+            if (last != L'\0') run.push_back(last);
+        }
+        else if (c == L'[')
+        {
+            endRun();
+            skipClass(i);
+        }
+        else if (c == L'(')
+        {
+            endRun();
+            for (int depth = 1; depth > 0 && ++i < searchTerm.size();)
+            {
+                if (searchTerm[i] == L'\\') i++;
+                else if (searchTerm[i] == L'[') skipClass(i);
+                else if (searchTerm[i] == L'(') depth++;
+                else if (searchTerm[i] == L')') depth--;
+            }
+        }
+        else if (c == L'.' || c == L'^' || c == L'$' || c == L')' || c == L']' || c == L'}') endRun();
+        else run.push_back(c);
+    }
+    endRun();
+    return literals;
+}
+
+size_t CNameIndex::SearchSegment(const Segment& segment, const std::vector<std::wstring>& literals,
+    const std::wregex& searchRegexCompiled, const bool searchWholePhrase, const bool onlyFiles,
+    std::vector<CItem*>& matches)
+{
+    if (segment.GetNameCount() == 0) return 0;
+
+    // Gather the buckets of every trigram the matching names must contain
+    std::vector<ULONG> buckets;
+    for (std::vector<ULONG> literalBuckets; const auto& literal : literals)
+    {
+        CollectBuckets(literal, segment.bucketBits, literalBuckets);
+        buckets.insert(buckets.end(), literalBuckets.begin(), literalBuckets.end());
+    }
+    std::ranges::sort(buckets);
+    buckets.erase(std::ranges::unique(buckets).begin(), buckets.end());
+
+    // Intersect from the shortest list; without any trigram every name is a candidate
+    const auto bucketPostings = [&segment](const ULONG bucket)
+    {
+        return std::span(segment.postings).subspan(segment.bucketOffsets[bucket],
+            segment.bucketOffsets[bucket + 1] - segment.bucketOffsets[bucket]);
+    };
+    std::ranges::sort(buckets, {}, [&](const ULONG bucket) { return bucketPostings(bucket).size(); });
+
+    std::vector<ULONG> candidates;
+    if (buckets.empty())
+    {
+        candidates.resize(segment.GetNameCount());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+    else
+    {
+        candidates.assign(bucketPostings(buckets.front()).begin(), bucketPostings(buckets.front()).end());
+        for (std::vector<ULONG> narrowed; const ULONG bucket : buckets | std::views::drop(1))
+        {
+            if (candidates.empty()) break;
+            narrowed.clear();
+            std::ranges::set_intersection(candidates, bucketPostings(bucket), std::back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+    }
+
+    // Confirm each candidate name once no matter how many items carry it; any
+    // item left in a name's group can stand in for it
+    const auto groupOf = [&segment](const ULONG name)
+    {
+        return std::span(segment.items).subspan(segment.nameOffsets[name],
+            segment.nameOffsets[name + 1] - segment.nameOffsets[name]);
+    };
+    std::vector<BYTE> confirmed(candidates.size());
+    ForEachSlice(candidates.size(), [&](const size_t i)
+    {
+        const auto group = groupOf(candidates[i]);
+        const auto named = std::ranges::find_if(group, [](const CItem* item) { return item != nullptr; });
+        if (named == group.end()) return;
+
+        const auto nameView = (*named)->GetNameView();
+        confirmed[i] = searchWholePhrase ?
+            std::regex_match(nameView.begin(), nameView.end(), searchRegexCompiled) :
+            std::regex_search(nameView.begin(), nameView.end(), searchRegexCompiled);
+    });
+
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        if (!confirmed[i]) continue;
+        for (CItem* item : groupOf(candidates[i]))
+        {
+            if (item != nullptr && (!onlyFiles || item->IsTypeOrFlag(IT_FILE))) matches.push_back(item);
+        }
+    }
+    return candidates.size();
+}
+
+bool CNameIndex::Search(const CItem* root, const std::wstring& searchTerm, const bool searchRegex,
+    const std::wregex& searchRegexCompiled, const bool searchWholePhrase, const bool onlyFiles,
+    std::vector<CItem*>& matches) const
+{
+    std::shared_lock lock(m_mutex);
+    if (m_root == nullptr || m_root != root || m_stale) return false;
+    const ULONGLONG start = GetTickCount64();
+
+    const auto literals = RequiredLiterals(searchTerm, searchRegex);
+    size_t candidates = 0;
+    for (const Segment* segment : { &m_base, &m_delta })
+    {
+        candidates += SearchSegment(*segment, literals, searchRegexCompiled, searchWholePhrase, onlyFiles, matches);
+    }
+
+    // Space and hardlink items are not indexed and are matched as they are now
+    for (const CItem* spaceRoot : m_root->GetSpaceItems())
+    {
+        CItem* const hardlinks = spaceRoot->IsTypeOrFlag(IT_DRIVE) ? spaceRoot->FindHardlinksItem() : nullptr;
+        for (CItem* item : { spaceRoot->FindFreeSpaceItem(), spaceRoot->FindUnknownItem(), hardlinks })
+        {
+            if (item == nullptr || onlyFiles && !item->IsTypeOrFlag(IT_FILE)) continue;
+            const auto nameView = item->GetNameView();
+            if (searchWholePhrase ?
+                std::regex_match(nameView.begin(), nameView.end(), searchRegexCompiled) :
+                std::regex_search(nameView.begin(), nameView.end(), searchRegexCompiled)) matches.push_back(item);
+        }
+    }
+
+    VTRACE(L"Name index search: {} candidates, {} matches in {} ms",
+        candidates, matches.size(), GetTickCount64() - start);
+    return true;
+}
@@ -0,0 +1,97 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// CNameIndex. Trigram index over the names in the scanned tree so searches
+// only verify names that can possibly match instead of walking every item.
+// Equal names are indexed once; each distinct name is listed under the
+// hashed buckets of its case folded trigrams. Literal text the search term
+// requires narrows the candidates and the search expression then confirms
+// them, so bucket collisions and case never affect the results. A refresh
+// drops its subtrees from the built index and indexes their rescanned items
+// in a small second segment; the whole tree is indexed again only once the
+// changes outgrow a fraction of it.
+//
+class CNameIndex final
+{
+public:
+
+    struct Statistics
+    {
+        ULONGLONG items = 0;
+        ULONGLONG names = 0;   // Distinct names
+        ULONGLONG bytes = 0;   // Memory held by the index
+        ULONGLONG buildTicks = 0;
+    };
+
+    static CNameIndex* Get();
+
+    void Build(CItem* root);
+    void Clear();
+    Statistics GetStatistics() const;
+
+    // Subtrees about to be rescanned leave the index until the update that follows the scan
+    void Remove(const std::vector<CItem*>& subtrees);
+    void Update(CItem* root, const std::vector<CItem*>& subtrees);
+
+    // Fills the matches below the indexed root; false when no index covers it
+    bool Search(const CItem* root, const std::wstring& searchTerm, bool searchRegex,
+        const std::wregex& searchRegexCompiled, bool searchWholePhrase, bool onlyFiles,
+        std::vector<CItem*>& matches) const;
+
+    // Substrings every name matched by the search term contains
+    static std::vector<std::wstring> RequiredLiterals(const std::wstring& searchTerm, bool searchRegex);
+
+private:
+
+    static constexpr ULONG MIN_BUCKET_BITS = 10;
+    static constexpr ULONG MAX_BUCKET_BITS = 22;
+
+    struct Segment
+    {
+        std::vector<CItem*> items;        // Grouped by name; null once removed
+        std::vector<ULONG> nameOffsets;   // First item of each distinct name, plus the end
+        std::vector<ULONG> bucketOffsets; // First posting of each bucket, plus the end
+        std::vector<ULONG> postings;      // Name numbers in ascending order per bucket
+        ULONG bucketBits = MIN_BUCKET_BITS;
+
+        size_t GetNameCount() const noexcept { return nameOffsets.empty() ? 0 : nameOffsets.size() - 1; }
+        size_t GetBytes() const noexcept;
+    };
+
+    CNameIndex() = default;
+
+    static void CollectBuckets(std::wstring_view name, ULONG bucketBits, std::vector<ULONG>& buckets);
+    static std::vector<CItem*> CollectItems(CItem* root);
+    static Segment BuildSegment(std::vector<CItem*> items);
+    static size_t SearchSegment(const Segment& segment, const std::vector<std::wstring>& literals,
+        const std::wregex& searchRegexCompiled, bool searchWholePhrase, bool onlyFiles, std::vector<CItem*>& matches);
+    void Reset();
+    void UpdateStatistics(ULONGLONG buildTicks);
+
+    mutable std::shared_mutex m_mutex;
+    const CItem* m_root = nullptr;
+    Segment m_base;               // Built over the whole tree
+    Segment m_delta;              // Items rescanned since the base was built
+    size_t m_baseRemoved = 0;     // Base items dropped by refreshes
+    bool m_stale = false;         // A refresh is under way
+    Statistics m_statistics;
+};
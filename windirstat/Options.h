@@ -180,6 +180,7 @@ public:
     inline static Setting<bool> ExcludeHiddenFile{ OptionsGeneral, L"ExcludeHiddenFile", false };
     inline static Setting<bool> ExcludeProtectedFile{ OptionsGeneral, L"ExcludeProtectedFile", false };
     inline static Setting<bool> FilteringUseRegex{ OptionsGeneral, L"FilteringUseRegex", false };
+    inline static Setting<bool> FilteringApplyToResults{ OptionsGeneral, L"FilteringApplyToResults", false };
     inline static Setting<bool> FollowVolumeMountPoints{ OptionsGeneral, L"FollowVolumeMountPoints", false };
     inline static Setting<bool> UseSizeSuffixes{ OptionsGeneral, L"UseSizeSuffixes", true };
     inline static Setting<bool> ListFullRowSelection{ OptionsGeneral, L"ListFullRowSelection", true };
@@ -187,10 +188,16 @@ public:
     inline static Setting<bool> ListStripes{ OptionsGeneral, L"ListStripes", false };
     inline static Setting<bool> PacmanAnimation{ OptionsGeneral, L"PacmanAnimation", true };
     inline static Setting<bool> ScanForDuplicates{ OptionsDupeTree, L"ScanForDuplicates", false };
+    inline static Setting<bool> PersistHashCache{ OptionsDupeTree, L"PersistHashCache", true };
+    inline static Setting<bool> ScanForDuplicateFolders{ OptionsDupeTree, L"ScanForDuplicateFolders", false };
+    inline static Setting<bool> ScanForPartialDuplicates{ OptionsDupeTree, L"ScanForPartialDuplicates", false };
+    inline static Setting<int> PartialDupeMinSizeMiB{ OptionsDupeTree, L"PartialDupeMinSizeMiB", 64, 1, 1024 * 1024 };
+    inline static Setting<int> PartialDupeMinPercent{ OptionsDupeTree, L"PartialDupeMinPercent", 10, 1, 100 };
     inline static Setting<bool> SearchWholePhrase{ OptionsSearch, L"SearchWholePhrase", false };
     inline static Setting<bool> SearchRegex{ OptionsSearch, L"SearchRegex", false };
     inline static Setting<bool> SearchCase{ OptionsSearch, L"SearchCase", false };
     inline static Setting<int> SearchMaxResults{ OptionsSearch, L"SearchMaxResults", 10000, 1, 1000000 };
+    inline static Setting<int> SearchThreads{ OptionsSearch, L"SearchThreads", 0, 0, 256 };
     inline static Setting<bool> ShowDeletePermanentlyWarning{ OptionsGeneral, L"ShowDeletePermanentlyWarning", true };
     inline static Setting<bool> ShowDeleteToRecycleBinWarning{ OptionsGeneral, L"ShowDeleteToRecycleBinWarning", true };
     inline static Setting<bool> ShowElevationPrompt{ OptionsGeneral, L"ShowElevationPrompt", true };
@@ -275,6 +282,8 @@ public:
     inline static Setting<int> LanguageId{ OptionsGeneral, L"LanguageId", 0 };
     inline static Setting<int> ProcessPriority{ OptionsGeneral, L"ProcessPriority", NORMAL, LOW, HIGH };
     inline static Setting<int> FileHashAlgorithm{ OptionsGeneral, L"FileHashAlgorithm", HASH_XXHASH, HASH_MD5, HASH_XXHASH };
+    inline static Setting<bool> ParallelLargeFileHash{ OptionsGeneral, L"ParallelLargeFileHash", true };
+    inline static Setting<int> HashReadQueueDepth{ OptionsGeneral, L"HashReadQueueDepth", 4, 1, 64 };
     inline static Setting<int> LargeFileCount{ OptionsGeneral, L"LargeFileCount", 50, 0, 10000 };
     inline static Setting<int> MinimizeViewThreshold{ OptionsGeneral, L"MinimizeViewThreshold", 10, 1, 10000 };
     inline static Setting<int> ScanningThreads{ OptionsGeneral, L"ScanningThreads", 4, 1, 16 };
@@ -0,0 +1,155 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "OverlappedReader.h"
+
+COverlappedReader::COverlappedReader(const std::wstring& path, const ULONGLONG offset,
+    const ULONGLONG length, const ULONG depth, const bool unbuffered, const DWORD ownerThread) : m_nextOffset(offset)
+{
+    constexpr DWORD shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    m_file = CreateFile(path.c_str(), GENERIC_READ, shareMode, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (!m_file.IsValid()) return;
+
+    // Never issue reads past the current end of file
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(m_file, &fileSize))
+    {
+        m_file.Release();
+        return;
+    }
+    const ULONGLONG size = static_cast<ULONGLONG>(fileSize.QuadPart);
+    m_endOffset = offset >= size ? offset : offset + std::min(length, size - offset);
+
+    // Bypass the file cache only when every read can start and end on a sector boundary
+    if (FILE_STORAGE_INFO storage{}; unbuffered &&
+        GetFileInformationByHandleEx(m_file, FileStorageInfo, &storage, sizeof(storage)))
+    {
+        const ULONG sector = std::max(storage.LogicalBytesPerSector, storage.PhysicalBytesPerSectorForPerformance);
+        if (std::has_single_bit(sector) && sector <= BUFFER_SIZE && offset % sector == 0)
+        {
+            if (const HANDLE reopened = ReOpenFile(m_file, GENERIC_READ, shareMode,
+                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING);
+                reopened != INVALID_HANDLE_VALUE)
+            {
+                m_file = reopened;
+                m_sectorSize = sector;
+            }
+        }
+    }
+
+    // Page aligned buffers satisfy the memory alignment unbuffered reads need
+    const size_t requestCount = static_cast<size_t>(std::clamp<ULONGLONG>(
+        std::min<ULONGLONG>(depth, (m_endOffset - offset + BUFFER_SIZE - 1) / BUFFER_SIZE), 1, 64));
+    m_buffers = static_cast<BYTE*>(VirtualAlloc(nullptr, requestCount * BUFFER_SIZE,
+        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (m_buffers == nullptr) return;
+
+    m_requests = std::vector<Request>(requestCount);
+    for (size_t i = 0; i < requestCount; i++)
+    {
+        m_requests[i].buffer = m_buffers + i * BUFFER_SIZE;
+        m_requests[i].event = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        if (!m_requests[i].event.IsValid())
+        {
+            VirtualFree(m_buffers, 0, MEM_RELEASE);
+            m_buffers = nullptr;
+            return;
+        }
+    }
+
+    RegisterThreadIo(m_file, ownerThread);
+    m_registered = true;
+    for (auto& request : m_requests) Issue(request);
+}
+
+COverlappedReader::~COverlappedReader()
+{
+    // Outstanding reads must finish before their buffers are released
+    if (m_registered) UnregisterThreadIo(m_file);
+    if (m_file.IsValid())
+    {
+        CancelIoEx(m_file, nullptr);
+        for (auto& request : m_requests)
+        {
+            DWORD bytesRead = 0;
+            if (request.pending) GetOverlappedResult(m_file, &request.overlapped, &bytesRead, TRUE);
+        }
+    }
+
+    if (m_buffers != nullptr) VirtualFree(m_buffers, 0, MEM_RELEASE);
+}
+
+void COverlappedReader::Issue(Request& request)
+{
+    request.pending = false;
+    request.error = ERROR_SUCCESS;
+    if (m_nextOffset >= m_endOffset)
+    {
+        request.error = ERROR_HANDLE_EOF;
+        return;
+    }
+
+    // The final read is rounded up to a whole sector; the excess is trimmed on completion
+    const ULONGLONG remaining = m_endOffset - m_nextOffset;
+    const ULONG readSize = remaining >= BUFFER_SIZE ? BUFFER_SIZE :
+        static_cast<ULONG>((remaining + m_sectorSize - 1) / m_sectorSize * m_sectorSize);
+
+    request.offset = m_nextOffset;
+    request.overlapped = {};
+    request.overlapped.Offset = static_cast<DWORD>(request.offset);
+    request.overlapped.OffsetHigh = static_cast<DWORD>(request.offset >> 32);
+    request.overlapped.hEvent = request.event;
+    m_nextOffset += readSize;
+
+    if (ReadFile(m_file, request.buffer, readSize, nullptr, &request.overlapped) ||
+        GetLastError() == ERROR_IO_PENDING) request.pending = true;
+    else request.error = GetLastError();
+}
+
+HRESULT COverlappedReader::Next(std::span<const BYTE>& data)
+{
+    data = {};
+
+    // The buffer handed out last time is free again so it can take the next range
+    if (m_reissueHead)
+    {
+        Issue(m_requests[m_head]);
+        m_head = (m_head + 1) % m_requests.size();
+        m_reissueHead = false;
+    }
+
+    Request& request = m_requests[m_head];
+    if (!request.pending)
+    {
+        return request.error == ERROR_HANDLE_EOF ? S_OK : HRESULT_FROM_WIN32(request.error);
+    }
+
+    DWORD bytesRead = 0;
+    request.pending = false;
+    if (!GetOverlappedResult(m_file, &request.overlapped, &bytesRead, TRUE))
+    {
+        request.error = GetLastError();
+        if (request.error != ERROR_HANDLE_EOF) return HRESULT_FROM_WIN32(request.error);
+        bytesRead = 0;
+    }
+
+    m_reissueHead = true;
+    data = { request.buffer, static_cast<size_t>(std::min<ULONGLONG>(bytesRead, m_endOffset - request.offset)) };
+    return S_OK;
+}
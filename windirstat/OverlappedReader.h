@@ -0,0 +1,72 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// COverlappedReader. Streams a range of a file through a ring of buffers with
+// several asynchronous reads in flight so the caller can hash one buffer while
+// the following ones are still being read. Unbuffered reads are used when
+// requested and the volume sector size allows them; otherwise reads go through
+// the file cache. Buffers are returned in file order. Reads are registered
+// against the owning thread so CancelThreadIo on that thread aborts them.
+//
+class COverlappedReader final
+{
+public:
+
+    static constexpr ULONG BUFFER_SIZE = wds::Mi;
+
+    COverlappedReader(const std::wstring& path, ULONGLONG offset, ULONGLONG length, ULONG depth, bool unbuffered,
+        DWORD ownerThread = GetCurrentThreadId());
+    ~COverlappedReader();
+
+    COverlappedReader(const COverlappedReader&) = delete;
+    COverlappedReader& operator=(const COverlappedReader&) = delete;
+
+    bool IsOpen() const noexcept { return m_file.IsValid() && m_buffers != nullptr; }
+
+    // Waits for the next buffer in file order; an empty span marks the end of the range.
+    // The returned data stays valid until the following call.
+    HRESULT Next(std::span<const BYTE>& data);
+
+private:
+
+    struct Request
+    {
+        OVERLAPPED overlapped{};
+        SmartPointer<HANDLE, decltype(&CloseHandle)> event{ CloseHandle, nullptr };
+        BYTE* buffer = nullptr;
+        ULONGLONG offset = 0;
+        bool pending = false;
+        DWORD error = ERROR_SUCCESS;
+    };
+
+    void Issue(Request& request);
+
+    SmartPointer<HANDLE, decltype(&CloseHandle)> m_file{ CloseHandle, INVALID_HANDLE_VALUE };
+    std::vector<Request> m_requests;
+    BYTE* m_buffers = nullptr;
+    ULONGLONG m_nextOffset = 0;
+    ULONGLONG m_endOffset = 0;
+    ULONG m_sectorSize = 1;
+    size_t m_head = 0;
+    bool m_reissueHead = false;
+    bool m_registered = false;
+};
@@ -137,7 +137,11 @@ void CPageFiltering::OnOK()
     COptions::FilteringIncludeDirs.Obj() = filteringIncludeDirs;
     CFiltering::CompileFilters();
 
-    if (m_refreshOnFilteringChange && refreshAll)
+    if (m_refreshOnFilteringChange && refreshAll && CWinDirStatModel::Get()->CanApplyFilterView())
+    {
+        CWinDirStatModel::Get()->ApplyFilterView();
+    }
+    else if (m_refreshOnFilteringChange && refreshAll)
     {
         CWinDirStatModel::Get()->StartScan(
             CWinDirStatModel::Get()->GetScanPathSpec());
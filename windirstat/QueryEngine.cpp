@@ -0,0 +1,813 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pch.h"
+#include "QueryEngine.h"
+#include "Filtering.h"
+
+namespace
+{
+    constexpr ULONGLONG TICKS_PER_DAY = 24ull * 60 * 60 * 10'000'000;
+
+    const std::unordered_map<std::wstring_view, ULONGLONG> sizeUnits =
+    {
+        { L"b", 1 },
+        { L"k", wds::Ki }, { L"kb", wds::Ki }, { L"kib", wds::Ki },
+        { L"m", wds::Mi }, { L"mb", wds::Mi }, { L"mib", wds::Mi },
+        { L"g", wds::Gi }, { L"gb", wds::Gi }, { L"gib", wds::Gi },
+        { L"t", wds::Ti }, { L"tb", wds::Ti }, { L"tib", wds::Ti }
+    };
+
+    const std::unordered_map<std::wstring_view, ULONGLONG> ageUnits =
+    {
+        { L"h", TICKS_PER_DAY / 24 }, { L"hour", TICKS_PER_DAY / 24 }, { L"hours", TICKS_PER_DAY / 24 },
+        { L"d", TICKS_PER_DAY }, { L"day", TICKS_PER_DAY }, { L"days", TICKS_PER_DAY },
+        { L"w", TICKS_PER_DAY * 7 }, { L"week", TICKS_PER_DAY * 7 }, { L"weeks", TICKS_PER_DAY * 7 },
+        { L"mo", TICKS_PER_DAY * 30 }, { L"month", TICKS_PER_DAY * 30 }, { L"months", TICKS_PER_DAY * 30 },
+        { L"y", TICKS_PER_DAY * 365 }, { L"year", TICKS_PER_DAY * 365 }, { L"years", TICKS_PER_DAY * 365 }
+    };
+
+    const std::unordered_map<std::wstring_view, ITEMTYPE> itemTypes =
+    {
+        { L"file", IT_FILE }, { L"files", IT_FILE },
+        { L"folder", IT_DIRECTORY }, { L"folders", IT_DIRECTORY },
+        { L"drive", IT_DRIVE }, { L"drives", IT_DRIVE }
+    };
+}
+
+// Folds case exactly like the compiled globs so equality and set lookups agree with them
+static std::wstring_view FoldInto(const std::wstring_view text, std::wstring& buffer)
+{
+    buffer.resize(text.size());
+    std::ranges::transform(text, buffer.begin(), FoldCase);
+    return buffer;
+}
+
+static std::wstring Fold(const std::wstring_view text)
+{
+    std::wstring folded;
+    FoldInto(text, folded);
+    return folded;
+}
+
+CQueryEngine::CQueryEngine(const std::wstring_view query)
+{
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    m_now = std::bit_cast<ULONGLONG>(now);
+
+    // A query without conditions matches every item, which is useful with grouping
+    Expression expression;
+    bool parsed = Tokenize(query);
+    const bool hasConditions = parsed && Peek() != nullptr && !PeekWord(L"group") && !PeekWord(L"limit");
+    if (hasConditions) parsed = ParseOr(expression);
+
+    while (parsed && Peek() != nullptr)
+    {
+        if (PeekWord(L"group"))
+        {
+            static const std::unordered_map<std::wstring_view, GroupBy> keys =
+            {
+                { L"ext", GroupBy::Extension }, { L"extension", GroupBy::Extension }, { L"owner", GroupBy::Owner },
+                { L"depth", GroupBy::Depth }, { L"type", GroupBy::Type }, { L"year", GroupBy::Year },
+                { L"folder", GroupBy::Folder }
+            };
+
+            m_position++;
+            if (!PeekWord(L"by"))
+            {
+                parsed = Fail(L"Expected \"by\"", Peek());
+                continue;
+            }
+
+            m_position++;
+            const Token* token = Peek();
+            const auto key = token != nullptr && !token->symbol ? keys.find(Fold(token->text)) : keys.end();
+            if (key == keys.end()) parsed = Fail(L"Unknown grouping", token);
+            else
+            {
+                m_groupBy = key->second;
+                m_position++;
+            }
+        }
+        else if (PeekWord(L"limit"))
+        {
+            m_position++;
+            ULONGLONG limit = 0;
+            parsed = ParseNumber(limit, false);
+            m_limit = static_cast<size_t>(limit);
+        }
+        else parsed = Fail(L"Unexpected text", Peek());
+    }
+
+    if (parsed && hasConditions) Emit(expression);
+    m_tokens = {};
+    if (!parsed) m_nodes.clear();
+}
+
+bool CQueryEngine::Tokenize(const std::wstring_view query)
+{
+    constexpr std::wstring_view symbols = L"(){},<>=!";
+    for (size_t i = 0; i < query.size();)
+    {
+        const wchar_t c = query[i];
+        if (iswspace(c))
+        {
+            i++;
+        }
+        else if (c == L'"')
+        {
+            const size_t end = query.find(L'"', i + 1);
+            if (end == std::wstring_view::npos) return Fail(L"Unterminated quote");
+            m_tokens.push_back({ std::wstring(query.substr(i + 1, end - i - 1)), false, true });
+            i = end + 1;
+        }
+        else if (symbols.find(c) != std::wstring_view::npos)
+        {
+            // Comparisons may be two characters long: <=, >=, == and !=
+            const size_t length = i + 1 < query.size() && query[i + 1] == L'=' &&
+                std::wstring_view(L"<>=!").find(c) != std::wstring_view::npos ? 2 : 1;
+            m_tokens.push_back({ std::wstring(query.substr(i, length)), true });
+            i += length;
+        }
+        else
+        {
+            size_t end = i;
+            while (end < query.size() && !iswspace(query[end]) && query[end] != L'"' && symbols.find(query[end]) == std::wstring_view::npos) end++;
+            m_tokens.push_back({ std::wstring(query.substr(i, end - i)) });
+            i = end;
+        }
+    }
+    return true;
+}
+
+bool CQueryEngine::PeekWord(const std::wstring_view word) const
+{
+    const Token* token = Peek();
+    return token != nullptr && !token->symbol && !token->quoted &&
+        token->text.size() == word.size() && _wcsnicmp(token->text.c_str(), word.data(), word.size()) == 0;
+}
+
+bool CQueryEngine::PeekSymbol(const std::wstring_view symbol) const
+{
+    const Token* token = Peek();
+    return token != nullptr && token->symbol && token->text == symbol;
+}
+
+const CQueryEngine::Token* CQueryEngine::TakeValue()
+{
+    const Token* token = Peek();
+    if (token == nullptr || token->symbol)
+    {
+        Fail(L"Expected a value", token);
+        return nullptr;
+    }
+    m_position++;
+    return token;
+}
+
+bool CQueryEngine::Fail(const std::wstring_view message, const Token* token)
+{
+    // Only the first problem is reported since later ones tend to follow from it
+    if (m_error.empty())
+    {
+        m_error = token == nullptr ? std::format(L"{} at end of query", message) :
+            std::format(L"{} at \"{}\"", message, token->text);
+    }
+    return false;
+}
+
+bool CQueryEngine::ParseOr(Expression& expression)
+{
+    std::vector<Expression> operands(1);
+    if (!ParseAnd(operands.back())) return false;
+    while (PeekWord(L"or"))
+    {
+        m_position++;
+        if (!ParseAnd(operands.emplace_back())) return false;
+    }
+
+    Combine(Op::Or, std::move(operands), expression);
+    return true;
+}
+
+bool CQueryEngine::ParseAnd(Expression& expression)
+{
+    std::vector<Expression> operands(1);
+    if (!ParseUnary(operands.back())) return false;
+    while (PeekWord(L"and") || PeekSymbol(L","))
+    {
+        m_position++;
+        if (!ParseUnary(operands.emplace_back())) return false;
+    }
+
+    Combine(Op::And, std::move(operands), expression);
+    return true;
+}
+
+bool CQueryEngine::ParseUnary(Expression& expression)
+{
+    if (PeekWord(L"not"))
+    {
+        m_position++;
+        std::vector<Expression> operands(1);
+        if (!ParseUnary(operands.back())) return false;
+        expression = { { Op::Not }, operands.back().cost, std::move(operands) };
+        return true;
+    }
+
+    if (PeekSymbol(L"("))
+    {
+        m_position++;
+        if (!ParseOr(expression)) return false;
+        if (!PeekSymbol(L")")) return Fail(L"Expected \")\"", Peek());
+        m_position++;
+        return true;
+    }
+
+    return ParseCondition(expression);
+}
+
+bool CQueryEngine::ParseCondition(Expression& expression)
+{
+    static const std::unordered_map<std::wstring_view, Field> fields =
+    {
+        { L"size", Field::SizeLogical }, { L"physical", Field::SizePhysical }, { L"modified", Field::Modified },
+        { L"age", Field::Modified }, { L"depth", Field::Depth }, { L"name", Field::Name },
+        { L"ext", Field::Extension }, { L"extension", Field::Extension }, { L"path", Field::Path },
+        { L"owner", Field::Owner }, { L"attr", Field::Attributes }, { L"attributes", Field::Attributes },
+        { L"type", Field::Type }
+    };
+
+    const Token* token = Peek();
+    if (token == nullptr || token->symbol || token->quoted) return Fail(L"Expected a condition", token);
+    m_position++;
+    const std::wstring word = Fold(token->text);
+
+    // Item types may stand on their own
+    if (const auto type = itemTypes.find(word); type != itemTypes.end())
+    {
+        expression.node = { Op::IsType, Field::Type, Comparison::Equal, 0, type->second };
+        return true;
+    }
+
+    const auto found = fields.find(word);
+    if (found == fields.end()) return Fail(L"Unknown field", token);
+    const Field field = found->second;
+    Node& node = expression.node;
+    node.field = field;
+
+    switch (field)
+    {
+    case Field::SizeLogical:
+    case Field::SizePhysical:
+    case Field::Depth:
+        node.op = Op::Compare;
+        return ParseComparison(node.comparison) && ParseNumber(node.value, field != Field::Depth);
+
+    case Field::Modified:
+    {
+        node.op = Op::Compare;
+        if (!ParseComparison(node.comparison)) return false;
+        if (node.comparison == Comparison::Equal || node.comparison == Comparison::NotEqual)
+        {
+            return Fail(L"Times only compare with <, <=, > or >=", token);
+        }
+        if (word != L"age") return ParseDate(node.value);
+
+        // An age counts back from now so it compares the other way round
+        ULONGLONG ticks = 0;
+        if (!ParseAge(ticks)) return false;
+        node.value = m_now > ticks ? m_now - ticks : 0;
+        constexpr std::array flipped = { Comparison::Equal, Comparison::NotEqual, Comparison::Greater,
+            Comparison::GreaterEqual, Comparison::Less, Comparison::LessEqual };
+        node.comparison = flipped[static_cast<size_t>(node.comparison)];
+        return true;
+    }
+
+    case Field::Attributes:
+    {
+        if (!PeekWord(L"has")) return Fail(L"Expected \"has\"", Peek());
+        m_position++;
+        const Token* letters = TakeValue();
+        if (letters == nullptr) return false;
+
+        node.op = Op::HasAttributes;
+        for (const wchar_t letter : letters->text)
+        {
+            switch (towupper(letter))
+            {
+            case wds::chrAttributeReadonly: node.value |= FILE_ATTRIBUTE_READONLY; break;
+            case wds::chrAttributeHidden: node.value |= FILE_ATTRIBUTE_HIDDEN; break;
+            case wds::chrAttributeSystem: node.value |= FILE_ATTRIBUTE_SYSTEM; break;
+            case wds::chrAttributeArchive: node.value |= FILE_ATTRIBUTE_ARCHIVE; break;
+            case wds::chrAttributeCompressed: node.value |= FILE_ATTRIBUTE_COMPRESSED; break;
+            case wds::chrAttributeEncrypted: node.value |= FILE_ATTRIBUTE_ENCRYPTED; break;
+            case wds::chrAttributeOffline: node.value |= FILE_ATTRIBUTE_OFFLINE; break;
+            case wds::chrAttributeSparse: node.value |= FILE_ATTRIBUTE_SPARSE_FILE; break;
+            default: return Fail(L"Unknown attribute", letters);
+            }
+        }
+        return true;
+    }
+
+    case Field::Type:
+    {
+        Comparison comparison;
+        if (!ParseComparison(comparison)) return false;
+        const Token* value = TakeValue();
+        if (value == nullptr) return false;
+        const auto type = itemTypes.find(Fold(value->text));
+        if (type == itemTypes.end()) return Fail(L"Unknown type", value);
+        if (comparison != Comparison::Equal && comparison != Comparison::NotEqual) return Fail(L"Types only compare with = or !=", value);
+
+        std::vector<Expression> operands(1);
+        operands.back().node = { Op::IsType, Field::Type, Comparison::Equal, 0, type->second };
+        if (comparison == Comparison::Equal) expression = std::move(operands.back());
+        else expression = { { Op::Not }, 0, std::move(operands) };
+        return true;
+    }
+
+    default:
+        break;
+    }
+
+    // Names, extensions, paths and owners
+    expression.cost = field == Field::Owner ? 3 : field == Field::Path ? 2 : 1;
+    if (PeekWord(L"in"))
+    {
+        m_position++;
+        std::vector<std::wstring> values;
+        if (!ParseStringSet(values)) return false;
+
+        node.op = Op::InSet;
+        node.value = m_sets.size();
+        auto& set = m_sets.emplace_back();
+        for (const auto& value : values)
+        {
+            set.emplace(Fold(field == Field::Extension && value.starts_with(L'.') ? value.substr(1) : value));
+        }
+        return true;
+    }
+
+    if (PeekWord(L"like") || PeekWord(L"under"))
+    {
+        const bool under = PeekWord(L"under");
+        m_position++;
+        const Token* pattern = TakeValue();
+        if (pattern == nullptr) return false;
+
+        if (!under)
+        {
+            node.op = Op::Like;
+            node.value = field == Field::Path ? AddPathGlob(m_globs, pattern->text) :
+                (m_globs.emplace_back(pattern->text), m_globs.size() - 1);
+            return true;
+        }
+
+        // Items under a folder are told apart by the scope their parent hands down
+        if (field != Field::Path) return Fail(L"Only paths can be matched with \"under\"", token);
+        if (m_under.size() == MAX_PATH_SCOPES) return Fail(L"Too many \"under\" conditions", pattern);
+        node.op = Op::Under;
+        node.value = AddPathGlob(m_under, pattern->text);
+        expression.cost = 0;
+        return true;
+    }
+
+    node.op = Op::Compare;
+    if (!ParseComparison(node.comparison)) return false;
+    if (node.comparison != Comparison::Equal && node.comparison != Comparison::NotEqual)
+    {
+        return Fail(L"Text only compares with = or !=", token);
+    }
+
+    const Token* value = TakeValue();
+    if (value == nullptr) return false;
+    node.value = m_strings.size();
+    m_strings.emplace_back(Fold(field == Field::Extension && value->text.starts_with(L'.') ?
+        std::wstring_view(value->text).substr(1) : std::wstring_view(value->text)));
+    return true;
+}
+
+bool CQueryEngine::ParseComparison(Comparison& comparison)
+{
+    static const std::unordered_map<std::wstring_view, Comparison> comparisons =
+    {
+        { L"=", Comparison::Equal }, { L"==", Comparison::Equal }, { L"!=", Comparison::NotEqual },
+        { L"<", Comparison::Less }, { L"<=", Comparison::LessEqual },
+        { L">", Comparison::Greater }, { L">=", Comparison::GreaterEqual }
+    };
+
+    const Token* token = Peek();
+    const auto found = token != nullptr && token->symbol ? comparisons.find(token->text) : comparisons.end();
+    if (found == comparisons.end()) return Fail(L"Expected a comparison", token);
+    m_position++;
+    comparison = found->second;
+    return true;
+}
+
+bool CQueryEngine::ParseNumber(ULONGLONG& number, const bool allowUnits)
+{
+    const Token* token = TakeValue();
+    if (token == nullptr) return false;
+
+    wchar_t* end = nullptr;
+    const double value = std::wcstod(token->text.c_str(), &end);
+    if (end == token->text.c_str() || !(value >= 0)) return Fail(L"Expected a number", token);
+
+    // The unit may follow the number directly or as the next word
+    std::wstring unit = Fold(end);
+    if (const Token* next = Peek(); unit.empty() && allowUnits && next != nullptr && !next->symbol &&
+        sizeUnits.contains(Fold(next->text)))
+    {
+        unit = Fold(next->text);
+        m_position++;
+    }
+
+    ULONGLONG scale = 1;
+    if (!unit.empty())
+    {
+        const auto found = allowUnits ? sizeUnits.find(unit) : sizeUnits.end();
+        if (found == sizeUnits.end()) return Fail(L"Unknown unit", token);
+        scale = found->second;
+    }
+
+    const double scaled = value * static_cast<double>(scale);
+    if (scaled >= 18e18) return Fail(L"Number out of range", token);
+    number = static_cast<ULONGLONG>(std::llround(scaled));
+    return true;
+}
+
+bool CQueryEngine::ParseAge(ULONGLONG& ticks)
+{
+    const Token* token = TakeValue();
+    if (token == nullptr) return false;
+
+    wchar_t* end = nullptr;
+    const double value = std::wcstod(token->text.c_str(), &end);
+    if (end == token->text.c_str() || !(value >= 0)) return Fail(L"Expected an age like 30d or 2y", token);
+
+    // Ages without a unit are in days
+    std::wstring unit = Fold(end);
+    if (const Token* next = Peek(); unit.empty() && next != nullptr && !next->symbol && ageUnits.contains(Fold(next->text)))
+    {
+        unit = Fold(next->text);
+        m_position++;
+    }
+
+    const auto found = unit.empty() ? ageUnits.find(L"d") : ageUnits.find(unit);
+    if (found == ageUnits.end()) return Fail(L"Unknown unit", token);
+
+    const double scaled = value * static_cast<double>(found->second);
+    ticks = scaled >= static_cast<double>(m_now) ? m_now : static_cast<ULONGLONG>(scaled);
+    return true;
+}
+
+bool CQueryEngine::ParseDate(ULONGLONG& fileTime)
+{
+    const Token* token = TakeValue();
+    if (token == nullptr) return false;
+
+    // Same form as exported times, in UTC; the time of day is optional
+    SYSTEMTIME utc = {};
+    FILETIME converted = {};
+    if (swscanf_s(token->text.c_str(), L"%4hu-%2hu-%2huT%2hu:%2hu:%2hu",
+        &utc.wYear, &utc.wMonth, &utc.wDay, &utc.wHour, &utc.wMinute, &utc.wSecond) < 3 ||
+        !SystemTimeToFileTime(&utc, &converted)) return Fail(L"Expected a date like 2024-12-31", token);
+
+    fileTime = std::bit_cast<ULONGLONG>(converted);
+    return true;
+}
+
+bool CQueryEngine::ParseStringSet(std::vector<std::wstring>& values)
+{
+    if (!PeekSymbol(L"{")) return Fail(L"Expected \"{\"", Peek());
+    m_position++;
+
+    for (;;)
+    {
+        const Token* value = TakeValue();
+        if (value == nullptr) return false;
+        values.push_back(value->text);
+
+        if (PeekSymbol(L"}"))
+        {
+            m_position++;
+            return true;
+        }
+        if (!PeekSymbol(L",")) return Fail(L"Expected \",\" or \"}\"", Peek());
+        m_position++;
+    }
+}
+
+size_t CQueryEngine::AddPathGlob(std::vector<CGlobMatcher>& globs, const std::wstring_view pattern)
+{
+    // Paths are matched whole; a leading backslash stands for the root of any drive
+    std::wstring glob(CFiltering::WithoutTrailingBackslashes(pattern));
+    if (glob.starts_with(L'\\') && !glob.starts_with(L"\\\\")) glob.insert(0, L"?:");
+    globs.emplace_back(glob);
+    return globs.size() - 1;
+}
+
+void CQueryEngine::Combine(const Op op, std::vector<Expression>&& operands, Expression& expression)
+{
+    if (operands.size() == 1)
+    {
+        expression = std::move(operands.front());
+        return;
+    }
+
+    expression = { { op } };
+    for (auto& operand : operands)
+    {
+        // Parenthesized runs of the same connective join this one
+        if (operand.node.op == op && !operand.operands.empty())
+        {
+            std::ranges::move(operand.operands, std::back_inserter(expression.operands));
+        }
+        else expression.operands.push_back(std::move(operand));
+    }
+
+    // Cheap conditions go first so costly ones only run when they can still change the outcome
+    std::ranges::stable_sort(expression.operands, {}, &Expression::cost);
+    expression.cost = expression.operands.back().cost;
+}
+
+void CQueryEngine::Emit(const Expression& expression)
+{
+    const size_t index = m_nodes.size();
+    m_nodes.push_back(expression.node);
+    for (const auto& operand : expression.operands) Emit(operand);
+    m_nodes[index].end = static_cast<ULONG>(m_nodes.size());
+}
+
+bool CQueryEngine::Descends(const CItem* item)
+{
+    return !item->IsLeaf() && !item->IsTypeOrFlag(IT_HLINKS);
+}
+
+void CQueryEngine::Add(Aggregate& aggregate, const Aggregate& other)
+{
+    aggregate.items += other.items;
+    aggregate.sizeLogical += other.sizeLogical;
+    aggregate.sizePhysical += other.sizePhysical;
+    if (CompareFileTime(&other.newest, &aggregate.newest) > 0) aggregate.newest = other.newest;
+}
+
+CQueryEngine::Scope CQueryEngine::Enter(const CItem* item, const Scope* parent, Worker& worker) const
+{
+    Scope scope;
+    if (parent != nullptr)
+    {
+        scope.depth = parent->depth + 1;
+        scope.groupsAbove = parent->groupsAbove;
+    }
+
+    // Drives and the query root start from their whole path; everything else only adds its name
+    const bool rooted = parent == nullptr || item->IsTypeOrFlag(IT_DRIVE);
+    for (size_t i = 0; i < m_under.size(); i++)
+    {
+        const CGlobMatcher& glob = m_under[i];
+        size_t& state = scope.under[i];
+        if (parent != nullptr && parent->under[i] == UNDER_MATCHED) state = UNDER_MATCHED;
+        else if (rooted)
+        {
+            const auto path = GetText(Field::Path, item, worker);
+            state = glob.MatchesPathOrAncestor(path) ? UNDER_MATCHED : glob.Advance(0, L'\0', path);
+        }
+        else if (parent->under[i] == CGlobMatcher::NO_MATCH) state = CGlobMatcher::NO_MATCH;
+        else state = glob.Advance(parent->under[i], L'\\', item->GetNameView());
+
+        if (state != CGlobMatcher::NO_MATCH && glob.IsComplete(state)) state = UNDER_MATCHED;
+    }
+    return scope;
+}
+
+std::wstring_view CQueryEngine::GetText(const Field field, const CItem* item, Worker& worker)
+{
+    switch (field)
+    {
+    case Field::Extension:
+    {
+        if (!item->IsTypeOrFlag(IT_FILE)) return {};
+        const auto name = item->GetNameView();
+        const size_t dot = name.rfind(L'.');
+        return dot == std::wstring_view::npos ? std::wstring_view{} : name.substr(dot + 1);
+    }
+    case Field::Path:
+        return CFiltering::WithoutTrailingBackslashes(worker.paths.Get(item));
+    case Field::Owner:
+        worker.text = item->GetOwner(true);
+        return worker.text;
+    default:
+        return item->GetNameView();
+    }
+}
+
+std::wstring_view CQueryEngine::GetGroupKey(const CItem* item, const Scope& scope, Worker& worker) const
+{
+    switch (m_groupBy)
+    {
+    case GroupBy::Extension:
+        return FoldInto(GetText(Field::Extension, item, worker), worker.folded);
+    case GroupBy::Owner:
+        return GetText(Field::Owner, item, worker);
+    case GroupBy::Depth:
+        worker.text = std::to_wstring(scope.depth);
+        return worker.text;
+    case GroupBy::Type:
+        return item->IsTypeOrFlag(IT_FILE) ? L"file" : item->IsTypeOrFlag(IT_DRIVE) ? L"drive" : L"folder";
+    case GroupBy::Year:
+    {
+        SYSTEMTIME utc = {};
+        const FILETIME lastChange = item->GetLastChange();
+        FileTimeToSystemTime(&lastChange, &utc);
+        worker.text = std::to_wstring(utc.wYear);
+        return worker.text;
+    }
+    default:
+        return item->GetParent() == nullptr ? std::wstring_view{} : GetText(Field::Path, item->GetParent(), worker);
+    }
+}
+
+bool CQueryEngine::Evaluate(const ULONG index, const CItem* item, const Scope& scope, Worker& worker) const
+{
+    const Node& node = m_nodes[index];
+    switch (node.op)
+    {
+    case Op::And:
+        for (ULONG operand = index + 1; operand < node.end; operand = m_nodes[operand].end)
+        {
+            if (!Evaluate(operand, item, scope, worker)) return false;
+        }
+        return true;
+    case Op::Or:
+        for (ULONG operand = index + 1; operand < node.end; operand = m_nodes[operand].end)
+        {
+            if (Evaluate(operand, item, scope, worker)) return true;
+        }
+        return false;
+    case Op::Not:
+        return !Evaluate(index + 1, item, scope, worker);
+    case Op::Like:
+        return m_globs[node.value].Matches(GetText(node.field, item, worker));
+    case Op::InSet:
+        return m_sets[node.value].contains(FoldInto(GetText(node.field, item, worker), worker.folded));
+    case Op::Under:
+        return scope.under[node.value] == UNDER_MATCHED;
+    case Op::HasAttributes:
+        return (item->GetAttributes() & node.value) == node.value;
+    case Op::IsType:
+        return item->IsTypeOrFlag(static_cast<ITEMTYPE>(node.value));
+    case Op::Compare:
+        break;
+    }
+
+    if (node.field == Field::Name || node.field == Field::Extension || node.field == Field::Path || node.field == Field::Owner)
+    {
+        const bool equal = FoldInto(GetText(node.field, item, worker), worker.folded) == m_strings[node.value];
+        return equal == (node.comparison == Comparison::Equal);
+    }
+
+    const ULONGLONG value =
+        node.field == Field::SizeLogical ? item->GetSizeLogical() :
+        node.field == Field::SizePhysical ? item->GetSizePhysical() :
+        node.field == Field::Modified ? std::bit_cast<ULONGLONG>(item->GetLastChange()) : scope.depth;
+    switch (node.comparison)
+    {
+    case Comparison::Equal: return value == node.value;
+    case Comparison::NotEqual: return value != node.value;
+    case Comparison::Less: return value < node.value;
+    case Comparison::LessEqual: return value <= node.value;
+    case Comparison::Greater: return value > node.value;
+    default: return value >= node.value;
+    }
+}
+
+void CQueryEngine::Record(const CItem* item, Scope& scope, Worker& worker) const
+{
+    // Pseudo items such as free space are walked past but never reported
+    if (!item->IsTypeOrFlag(IT_FILE, IT_DIRECTORY, IT_DRIVE)) return;
+    worker.visited++;
+    if (!m_nodes.empty() && !Evaluate(0, item, scope, worker)) return;
+
+    worker.matched++;
+    if (m_groupBy == GroupBy::None)
+    {
+        worker.matches.Push(item);
+        return;
+    }
+
+    // The size of a match below another match is already part of the outer one, so a group
+    // skips it when any match above falls in the same group; map nodes never move and are not
+    // touched while other threads read them
+    const Aggregate sized{ 1, item->GetSizeLogical(), item->GetSizePhysical(), item->GetLastChange() };
+    const Aggregate counted{ 1, 0, 0, item->GetLastChange() };
+    const auto key = GetGroupKey(item, scope, worker);
+    auto group = worker.groups.find(key);
+    if (group == worker.groups.end()) group = worker.groups.emplace(key, Aggregate{}).first;
+    bool sameGroup = false;
+    for (const GroupLink* link = scope.groupsAbove; link != nullptr && !sameGroup; link = link->above)
+    {
+        sameGroup = *link->key == key;
+    }
+    Add(group->second, sameGroup ? counted : sized);
+
+    // From here on the scope is the one handed down to the children
+    if (!sameGroup) scope.groupsAbove = &worker.groupLinks.emplace_back(GroupLink{ &group->first, scope.groupsAbove });
+}
+
+void CQueryEngine::Expand(const CItem* item, const Scope* parent, Worker& worker, std::vector<Unit>& pending) const
+{
+    Scope scope = Enter(item, parent, worker);
+    Record(item, scope, worker);
+    if (!Descends(item)) return;
+    for (const CItem* child : item->GetChildren()) pending.push_back({ child, scope });
+}
+
+CQueryEngine::Result CQueryEngine::Run(CItem* root) const
+{
+    const ULONGLONG start = GetTickCount64();
+    const int configuredThreads = COptions::SearchThreads;
+    const size_t threadCount = configuredThreads > 0 ?
+        configuredThreads : std::max(1u, std::thread::hardware_concurrency());
+
+    // Each thread keeps its own matches and totals; the extra worker belongs to this thread
+    std::vector<Worker> workers;
+    workers.reserve(threadCount + 1);
+    for (size_t i = 0; i <= threadCount; i++) workers.emplace_back(m_groupBy == GroupBy::None ? m_limit : 0);
+    Worker& local = workers.back();
+
+    // Split the tree level by level until every thread has plenty of subtrees to take
+    std::vector<Unit> units;
+    Expand(root, nullptr, local, units);
+    const auto descends = [](const Unit& unit) { return Descends(unit.item); };
+    for (std::vector<Unit> next; units.size() < threadCount * 16 && std::ranges::any_of(units, descends); units.swap(next))
+    {
+        next.clear();
+        for (const Unit& unit : units)
+        {
+            if (Descends(unit.item)) Expand(unit.item, &unit.parent, local, next);
+            else next.push_back(unit);
+        }
+    }
+
+    std::atomic<size_t> nextUnit = 0;
+    {
+        std::vector<std::jthread> threads;
+        for (size_t thread = 0; thread < threadCount; thread++) threads.emplace_back([&, thread]
+        {
+            std::vector<Unit> pending;
+            for (size_t unit; (unit = nextUnit++) < units.size();)
+            {
+                pending.assign(1, units[unit]);
+                while (!pending.empty())
+                {
+                    const Unit current = pending.back();
+                    pending.pop_back();
+                    Expand(current.item, &current.parent, workers[thread], pending);
+                }
+            }
+        });
+    }
+
+    for (auto& worker : workers | std::views::take(threadCount))
+    {
+        local.matches.Merge(std::move(worker.matches));
+        for (const auto& [key, aggregate] : worker.groups) Add(local.groups[key], aggregate);
+        local.matched += worker.matched;
+        local.visited += worker.visited;
+    }
+
+    Result result;
+    result.grouped = m_groupBy != GroupBy::None;
+    result.items = local.matches.Take();
+    result.groups.assign(local.groups.begin(), local.groups.end());
+    std::ranges::sort(result.groups, [](const auto& a, const auto& b)
+    {
+        if (a.second.sizePhysical != b.second.sizePhysical) return a.second.sizePhysical > b.second.sizePhysical;
+        return a.first < b.first;
+    });
+    if (result.groups.size() > m_limit) result.groups.erase(result.groups.begin() + m_limit, result.groups.end());
+    result.matched = local.matched;
+    result.visited = local.visited;
+    result.ticks = GetTickCount64() - start;
+
+    VTRACE(L"Query: {} of {} items matched on {} threads in {} ms, {} items/s", result.matched,
+        result.visited, threadCount, result.ticks, result.visited * 1000 / std::max(1ull, result.ticks));
+    return result;
+}
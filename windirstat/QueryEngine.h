@@ -0,0 +1,185 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+#include "BoundedHeap.h"
+#include "GlobMatcher.h"
+
+//
+// CQueryEngine. Predicate language over the scanned tree, for example:
+//
+//   file, size > 1 GB, age > 2y, ext in {bak, tmp}, path under \Projects\*
+//
+// Conditions on size, physical, modified, age, depth, name, ext, path, owner,
+// attr and type combine with "and" (or a comma), "or", "not" and parentheses,
+// optionally followed by "group by <ext|owner|depth|type|year|folder>" and
+// "limit <count>". The query is compiled once into a flat array with the
+// cheapest conditions of each connective first, and the tree is then walked
+// a single time on all cores. Path globs are resumed one name at a time like
+// the filters, so only path and owner conditions ever build a string.
+//
+class CQueryEngine final
+{
+public:
+
+    struct Aggregate
+    {
+        ULONGLONG items = 0;
+        ULONGLONG sizeLogical = 0;  // Matches inside another match are not counted again
+        ULONGLONG sizePhysical = 0;
+        FILETIME newest{};
+    };
+
+    struct Result
+    {
+        std::vector<const CItem*> items;                        // Matches when not grouped, physically largest first
+        std::vector<std::pair<std::wstring, Aggregate>> groups; // Physically largest first
+        ULONGLONG matched = 0;                                  // Before the limit is applied
+        bool grouped = false;
+        ULONGLONG visited = 0;
+        ULONGLONG ticks = 0;
+    };
+
+    explicit CQueryEngine(std::wstring_view query);
+
+    bool IsValid() const noexcept { return m_error.empty(); }
+    const std::wstring& GetError() const noexcept { return m_error; }
+
+    Result Run(CItem* root) const;
+
+private:
+
+    static constexpr size_t MAX_PATH_SCOPES = 8;
+    static constexpr size_t UNDER_MATCHED = CGlobMatcher::NO_MATCH - 1;
+
+    enum class Op : BYTE { And, Or, Not, Compare, Like, InSet, Under, HasAttributes, IsType };
+    enum class Field : BYTE { SizeLogical, SizePhysical, Modified, Depth, Name, Extension, Path, Owner, Attributes, Type };
+    enum class Comparison : BYTE { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+    enum class GroupBy : BYTE { None, Extension, Owner, Depth, Type, Year, Folder };
+
+    // Connectives are followed by their operands; every node records where its
+    // subtree ends so an operand that is not needed can be skipped
+    struct Node
+    {
+        Op op = Op::And;
+        Field field = Field::SizeLogical;
+        Comparison comparison = Comparison::Equal;
+        ULONG end = 0;
+        ULONGLONG value = 0; // Number, file time or mask, or the index of a string, glob or set
+    };
+
+    // Parsed form before flattening
+    struct Expression
+    {
+        Node node;
+        int cost = 0;
+        std::vector<Expression> operands;
+    };
+
+    struct Token
+    {
+        std::wstring text;
+        bool symbol = false;
+        bool quoted = false;
+    };
+
+    // A group key matched above an item, linked to the ones matched further up
+    struct GroupLink
+    {
+        const std::wstring* key;
+        const GroupLink* above;
+    };
+
+    // Where an item sits: its depth below the query root, per "under" glob how far
+    // its path has been matched so its children only add their names, and the
+    // distinct group keys of the matches above it
+    struct Scope
+    {
+        std::array<size_t, MAX_PATH_SCOPES> under{};
+        const GroupLink* groupsAbove = nullptr;
+        USHORT depth = 0;
+    };
+
+    // An item still to be visited with the scope of its parent
+    struct Unit
+    {
+        const CItem* item;
+        Scope parent;
+    };
+
+    // Matches are ranked by the physical size the rows report
+    using ItemHeap = CBoundedHeap<const CItem*, decltype(&CItem::GetSizePhysical)>;
+
+    struct Worker
+    {
+        explicit Worker(const size_t capacity) : matches(capacity, &CItem::GetSizePhysical) {}
+
+        ItemHeap matches;
+        std::unordered_map<std::wstring, Aggregate, string_hash, std::equal_to<>> groups;
+        std::deque<GroupLink> groupLinks; // Never move, so scopes handed to other threads stay valid
+        ULONGLONG matched = 0;
+        ULONGLONG visited = 0;
+        CItemPathBuilder paths;
+        std::wstring text;   // Owner or group key of the current item
+        std::wstring folded;
+    };
+
+    bool Tokenize(std::wstring_view query);
+    const Token* Peek() const noexcept { return m_position < m_tokens.size() ? &m_tokens[m_position] : nullptr; }
+    bool PeekWord(std::wstring_view word) const;
+    bool PeekSymbol(std::wstring_view symbol) const;
+    const Token* TakeValue();
+    bool Fail(std::wstring_view message, const Token* token = nullptr);
+
+    bool ParseOr(Expression& expression);
+    bool ParseAnd(Expression& expression);
+    bool ParseUnary(Expression& expression);
+    bool ParseCondition(Expression& expression);
+    bool ParseComparison(Comparison& comparison);
+    bool ParseNumber(ULONGLONG& number, bool allowUnits);
+    bool ParseAge(ULONGLONG& ticks);
+    bool ParseDate(ULONGLONG& fileTime);
+    bool ParseStringSet(std::vector<std::wstring>& values);
+    static size_t AddPathGlob(std::vector<CGlobMatcher>& globs, std::wstring_view pattern);
+    static void Combine(Op op, std::vector<Expression>&& operands, Expression& expression);
+    void Emit(const Expression& expression);
+
+    void Expand(const CItem* item, const Scope* parent, Worker& worker, std::vector<Unit>& pending) const;
+    Scope Enter(const CItem* item, const Scope* parent, Worker& worker) const;
+    void Record(const CItem* item, Scope& scope, Worker& worker) const;
+    bool Evaluate(ULONG index, const CItem* item, const Scope& scope, Worker& worker) const;
+    static std::wstring_view GetText(Field field, const CItem* item, Worker& worker);
+    std::wstring_view GetGroupKey(const CItem* item, const Scope& scope, Worker& worker) const;
+    static bool Descends(const CItem* item);
+    static void Add(Aggregate& aggregate, const Aggregate& other);
+
+    std::vector<Node> m_nodes;
+    std::vector<std::wstring> m_strings; // Folded
+    std::vector<CGlobMatcher> m_globs;
+    std::vector<CGlobMatcher> m_under;   // One scope slot each
+    std::vector<std::unordered_set<std::wstring, string_hash, std::equal_to<>>> m_sets; // Folded
+    GroupBy m_groupBy = GroupBy::None;
+    size_t m_limit = SIZE_MAX;
+    std::wstring m_error;
+
+    // Only used while compiling
+    std::vector<Token> m_tokens;
+    size_t m_position = 0;
+    ULONGLONG m_now = 0;
+};
@@ -0,0 +1,116 @@
+﻿// WinDirStat - Directory Statistics
+// Copyright © WinDirStat Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "pch.h"
+
+//
+// ReadScheduler. Orders content reads by their position on disk so a spinning
+// volume is swept in one direction instead of seeking back and forth for every
+// file. Requests are keyed by volume and the LCN of their first extent; each
+// volume is served in circular elevator order (C-SCAN) and volumes take turns.
+// Requests with no known location sort after everything else. Volumes pushed
+// as exclusive, such as rotational disks, hand out one request at a time until
+// it is released so concurrent readers cannot break up the sweep. SeekCost
+// gives a simple distance-based cost for an issue order so the ordering can be
+// evaluated without real hardware.
+//
+template <typename Volume, typename T>
+class ReadScheduler final
+{
+    struct VolumeQueue
+    {
+        std::multimap<LONGLONG, T> requests;
+        LONGLONG head = 0;
+        bool exclusive = false;
+    };
+
+    std::map<Volume, VolumeQueue> m_volumes;
+    std::set<Volume> m_busy; // Exclusive volumes with a request in flight
+    Volume m_lastVolume{};
+    size_t m_size = 0;
+
+public:
+    static constexpr LONGLONG UNKNOWN_LCN = std::numeric_limits<LONGLONG>::max();
+
+    void Push(const Volume& volume, const LONGLONG lcn, T value, const bool exclusive = false)
+    {
+        auto& queue = m_volumes[volume];
+        queue.requests.emplace(lcn, std::move(value));
+        queue.exclusive = exclusive;
+        m_size++;
+    }
+
+    // Returns nothing when every volume with work is exclusive and busy
+    std::optional<T> Pop()
+    {
+        if (m_size == 0) return std::nullopt;
+
+        // Rotate to the next available volume with work after the one served last
+        auto volume = m_volumes.upper_bound(m_lastVolume);
+        for (size_t tried = 0;; ++volume)
+        {
+            if (volume == m_volumes.end()) volume = m_volumes.begin();
+            if (!volume->second.exclusive || !m_busy.contains(volume->first)) break;
+            if (++tried == m_volumes.size()) return std::nullopt;
+        }
+        m_lastVolume = volume->first;
+        auto& [requests, head, exclusive] = volume->second;
+        if (exclusive) m_busy.insert(volume->first);
+
+        // Continue the sweep from the head, wrapping to the lowest position at the end
+        auto next = requests.lower_bound(head);
+        if (next == requests.end()) next = requests.begin();
+        head = next->first;
+
+        T value = std::move(next->second);
+        requests.erase(next);
+        if (requests.empty()) m_volumes.erase(volume);
+        m_size--;
+        return value;
+    }
+
+    // Lets the next request of an exclusive volume be handed out
+    void Release(const Volume& volume)
+    {
+        m_busy.erase(volume);
+    }
+
+    size_t Size() const noexcept { return m_size; }
+    bool Empty() const noexcept { return m_size == 0; }
+
+    void Clear() noexcept
+    {
+        m_volumes.clear();
+        m_busy.clear();
+        m_size = 0;
+    }
+
+    // Total head travel in clusters to service positions in the given order
+    static ULONGLONG SeekCost(const std::span<const LONGLONG> order, LONGLONG head = 0)
+    {
+        ULONGLONG cost = 0;
+        for (const LONGLONG lcn : order)
+        {
+            if (lcn == UNKNOWN_LCN) continue;
+            cost += static_cast<ULONGLONG>(lcn > head ? lcn - head : head - lcn);
+            head = lcn;
+        }
+        return cost;
+    }
+};
@@ -19,6 +19,7 @@
 #include "SelectDrivesDlg.h"
 #include "AboutDlg.h"
 #include "CsvLoader.h"
+#include "QueryEngine.h"
 #include "FinderMtp.h"
 
 CIconHandler* GetIconHandler()
@@ -156,6 +157,13 @@ std::wstring CDirStatApp::GetCurrentProcessMemoryInfo()
         return wds::strEmpty;
     }
 
+    // Show what tearing down earlier scans gave back once there is something to show
+    if (const auto* model = CWinDirStatModel::Get(); model != nullptr && model->GetTeardownBytesReleased() > 0)
+    {
+        return Localization::Format(IDS_RAMUSAGEs_RELEASEDs, FormatBytes(pmc.WorkingSetSize),
+            FormatBytes(model->GetTeardownBytesReleased()));
+    }
+
     return Localization::Format(IDS_RAMUSAGEs, FormatBytes(pmc.WorkingSetSize));
 }
 
@@ -205,9 +213,14 @@ class CWinDirStatCommandLineInfo final
     bool m_hasPathParam = false;
     bool m_malformedFlag = false;
     bool m_invalidPath = false;
+    bool m_hasQuery = false;
     static constexpr std::wstring_view saveToFlag = L"saveto";
     static constexpr std::wstring_view saveDupesToFlag = L"savedupesto";
     static constexpr std::wstring_view savePermsToFlag = L"savepermsto";
+    static constexpr std::wstring_view saveQueryToFlag = L"savequeryto";
+    static constexpr std::wstring_view saveFoldersToFlag = L"savefoldersto";
+    static constexpr std::wstring_view saveStatsToFlag = L"savestatsto";
+    static constexpr std::wstring_view queryFlag = L"query";
     static constexpr std::wstring_view loadFromFlag = L"loadfrom";
     static constexpr std::wstring_view legacyUninstallFlag = L"legacyuninstall";
     std::wstring m_path;
@@ -232,7 +245,8 @@ public:
     bool HasMalformedCommandLine() const noexcept
     {
         return m_malformedFlag || !m_pendingFlag.empty() ||
-            (m_operationFlag == loadFromFlag && m_hasPathParam);
+            (m_operationFlag == loadFromFlag && m_hasPathParam) ||
+            (m_operationFlag == saveQueryToFlag) != m_hasQuery;
     }
     bool HasInvalidPath() const noexcept { return m_invalidPath; }
     bool IsLegacyUninstallRequested() const noexcept { return m_operationFlag == legacyUninstallFlag; }
@@ -270,6 +284,25 @@ private:
             {
                 CDirStatApp::Get()->m_savePermsToPath = param;
             }
+            else if (m_pendingFlag == saveQueryToFlag)
+            {
+                CDirStatApp::Get()->m_saveQueryToPath = param;
+            }
+            else if (m_pendingFlag == saveFoldersToFlag)
+            {
+                CDirStatApp::Get()->m_saveFoldersToPath = param;
+            }
+            else if (m_pendingFlag == saveStatsToFlag)
+            {
+                CDirStatApp::Get()->m_saveStatsToPath = param;
+            }
+            else if (m_pendingFlag == queryFlag)
+            {
+                // Keep the query as given since quotes and backslashes are part of its syntax
+                if (m_hasQuery) m_malformedFlag = true;
+                m_hasQuery = true;
+                CDirStatApp::Get()->m_query = pszParam;
+            }
             else if (m_pendingFlag == loadFromFlag)
             {
                 CDirStatApp::Get()->m_loadFromPath = param;
@@ -326,13 +359,20 @@ private:
             return;
         }
         param = MakeLower(param);
-        if (param == saveToFlag || param == saveDupesToFlag || param == savePermsToFlag || param == loadFromFlag)
+        if (param == saveToFlag || param == saveDupesToFlag || param == savePermsToFlag ||
+            param == saveQueryToFlag || param == saveFoldersToFlag || param == saveStatsToFlag ||
+            param == loadFromFlag)
         {
             if (!m_operationFlag.empty()) m_malformedFlag = true;
             else m_operationFlag = param;
             m_pendingFlag = param;
             if (bLast) m_malformedFlag = true;
         }
+        else if (param == queryFlag)
+        {
+            m_pendingFlag = param;
+            if (bLast) m_malformedFlag = true;
+        }
         else if (param == legacyUninstallFlag)
         {
             // Defer this destructive standalone action until parsing is validated.
@@ -395,8 +435,11 @@ bool CDirStatApp::InitInstance()
     }
 
     // Check if we should hide the app window
-    const bool hideApp = !m_saveToPath.empty() || !m_saveDupesToPath.empty() || !m_savePermsToPath.empty();
+    const bool hideApp = !m_saveToPath.empty() || !m_saveDupesToPath.empty() ||
+        !m_savePermsToPath.empty() || !m_saveQueryToPath.empty() || !m_saveFoldersToPath.empty() ||
+        !m_saveStatsToPath.empty();
     if (hideApp && (cmdInfo.GetPath().empty() || cmdInfo.HasInvalidPath())) ExitProcess(1);
+    if (!m_saveQueryToPath.empty() && !CQueryEngine(m_query).IsValid()) ExitProcess(1);
     if (hideApp) m_nCmdShow = SW_HIDE;
 
     m_model = std::make_unique<CWinDirStatModel>();
@@ -62,6 +62,10 @@ public:
     std::wstring GetSaveToPath() const { return m_saveToPath; }
     std::wstring GetSaveDupesToPath() const { return m_saveDupesToPath; }
     std::wstring GetSavePermsToPath() const { return m_savePermsToPath; }
+    std::wstring GetSaveQueryToPath() const { return m_saveQueryToPath; }
+    std::wstring GetQuery() const { return m_query; }
+    std::wstring GetSaveFoldersToPath() const { return m_saveFoldersToPath; }
+    std::wstring GetSaveStatsToPath() const { return m_saveStatsToPath; }
 
 protected:
 
@@ -77,6 +81,10 @@ protected:
     std::wstring m_saveToPath;      // Path to save results to
     std::wstring m_saveDupesToPath; // Path to save duplicates to
     std::wstring m_savePermsToPath; // Path to save permissions to
+    std::wstring m_saveQueryToPath; // Path to save query results to
+    std::wstring m_query;           // Query to run before saving
+    std::wstring m_saveFoldersToPath; // Path to save folder rankings to
+    std::wstring m_saveStatsToPath; // Path to save scan statistics to
     static CDirStatApp s_singleton; // Singleton application instance
 
 public:
@@ -27,6 +27,10 @@
 #include "SearchDlg.h"
 #include "ProgressDlg.h"
 #include "Filtering.h"
+#include "FilterView.h"
+#include "HashCache.h"
+#include "NameIndex.h"
+#include "QueryEngine.h"
 
 static std::optional<std::wstring> ChooseReportPath(const CDialog::FilePickerMode mode)
 {
@@ -360,6 +364,8 @@ void CWinDirStatModel::OnUpdateViewShowFreeSpace(CCmdUI* pCmdUI)
 
 void CWinDirStatModel::OnViewShowFreeSpace()
 {
+    // The largest files list may be rebuilding from the tree on another thread
+    CFileTopControl::Get()->StopRebuild();
     for (CItem* root : GetRootItem()->GetSpaceItems())
     {
         if (COptions::ShowFreeSpace)
@@ -395,6 +401,8 @@ void CWinDirStatModel::OnUpdateViewShowUnknown(CCmdUI* pCmdUI)
 
 void CWinDirStatModel::OnViewShowUnknown()
 {
+    // The largest files list may be rebuilding from the tree on another thread
+    CFileTopControl::Get()->StopRebuild();
     for (CItem* root : GetRootItem()->GetSpaceItems())
     {
         if (COptions::ShowUnknown)
@@ -868,16 +876,17 @@ void CWinDirStatModel::OnCleanupCompress(const UINT id)
 {
     CWaitCursor wc;
     const auto& itemsSelected = GetAllSelected();
-    const auto& items = CItem::GetItemsRecursive(itemsSelected);
+    const CItemRange items(itemsSelected);
 
     // Show progress dialog and compress files
     const auto alg = CompressionIdToAlg(id);
-    CProgressDlg(items.size(), CProgressDlg::Flags::None, GetMainWindow(), [&](CProgressDlg* pdlg)
+    CProgressDlg(static_cast<size_t>(std::ranges::distance(items)), CProgressDlg::Flags::None, GetMainWindow(), [&](CProgressDlg* pdlg)
     {
+        CItemPathBuilder paths;
         for (const auto & item : items)
         {
             if (pdlg->IsCancelled()) break;
-            CompressFile(item->GetPathLong(), alg);
+            CompressFile(paths.GetLong(item), alg);
             pdlg->Increment();
         }
     }).ShowModal();
@@ -890,16 +899,17 @@ void CWinDirStatModel::OnCleanupOptimizeVhd()
 {
     CWaitCursor wc;
     const auto& itemsSelected = GetAllSelected();
-    const auto& items = CItem::GetItemsRecursive(itemsSelected, [](const CItem* item) {
+    const CItemRange items(itemsSelected, [](const CItem* item) {
         return item->IsTypeOrFlag(IT_FILE) && item->HasExtension(L".vhdx"); });
 
     // Show progress dialog and optimize VHD files
-    CProgressDlg(items.size(), CProgressDlg::Flags::None, GetMainWindow(), [&](CProgressDlg* pdlg)
+    CProgressDlg(static_cast<size_t>(std::ranges::distance(items)), CProgressDlg::Flags::None, GetMainWindow(), [&](CProgressDlg* pdlg)
     {
+        CItemPathBuilder paths;
         for (const auto item : items)
         {
             if (pdlg->IsCancelled()) break;
-            OptimizeVhd(item->GetPathLong());
+            OptimizeVhd(paths.GetLong(item));
             pdlg->Increment();
         }
     }).ShowModal();
@@ -914,6 +924,9 @@ void CWinDirStatModel::OnScanSuspend()
     for (auto& queue : m_queues | std::views::values)
         CWinApp::RunTaskWithUiUpdates([&queue] { queue.SuspendExecution(); });
 
+    // Pause hashing after enumeration so workers waiting on it can go idle first
+    CWinApp::RunTaskWithUiUpdates([] { CFileDupeControl::Get()->SuspendHashing(); });
+
     // Freeze the shared item clock only after every scan worker is idle.
     CItem::SuspendScanClock();
 
@@ -929,6 +942,7 @@ void CWinDirStatModel::OnScanResume()
 
     for (auto& queue : m_queues | std::views::values)
         queue.ResumeExecution();
+    CFileDupeControl::Get()->ResumeHashing();
 
     if (CMainFrame::Get() != nullptr)
         CMainFrame::Get()->SuspendState(false);
@@ -941,6 +955,14 @@ void CWinDirStatModel::OnScanStop()
 
 void CWinDirStatModel::StopScanningEngine(StopReason stopReason)
 {
+    // Stop hashing first so scan workers waiting on its back-pressure are released;
+    // candidates it did not reach are kept for the next scan
+    if (CFileDupeControl::Get() != nullptr)
+        CWinApp::RunTaskWithUiUpdates([] { CFileDupeControl::Get()->StopHashing(); });
+
+    // The largest files rebuild walks the tree the next scan is about to change
+    if (CFileTopControl::Get() != nullptr) CFileTopControl::Get()->StopRebuild();
+
     // Interrupt blocking I/O (e.g. ReadFile on large files) in worker threads
     // so they reach WaitIfSuspended promptly. Without this, SuspendExecution
     // hangs indefinitely waiting for AllThreadsIdling() while a thread reads.
@@ -1004,6 +1026,9 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
     CWaitCursor wc;
     StopScanningEngine();
 
+    // Refreshed items report their scanned totals again
+    ClearFilterView();
+
     // Resolve hardlink references before their derived snapshot can be discarded.
     for (auto*& item : items)
         if (item != nullptr && item->IsTypeOrFlag(IT_HLINKS_FILE)) item = item->GetLinkedItem();
@@ -1040,9 +1065,9 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
     // Prune descendants: if both an ancestor and a descendant are in the list,
     // remove any descendant since it will be rescanned as part of the ancestor scan
     std::erase_if(items, [&](const CItem* item) {
-        return std::ranges::any_of(items, [item](const CItem* other) {
-            return other != item && other->IsAncestorOf(item);
-        });
+        for (auto* parent = item->GetParent(); parent != nullptr; parent = parent->GetParent())
+            if (uniqueItems.contains(parent)) return true;
+        return false;
     });
 
     // If scanning drive(s) just rescan the child nodes
@@ -1052,6 +1077,9 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
         items = items.front()->GetChildren();
     }
 
+    // Refreshed subtrees leave the name index before they are freed and return once rescanned
+    CNameIndex::Get()->Remove(items);
+
     const auto selectedItems = GetAllSelected();
     std::unordered_set<CItem*> doneItems;
     for (auto* item : items)
@@ -1142,11 +1170,17 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
     // Refresh filter cutoffs immediately before scanning in case settings
     // were compiled long ago (e.g. dialog left open before clicking scan).
     CFiltering::CompileFilters();
+    if (!items.empty()) m_scanFiltered = m_scanFiltered || CFiltering::IsFilterActive();
 
     // Start a thread so we do not hang the message loop during inserts.
     // Lambda captures assume the model exists for the duration of the scan.
     m_thread = std::jthread([this,items, visualInfo] () mutable
     {
+        m_scanStatistics = {};
+        CFiltering::EvaluationNanoseconds = 0;
+        const ULONGLONG scanStart = GetTickCount64();
+        CFileDupeControl::Get()->StartHashing();
+
         // Add items to processing queue
         for (const auto & item : items)
         {
@@ -1172,20 +1206,23 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
         // Create subordinate threads if there is work to do
         std::unordered_map<std::wstring, FinderNtfsContext> queueContextNtfs;
         std::unordered_map<std::wstring, FinderBasicContext> queueContextBasic;
+        std::unordered_map<std::wstring, CPendingFilterScopes> queueFilterScopes;
         for (auto& queue : m_queues)
         {
             queueContextNtfs.try_emplace(queue.first);
             queueContextBasic.try_emplace(queue.first);
+            queueFilterScopes.try_emplace(queue.first);
 
             auto* queuePtr = &queue.second;
             auto* ntfsCtx = &queueContextNtfs[queue.first];
             auto* basicCtx = &queueContextBasic[queue.first];
+            auto* filterScopes = &queueFilterScopes[queue.first];
 
             // Use one worker per MTP volume while retaining configured parallelism for filesystems.
             const unsigned int threads = FinderMtp::IsPath(queue.first) ? 1 : COptions::ScanningThreads;
-            queue.second.StartThreads(threads, [queuePtr, ntfsCtx, basicCtx]
+            queue.second.StartThreads(threads, [queuePtr, ntfsCtx, basicCtx, filterScopes]
             {
-                CItem::ScanItems(queuePtr, *ntfsCtx, *basicCtx);
+                CItem::ScanItems(queuePtr, *ntfsCtx, *basicCtx, *filterScopes);
             });
         }
 
@@ -1200,6 +1237,9 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
         StopReason stopReason = Default;
         for (auto& queue : m_queues | std::views::values)
             stopReason = static_cast<StopReason>(queue.WaitForCompletion());
+        m_scanStatistics.enumerateTicks = GetTickCount64() - scanStart;
+        m_scanStatistics.filterNanoseconds = CFiltering::EvaluationNanoseconds;
+        if (stopReason != Abort) MergeExtensionShards();
 
         // If new scan or closing, complete scan UI cleanup before the old
         // tree is torn down.
@@ -1216,6 +1256,7 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
         }
 
         // Restore unknown and freespace items
+        const ULONGLONG finalizeStart = GetTickCount64();
         for (const auto& item : items)
         {
             if (!item->SupportsSpaceItems()) continue;
@@ -1261,7 +1302,12 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
 
         // Sorting and other finalization tasks
         CItem::ScanItemsFinalize(GetRootItem());
+        CItem::UpdateTreeIndex(GetRootItem(), items);
         Get()->RebuildExtensionData();
+        m_scanStatistics.finalizeTicks = GetTickCount64() - finalizeStart;
+        VTRACE(L"Scan statistics: enumerate {} ms, finalize {} ms, filters {} ms",
+            m_scanStatistics.enumerateTicks, m_scanStatistics.finalizeTicks,
+            m_scanStatistics.filterNanoseconds / 1'000'000);
 
         // Handle quiet save mode if path is set
         if (const auto savePath = CDirStatApp::Get()->GetSaveToPath(); !savePath.empty())
@@ -1277,7 +1323,11 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
         // Handle quiet save duplicates mode if path is set
         if (const auto dupeSavePath = CDirStatApp::Get()->GetSaveDupesToPath(); !dupeSavePath.empty())
         {
-            // Get the duplicate root item
+            // Get the duplicate root item once hashing has drained
+            if (!CFileDupeControl::Get()->WaitForHashing()) ExitProcess(1);
+            CHashCache::Get()->Flush();
+            CFileDupeControl::Get()->AnalyzePartialDuplicates();
+            CFileDupeControl::Get()->AnalyzeDuplicateFolders();
             CMainFrame::Get()->InvokeInMessageThread([]
             {
                 CFileDupeControl::Get()->SortItems();
@@ -1299,11 +1349,36 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
             ExitProcess(SavePermissions(permsSavePath, ptrs) ? 0 : 1);
         }
 
+        // Handle quiet query mode if path is set
+        if (const auto querySavePath = CDirStatApp::Get()->GetSaveQueryToPath(); !querySavePath.empty())
+        {
+            // Evaluate the query over the tree and exit with success == 0 or failure == 1
+            const CQueryEngine query(CDirStatApp::Get()->GetQuery());
+            if (!HasRootItem() || !query.IsValid()) ExitProcess(1);
+            ExitProcess(SaveQueryResults(querySavePath, query.Run(GetRootItem())) ? 0 : 1);
+        }
+
+        // Rank folders against earlier scans, including those of past sessions, and keep this one
+        // in place of the earlier snapshots of the same folders and drives to rank the next against
+        if (!m_folderSnapshotsLoaded) m_folderSnapshots = CFolderRankings::LoadSnapshots();
+        m_folderSnapshotsLoaded = true;
+        CFolderRankings rankings(GetRootItem(), static_cast<size_t>(COptions::LargeFileCount.Obj()), m_folderSnapshots);
+        const bool snapshotsChanged = CFolderRankings::MergeSnapshots(m_folderSnapshots, rankings.TakeSnapshots());
+        m_scanStatistics.folderRankingTicks = rankings.GetTicks();
+
+        // Handle quiet save folder rankings mode if path is set
+        if (const auto foldersSavePath = CDirStatApp::Get()->GetSaveFoldersToPath(); !foldersSavePath.empty())
+        {
+            if (snapshotsChanged) CFolderRankings::SaveSnapshots(m_folderSnapshots);
+            ExitProcess(SaveFolderRankings(foldersSavePath, rankings) ? 0 : 1);
+        }
+
         // Invoke a UI thread to do updates
         CMainFrame::Get()->InvokeInMessageThread([&]
         {
             CMainFrame::Get()->LockWindowUpdate();
             Get()->NotifyPanes();
+            CFileTopControl::Get()->SetFolderRankings(rankings);
             CMainFrame::Get()->SetProgressComplete();
             CMainFrame::Get()->ApplyPaneVisibility(true);
             CMainFrame::Get()->GetVisualizationPane()->SuspendRecalculationDrawing(false);
@@ -1319,6 +1394,62 @@ void CWinDirStatModel::StartScanningEngine(std::vector<CItem*> items)
             }
         });
 
+        // Changed snapshots are written from a copy off the scan path once an earlier write is done
+        if (snapshotsChanged)
+        {
+            if (m_folderSnapshotsTask.valid()) m_folderSnapshotsTask.wait();
+            m_folderSnapshotsTask = std::async(std::launch::async,
+                [snapshots = m_folderSnapshots] { CFolderRankings::SaveSnapshots(snapshots); });
+        }
+
+        // Index names for searches while the tree is browsable; searches walk the tree until it is ready
+        CNameIndex::Get()->Update(GetRootItem(), items);
+        const auto indexStatistics = CNameIndex::Get()->GetStatistics();
+        m_scanStatistics.nameIndexTicks = indexStatistics.buildTicks;
+        m_scanStatistics.nameIndexBytes = indexStatistics.bytes;
+        VTRACE(L"Name index: {} names for {} items, {} MiB in {} ms", indexStatistics.names,
+            indexStatistics.items, indexStatistics.bytes / wds::Mi, indexStatistics.buildTicks);
+
+        // The tree is complete; duplicate results keep streaming in until hashing drains
+        const ULONGLONG hashStart = GetTickCount64();
+        if (CFileDupeControl::Get()->WaitForHashing())
+        {
+            m_scanStatistics.hashTicks = GetTickCount64() - hashStart;
+            VTRACE(L"Duplicate hashing: {} candidates, {} ms after tree completion",
+                CFileDupeControl::Get()->GetHashProgress().first, m_scanStatistics.hashTicks);
+
+            const auto cacheStatistics = CHashCache::Get()->GetStatistics();
+            m_scanStatistics.hashCacheHits = cacheStatistics.hits;
+            m_scanStatistics.hashCacheMisses = cacheStatistics.misses;
+            m_scanStatistics.hashCacheLookupNanoseconds =
+                cacheStatistics.lookupNanoseconds / std::max(1ull, cacheStatistics.hits + cacheStatistics.misses);
+            VTRACE(L"Hash cache: {} hits, {} misses, {} ns per lookup", cacheStatistics.hits, cacheStatistics.misses,
+                m_scanStatistics.hashCacheLookupNanoseconds);
+
+            std::tie(m_scanStatistics.hashBytesConfirmed, m_scanStatistics.hashBytesRejected) =
+                CFileDupeControl::Get()->GetHashBytesPerOutcome();
+            VTRACE(L"Duplicate hashing read {} bytes per confirmed duplicate, {} bytes per rejected candidate",
+                m_scanStatistics.hashBytesConfirmed, m_scanStatistics.hashBytesRejected);
+
+            const ULONGLONG partialStart = GetTickCount64();
+            const auto chunkStatistics = CFileDupeControl::Get()->AnalyzePartialDuplicates();
+            m_scanStatistics.partialDupeTicks = GetTickCount64() - partialStart;
+            m_scanStatistics.partialDupeBytes = chunkStatistics.bytes;
+            VTRACE(L"Partial duplicates: {} files, {} MiB/s, {} chunks indexed at 1 in {}", chunkStatistics.files,
+                chunkStatistics.bytes / wds::Mi * 1000 / std::max(1ull, m_scanStatistics.partialDupeTicks),
+                chunkStatistics.indexedChunks, 1ull << chunkStatistics.sampleShift);
+
+            const size_t folderSets = CFileDupeControl::Get()->AnalyzeDuplicateFolders();
+            VTRACE(L"Duplicate folders: {} sets", folderSets);
+        }
+
+        // Handle quiet save statistics mode once every phase has been timed
+        if (const auto statsSavePath = CDirStatApp::Get()->GetSaveStatsToPath(); !statsSavePath.empty())
+        {
+            CHashCache::Get()->Flush();
+            ExitProcess(SaveScanStatistics(statsSavePath, GetScanStatistics(), GetTeardownBytesReleased()) ? 0 : 1);
+        }
+
         // Defer heap cleanup until the timer observes that this thread has exited.
         m_heapMinPending.store(true, std::memory_order_relaxed);
     });
@@ -1330,14 +1461,17 @@ void CWinDirStatModel::OnRemoveMarkOfTheWebTags()
 
     CWaitCursor wc;
     const auto& itemsSelected = GetAllSelected();
-    const auto& items = CItem::GetItemsRecursive(itemsSelected);
+    const CItemRange items(itemsSelected);
 
-    CProgressDlg(items.size(), CProgressDlg::Flags::None, GetMainWindow(), [&](CProgressDlg* pdlg)
+    CProgressDlg(static_cast<size_t>(std::ranges::distance(items)), CProgressDlg::Flags::None, GetMainWindow(), [&](CProgressDlg* pdlg)
     {
+        CItemPathBuilder paths;
+        std::wstring streamPath;
         for (const auto item : items)
         {
             if (pdlg->IsCancelled()) break;
-            DeleteFile((item->GetPathLong() + L":Zone.Identifier").c_str());
+            streamPath.assign(paths.GetLong(item)).append(L":Zone.Identifier");
+            DeleteFile(streamPath.c_str());
             pdlg->Increment();
         }
     }).ShowModal();
@@ -24,6 +24,9 @@
 #include "FilePermsControl.h"
 #include "FinderBasic.h"
 #include "FinderMtp.h"
+#include "Filtering.h"
+#include "FilterView.h"
+#include "NameIndex.h"
 #include "ProgressDlg.h"
 
 CWinDirStatModel::CWinDirStatModel()
@@ -38,12 +41,16 @@ CWinDirStatModel::CWinDirStatModel()
 
 CWinDirStatModel::~CWinDirStatModel()
 {
+    if (m_teardownTask.valid()) m_teardownTask.wait();
     delete m_rootItem;
     s_singleton = nullptr;
 }
 
 CWinDirStatModel* CWinDirStatModel::s_singleton = nullptr;
 
+// Shard of the scan worker running on this thread, if any
+static thread_local SExtensionShard* currentExtensionShard = nullptr;
+
 void CWinDirStatModel::ClearScanState()
 {
     CWaitCursor wc;
@@ -60,9 +67,12 @@ void CWinDirStatModel::ClearScanState()
     // Clean out icon queue
     GetIconHandler()->ClearAsyncShellInfoQueue();
 
-    // Reset extension data
-    GetExtensionData()->clear();
+    // Reset extension data; the filter view and name index refer into the old tree
+    CFilterView::SetActive(nullptr);
+    CNameIndex::Get()->Clear();
+    ClearExtensionData();
     m_registeredExtensions.clear();
+    m_scanFiltered = false;
 
     // Cleanup visual artifacts - controllers manage their own root items
     if (CFileTopControl::Get() != nullptr) CFileTopControl::Get()->DeleteAllItems();
@@ -72,8 +82,8 @@ void CWinDirStatModel::ClearScanState()
     if (CFileWatcherControl::Get() != nullptr) CFileWatcherControl::Get()->DeleteAllItems();
     if (CFilePermsControl::Get() != nullptr) CFilePermsControl::Get()->DeleteAllItems();
 
-    // Cleanup structures
-    delete m_rootItem;
+    // Cleanup structures; the detached tree is freed while the next scan starts
+    if (m_rootItem != nullptr) DeleteItemsAsync({ m_rootItem });
     m_rootItem = nullptr;
     m_zoomItem = nullptr;
 }
@@ -202,7 +212,7 @@ bool CWinDirStatModel::OpenLoadedScan(CItem* loadedRoot)
     m_zoomItem = m_rootItem;
 
     // Populate the Largest Files list from the pre-built tree
-    for (CItem* item : CItem::GetItemsRecursive({ m_rootItem }))
+    for (CItem* item : CItemRange(std::span(&m_rootItem, 1)))
     {
         CFileTopControl::Get()->ProcessTop(item);
     }
@@ -244,6 +254,87 @@ SExtensionRecord* CWinDirStatModel::GetExtensionDataRecord(const std::wstring& e
     return &m_extensionData[ext];
 }
 
+void CWinDirStatModel::AddExtensionFile(const CItem* item)
+{
+    SExtensionShard* shard = currentExtensionShard;
+    if (shard == nullptr)
+    {
+        GetExtensionDataRecord(item->GetExtension())->AddFile(item->GetSizeLogical());
+        return;
+    }
+
+    // Only the first file of each extension on this worker takes the lock
+    item->GetExtension(shard->extension);
+    auto id = shard->ids.find(shard->extension);
+    if (id == shard->ids.end())
+    {
+        id = shard->ids.emplace(shard->extension, InternExtension(shard->extension)).first;
+        if (id->second >= shard->totals.size()) shard->totals.resize(id->second + 1);
+    }
+
+    auto& [files, bytes] = shard->totals[id->second];
+    files++;
+    bytes += item->GetSizeLogical();
+}
+
+ULONG CWinDirStatModel::InternExtension(const std::wstring_view extension)
+{
+    std::scoped_lock guard(m_extensionMutex);
+    const auto [it, inserted] = m_extensionIds.try_emplace(std::wstring(extension),
+        static_cast<ULONG>(m_extensionNames.size()));
+    if (inserted) m_extensionNames.emplace_back(extension);
+    return it->second;
+}
+
+SExtensionShard* CWinDirStatModel::AcquireExtensionShard()
+{
+    std::scoped_lock guard(m_extensionMutex);
+    auto it = std::ranges::find_if(m_extensionShards, [](const auto& shard) { return !shard->inUse; });
+    if (it == m_extensionShards.end()) it = m_extensionShards.insert(it, std::make_unique<SExtensionShard>());
+    (*it)->inUse = true;
+    currentExtensionShard = it->get();
+    return it->get();
+}
+
+void CWinDirStatModel::ReleaseExtensionShard(SExtensionShard* shard)
+{
+    // The totals stay in the shard until the scan thread merges them
+    std::scoped_lock guard(Get()->m_extensionMutex);
+    shard->inUse = false;
+    currentExtensionShard = nullptr;
+}
+
+void CWinDirStatModel::MergeExtensionShards()
+{
+    // Workers are idle by now and the queue lock they last took publishes their totals
+    std::scoped_lock guard(m_extensionMutex);
+    for (const auto& shard : m_extensionShards)
+    {
+        for (size_t id = 0; id < shard->totals.size(); id++)
+        {
+            if (const auto [files, bytes] = shard->totals[id]; files > 0)
+            {
+                m_extensionData[m_extensionNames[id]].AddFiles(files, bytes);
+            }
+        }
+        std::ranges::fill(shard->totals, std::pair<ULONGLONG, ULONGLONG>{});
+    }
+}
+
+void CWinDirStatModel::ClearExtensionData()
+{
+    // No workers are running so the IDs can start over
+    std::scoped_lock guard(m_extensionMutex);
+    m_extensionData.clear();
+    m_extensionNames.clear();
+    m_extensionIds.clear();
+    for (const auto& shard : m_extensionShards)
+    {
+        shard->ids.clear();
+        shard->totals.clear();
+    }
+}
+
 // Snapshots every ".ext" key directly under HKEY_CLASSES_ROOT. Rebuilt with the extension
 // data so registration tests are lock-free set lookups
 void CWinDirStatModel::RebuildRegisteredExtensions()
@@ -302,6 +393,47 @@ bool CWinDirStatModel::IsScanSettled() const
     return IsRootDone() && !IsScanRunning();
 }
 
+bool CWinDirStatModel::CanApplyFilterView() const
+{
+    // A view can only narrow what was scanned, so filtered scans still need a rescan
+    return COptions::FilteringApplyToResults && HasRootItem() && IsScanSettled() && !m_scanFiltered;
+}
+
+void CWinDirStatModel::ApplyFilterView()
+{
+    if (!CanApplyFilterView()) return;
+    CWaitCursor wc;
+
+    ClearFilterView();
+    if (CFiltering::IsFilterActive())
+    {
+        const ULONGLONG start = GetTickCount64();
+        auto view = std::make_shared<CFilterView>(m_rootItem);
+        VTRACE(L"Filter view: {} visible items in {} ms", view->GetVisibleItems(), GetTickCount64() - start);
+
+        // Extension totals follow the files that remain visible
+        m_rootItem->ExtensionDataProcessChildren(true);
+        CFilterView::SetActive(std::move(view));
+        m_rootItem->ExtensionDataProcessChildren();
+    }
+
+    // Hidden items may have been zoomed into or selected
+    ClearReselectChildStack();
+    m_zoomItem = m_rootItem;
+    RebuildExtensionData();
+    CFileTreeControl::Get()->SetRootItem(m_rootItem);
+    NotifyPanes(MODEL_CHANGE_NONE);
+}
+
+void CWinDirStatModel::ClearFilterView()
+{
+    if (CFilterView::GetActive() == nullptr) return;
+
+    // Restore the extension totals of the files the view hid
+    CFilterView::SetActive(nullptr);
+    m_rootItem->ExtensionDataProcessChildren();
+}
+
 void CWinDirStatModel::RunPendingHeapCleanup()
 {
     if (!m_heapMinPending.load(std::memory_order_relaxed) || IsScanRunning()) return;
@@ -313,6 +445,52 @@ void CWinDirStatModel::RunPendingHeapCleanup()
     m_heapMinPending.store(false, std::memory_order_relaxed);
 }
 
+void CWinDirStatModel::DeleteItemsAsync(std::vector<CItem*> items)
+{
+    if (items.empty()) return;
+
+    // Queue the detached items and start a worker unless one is already draining the queue
+    std::scoped_lock lock(m_teardownMutex);
+    m_teardownItems.insert(m_teardownItems.end(), items.begin(), items.end());
+    if (m_teardownActive) return;
+    m_teardownActive = true;
+    m_teardownTask = std::async(std::launch::async, [this] { RunTeardown(); });
+}
+
+void CWinDirStatModel::RunTeardown()
+{
+    const auto getPrivateBytes = []
+    {
+        PROCESS_MEMORY_COUNTERS_EX pmc = { .cb = sizeof(pmc) };
+        return GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS>(&pmc),
+            sizeof(pmc)) ? static_cast<ULONGLONG>(pmc.PrivateUsage) : 0ull;
+    };
+
+    // Free memory in background mode so the new scan keeps processor and I/O priority
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    while (true)
+    {
+        std::vector<CItem*> items;
+        if (std::scoped_lock lock(m_teardownMutex); m_teardownItems.empty())
+        {
+            m_teardownActive = false;
+            break;
+        }
+        else items.swap(m_teardownItems);
+
+        // Release the trees and return the freed pages; concurrent scans make this approximate
+        const ULONGLONG startTicks = GetTickCount64();
+        const ULONGLONG before = getPrivateBytes();
+        for (const CItem* item : items) delete item;
+        (void) _heapmin();
+        const ULONGLONG after = getPrivateBytes();
+        if (before > after) m_teardownBytesReleased.fetch_add(before - after, std::memory_order_relaxed);
+        VTRACE(L"Teardown freed {} trees in {} ms, released {} bytes",
+            items.size(), GetTickCount64() - startTicks, before > after ? before - after : 0);
+    }
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+}
+
 void CWinDirStatModel::SetHighlightExtension(const std::wstring & ext, const bool unregistered)
 {
     m_highlightExtension = ext;
@@ -573,7 +751,7 @@ void CWinDirStatModel::DeletePhysicalItems(const std::vector<CItem*>& items, con
                         return;
                     }
 
-                    DeleteFileForce(item->GetPathLong(), item->GetAttributes());
+                    DeleteFileForce(item->GetPathLongRef(), item->GetAttributes());
                     pdlg->Increment();
                 });
 
@@ -581,6 +759,7 @@ void CWinDirStatModel::DeletePhysicalItems(const std::vector<CItem*>& items, con
             if (cancelled) return;
 
             // Delete directories in reverse order (children before parents)
+            CItemPathBuilder paths;
             for (const auto& item : directories | std::views::reverse)
             {
                 if (pdlg->IsCancelled())
@@ -589,7 +768,7 @@ void CWinDirStatModel::DeletePhysicalItems(const std::vector<CItem*>& items, con
                     return;
                 }
 
-                RemoveDirectory(item->GetPathLong().c_str());
+                RemoveDirectory(paths.GetLong(item).c_str());
                 pdlg->Increment();
             }
 
@@ -19,6 +19,7 @@
 
 #include "pch.h"
 #include "TreeListControl.h"
+#include "FolderRankings.h"
 
 class CItem;
 class CItemDupe;
@@ -43,6 +44,12 @@ struct alignas(std::hardware_destructive_interference_size) SExtensionRecord
         bytes.fetch_add(size, std::memory_order_relaxed);
     }
 
+    void AddFiles(const ULONGLONG count, const ULONGLONG size) noexcept
+    {
+        files.fetch_add(count, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
     void RemoveFile(const ULONGLONG size) noexcept
     {
         files.fetch_sub(1, std::memory_order_relaxed);
@@ -58,6 +65,41 @@ struct alignas(std::hardware_destructive_interference_size) SExtensionRecord
 //
 using CExtensionData = std::unordered_map<std::wstring, SExtensionRecord>;
 
+//
+// Extension totals counted by one scan worker. Extensions are interned into
+// IDs shared by all workers, so each file costs a lookup in a map no other
+// thread touches and two additions; the scan thread merges the totals into
+// the extension data once the workers are idle.
+//
+struct SExtensionShard
+{
+    std::unordered_map<std::wstring, ULONG, string_hash, std::equal_to<>> ids;
+    std::vector<std::pair<ULONGLONG, ULONGLONG>> totals; // Files and bytes by ID
+    std::wstring extension; // Reused for each file
+    bool inUse = false;
+};
+
+//
+// Phase timings and counters collected for the most recent scan.
+//
+struct SScanStatistics
+{
+    ULONGLONG enumerateTicks = 0; // Milliseconds until all workers ran out of work
+    ULONGLONG finalizeTicks = 0;  // Milliseconds for hardlinks, sorting and extension data
+    ULONGLONG filterNanoseconds = 0; // Worker time spent evaluating filters, summed across threads
+    ULONGLONG nameIndexTicks = 0; // Milliseconds spent building the search name index
+    ULONGLONG nameIndexBytes = 0; // Memory held by the search name index
+    ULONGLONG hashTicks = 0;      // Milliseconds duplicate hashing ran past the finished tree
+    ULONGLONG hashCacheHits = 0;  // Hashes answered by the persistent hash cache
+    ULONGLONG hashCacheMisses = 0;
+    ULONGLONG hashCacheLookupNanoseconds = 0; // Average time per hash cache lookup
+    ULONGLONG hashBytesConfirmed = 0; // Average content bytes hashed per confirmed duplicate
+    ULONGLONG hashBytesRejected = 0;  // Average content bytes hashed per rejected candidate
+    ULONGLONG partialDupeTicks = 0;   // Milliseconds spent chunking files for partial duplicates
+    ULONGLONG partialDupeBytes = 0;   // Content bytes chunked for partial duplicates
+    ULONGLONG folderRankingTicks = 0; // Milliseconds spent ranking folders after the scan
+};
+
 //
 // Model changes that panes can respond to.
 //
@@ -103,6 +145,11 @@ public:
 
     CExtensionData* GetExtensionData() { return &m_extensionData; }
     SExtensionRecord* GetExtensionDataRecord(const std::wstring& ext);
+    void AddExtensionFile(const CItem* item);
+    SExtensionShard* AcquireExtensionShard();
+    static void ReleaseExtensionShard(SExtensionShard* shard);
+    void MergeExtensionShards();
+    void ClearExtensionData();
     bool IsExtensionRegistered(const std::wstring& ext) const { return m_registeredExtensions.contains(ext); }
     ULONGLONG GetRootSize() const;
 
@@ -112,7 +159,13 @@ public:
     bool IsRootDone() const;
     bool IsScanRunning() const;
     bool IsScanSettled() const;
+    bool CanApplyFilterView() const;
+    void ApplyFilterView();
+    void ClearFilterView();
+    const SScanStatistics& GetScanStatistics() const { return m_scanStatistics; }
     void RunPendingHeapCleanup();
+    void DeleteItemsAsync(std::vector<CItem*> items);
+    ULONGLONG GetTeardownBytesReleased() const { return m_teardownBytesReleased.load(std::memory_order_relaxed); }
     CItem* GetRootItem() const { return m_rootItem; }
     CItem* GetZoomItem() const { return m_zoomItem; }
     bool IsZoomed() const { return GetZoomItem() != GetRootItem(); }
@@ -167,6 +220,8 @@ private:
         std::span<CItem* const> affectedItems, std::wstring_view detail = {});
     void RemoveLocalProfiles(std::wstring_view whereClause) const;
     void NotifyPanesExcept(CWnd* sender, MODEL_CHANGE change = MODEL_CHANGE_NONE, CItem* item = nullptr);
+    void RunTeardown();
+    ULONG InternExtension(std::wstring_view extension);
 
     static CWinDirStatModel* s_singleton;
 
@@ -182,12 +237,27 @@ private:
 
     std::mutex m_extensionMutex;
     CExtensionData m_extensionData;    // Base for the extension view and cushion colors
+    std::vector<std::wstring> m_extensionNames; // Interned extensions by ID
+    std::unordered_map<std::wstring, ULONG, string_hash, std::equal_to<>> m_extensionIds;
+    std::vector<std::unique_ptr<SExtensionShard>> m_extensionShards; // Reused by later scans
 
     std::vector<CItem*> m_reselectChildStack; // Stack for the "Re-select Child"-Feature
 
     std::unordered_map<std::wstring, BlockingQueue<CItem*>> m_queues; // The scanning and thread queue
+    SScanStatistics m_scanStatistics; // Written by the scan thread once each phase completes
+    bool m_scanFiltered = false; // Filters were applied while scanning the current tree
+    CFolderRankings::Snapshots m_folderSnapshots; // Folder sizes of earlier scans to measure growth against
+    bool m_folderSnapshotsLoaded = false;         // Read from disk by the first scan that ranks folders
+    std::future<void> m_folderSnapshotsTask;      // Writes a copy of the snapshots after a scan changed them
     std::atomic_bool m_heapMinPending = false;
     std::future<void> m_heapMinTask; // Heap cleanup that does not extend scan state
+
+    // Detached item trees waiting to be freed on a background thread
+    std::mutex m_teardownMutex;
+    std::vector<CItem*> m_teardownItems;
+    bool m_teardownActive = false;
+    std::future<void> m_teardownTask;
+    std::atomic<ULONGLONG> m_teardownBytesReleased = 0; // Private bytes returned by teardowns
     std::jthread m_thread; // Wrapper thread so we do not occupy the UI thread
 
     // Cache selected items so command-update handlers can use a non-owning view